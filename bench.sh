@@ -0,0 +1,81 @@
+#!/bin/sh
+# Benchmark de políticas de asignación (make bench).
+#
+# Genera con trace_gen un conjunto fijo de trazas (semillas fijas, así que
+# siempre son las mismas), las reproduce con cada algoritmo de
+# memory_manager y muestra una tabla comparativa con operaciones por
+# segundo, latencia p99, pico de fragmentación externa, asignaciones
+# fallidas y memoria de metadatos. Los mismos datos se escriben en JSON.
+#
+# Uso: ./bench.sh [salida.json]
+#   BENCH_OPS=N  Operaciones por traza (por defecto 1000000)
+
+set -e
+
+OPS=${BENCH_OPS:-1000000}
+OUTPUT=${1:-bench_results.json}
+TRACE_DIR=bench_traces
+ALGORITHMS="0 1 2"
+ALGORITHM_NAMES="First-fit Best-fit Worst-fit"
+
+# nombre|tamaño del pool|opciones de trace_gen
+#
+# --live queda por encima de las variables vivas que pide cada vida media
+# (y de la longitud de fase en "phased"), así que el límite de trace_gen no
+# adelanta muertes. El pool es unas dos veces el pico de bytes en uso de la
+# traza: cabe con holgura y lo que se mide es cómo fragmenta cada política,
+# no que todas se queden sin espacio. El pico depende de las variables
+# vivas, no de BENCH_OPS.
+CORPUS="uniform|32K|--size=uniform:16:256 --lifetime=exp:100 --live=1024 --seed=1
+lognormal|48K|--size=lognormal:4:1 --max-size=4096 --lifetime=exp:200 --live=1024 --seed=2
+bimodal|48K|--size=bimodal:32:1500:0.9 --lifetime=exp:50 --live=1024 --seed=3
+phased|160K|--size=lognormal:4:0.8 --max-size=4096 --lifetime=phased:1000:0.1 --realloc=0.05:1.5 --live=4096 --seed=4"
+
+# Archivo de la traza; incluye un resumen de las opciones para no reutilizar
+# una traza generada con otras
+trace_file() {
+    echo "$TRACE_DIR/$1-$OPS-$(printf '%s' "$2" | cksum | cut -d' ' -f1).txt"
+}
+
+# Extrae un campo numérico de un registro JSON de una línea
+field() {
+    printf '%s\n' "$1" | sed -n "s/.*\"$2\":\([^,}]*\).*/\1/p"
+}
+
+mkdir -p "$TRACE_DIR"
+echo "$CORPUS" | while IFS='|' read -r name pool options; do
+    trace=$(trace_file "$name" "$options")
+    if [ ! -f "$trace" ]; then
+        # shellcheck disable=SC2086
+        ./trace_gen --ops="$OPS" $options "$trace"
+    fi
+done
+
+printf '%-10s %-10s %12s %9s %10s %9s %10s\n' \
+    "Traza" "Algoritmo" "ops/s" "p99 (ns)" "Frag. máx" "Fallidas" "Metadatos"
+printf '{"ops_per_trace":%s,"results":[' "$OPS" > "$OUTPUT"
+first=1
+echo "$CORPUS" | while IFS='|' read -r name pool options; do
+    trace=$(trace_file "$name" "$options")
+    for algorithm in $ALGORITHMS; do
+        summary=$(./memory_manager "$trace" "$algorithm" --pool-size="$pool" --quiet --summary --format=json 2>/dev/null |
+                  grep '"type":"summary"')
+        ops_per_s=$(field "$summary" ops_per_s)
+        p99=$(field "$summary" p99_ns)
+        fragmentation=$(field "$summary" peak_external_fragmentation)
+        failed=$(field "$summary" failed_allocs)
+        metadata=$(field "$summary" metadata_bytes)
+        algorithm_name=$(echo "$ALGORITHM_NAMES" | cut -d' ' -f$((algorithm + 1)))
+
+        printf '%-10s %-10s %12.0f %9s %10.3f %9s %10s\n' "$name" "$algorithm_name" \
+            "$ops_per_s" "$p99" "$fragmentation" "$failed" "$metadata"
+        if [ $first -eq 0 ]; then
+            printf ',' >> "$OUTPUT"
+        fi
+        first=0
+        printf '{"trace":"%s","pool":"%s","algorithm":"%s","ops_per_s":%s,"p99_ns":%s,"peak_external_fragmentation":%s,"failed_allocs":%s,"metadata_bytes":%s}' \
+            "$name" "$pool" "$algorithm_name" "$ops_per_s" "$p99" "$fragmentation" "$failed" "$metadata" >> "$OUTPUT"
+    done
+done
+printf ']}\n' >> "$OUTPUT"
+echo "Resultados en $OUTPUT"
@@ -1,809 +1,7941 @@
+#define _GNU_SOURCE               // clock_gettime/CLOCK_MONOTONIC y sched_getcpu con -std=c11
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 // Constantes de configuración del gestor de memoria
-#define MAX_VARIABLES 100          // Número máximo de variables que se pueden gestionar
+#define VARIABLE_TABLE_INITIAL 64  // Capacidad inicial de la tabla de variables del gestor
 #define MAX_NAME_LENGTH 50         // Longitud máxima del nombre de una variable
-#define MEMORY_SIZE 10000          // Tamaño del bloque de memoria principal en bytes
+#define NAME_ID_NONE UINT32_MAX    // ID de "sin nombre" (bloque libre, PRINT, END_REGION sin nombre)
+#define NAME_ID_PADDING (UINT32_MAX - 1) // Etiqueta de un bloque libre de relleno de alineación
+#define BLOCK_NONE (-1)            // Índice de bloque inexistente (búsqueda sin resultado)
+#define MEMORY_SIZE 10000          // Tamaño por defecto del pool en bytes (--pool-size)
+#define MAX_ALIGNMENT_SHIFT 30     // Alineación máxima de ALLOC/REALLOC: 2^30 bytes (1 GiB)
+#define POOL_RESERVE_DEFAULT ((size_t)1 << 36) // Espacio virtual reservado para un pool que crece (64 GiB)
+
+// Origen de la memoria del pool (--mmap)
+#define PAGES_MALLOC 0             // malloc (comportamiento original; no devuelve páginas)
+#define PAGES_MMAP 1               // mmap con páginas normales
+#define PAGES_THP 2                // mmap alineado con madvise(MADV_HUGEPAGE) (páginas enormes transparentes)
+#define PAGES_HUGETLB 3            // mmap con MAP_HUGETLB (requiere páginas enormes reservadas)
+#define HUGE_PAGE_SIZE ((size_t)1 << 21) // Tamaño de página enorme (2 MiB en x86-64 y arm64)
+#define RESIDENCY_BATCH 4096       // Páginas consultadas por llamada a mincore
+
+// Etiquetas de bloque dentro del pool (--headers)
+#define BLOCK_HEADER_SIZE 8        // Cabecera de cada bloque: tamaño << 1 | BLOCK_TAG_USED
+#define BLOCK_FOOTER_SIZE 8        // Pie de cada bloque libre: tamaño (lleva de vuelta a su cabecera)
+#define BLOCK_MIN_SIZE 16          // Bloque mínimo con etiquetas: cabecera + pie
+#define BLOCK_TAG_ALIGN 8          // Los bloques con etiquetas ocupan múltiplos de 8 bytes
+#define BLOCK_TAG_USED 1           // Bit de la cabecera que indica bloque ocupado
+
+// Modos de fusión de bloques libres
+#define COALESCE_EAGER 0           // Fusionar tras cada FREE y cada reducción (comportamiento original)
+#define COALESCE_DEFERRED 1        // Solo marcar como libre; fusionar en pasadas por lotes
+
+// Códigos de operación de una traza ya interpretada
+#define OP_NONE 0                  // Línea vacía o comentario
+#define OP_ALLOC 1
+#define OP_REALLOC 2
+#define OP_FREE 3
+#define OP_PRINT 4
+#define OP_BEGIN_REGION 5
+#define OP_END_REGION 6
+#define OP_STATS 7
+#define OP_LATENCY 8
+#define OP_COUNT 9                 // Número de códigos de operación
+
+// Constantes de las trazas binarias
+#define BINARY_TRACE_MAGIC "MMTRACE1" // Firma de 8 bytes al inicio del archivo
+#define BINARY_TRACE_VERSION 2     // La versión 1 (sin alineación) se sigue aceptando
+
+// Configuración de las cachés por hilo (modo multihilo)
+#define CACHE_MAX_SIZE 4096        // Solicitudes mayores van directo al heap central
+#define CACHE_BIN_CAPACITY 16      // Bloques máximos por clase de tamaño en cada caché
+#define CACHE_REFILL_BATCH 4       // Bloques que se piden al heap central por recarga
+#define MAX_THREADS 64             // Máximo de hilos de reproducción
+
+// Reparto del pool en arenas independientes (modo multihilo)
+#define MAX_ARENAS 64              // Máximo de arenas en que se divide el pool
+#define ARENA_BIND_ROUND_ROBIN 0   // Cada hilo se asocia a una arena fija al crearse
+#define ARENA_BIND_CPU 1           // Cada hilo usa la arena del núcleo donde se ejecuta
+
+// Constantes de las regiones (BEGIN_REGION/END_REGION)
+#define MAX_REGION_DEPTH 8         // Máximo de regiones anidadas abiertas a la vez
+#define REGION_CHUNK_SIZE 1024     // Tamaño por defecto del primer bloque de una región
+
+// Métricas de fragmentación
+#define FREE_HISTOGRAM_BUCKETS 64  // Clases log2 de tamaño de bloque libre: [2^k, 2^(k+1))
+
+// Histogramas de latencia log-lineales (estilo HDR)
+#define LATENCY_SUB_BITS 5         // 2^5 = 32 subclases por potencia de 2 (error relativo < 3.2%)
+#define LATENCY_SUB_COUNT (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS (LATENCY_SUB_COUNT * (64 - LATENCY_SUB_BITS + 1))
+
+// Formatos de salida (--format)
+#define OUTPUT_TEXT 0              // Mensajes legibles en español (comportamiento original)
+#define OUTPUT_JSON 1              // Un objeto JSON por línea (JSON Lines)
+#define OUTPUT_CSV 2               // Filas CSV; la primera columna es el tipo de registro
+#define BATCH_DEFAULT_KB 64        // Tamaño por defecto del búfer de --batch
+#define OUTPUT_BUFFER_SIZE (1 << 20) // Bytes acumulados antes de escribir en la salida
+
+// Tipos de registro de la salida estructurada
+#define RECORD_RUN 0               // Configuración de la ejecución
+#define RECORD_OP 1                // Resultado de cada operación
+#define RECORD_VARIABLE 2          // Variable activa (PRINT)
+#define RECORD_BLOCK 3             // Bloque de la tabla (PRINT)
+#define RECORD_STATS 4             // Estadísticas y métricas de fragmentación
+#define RECORD_LATENCY 5           // Percentiles de latencia de un código de operación
+#define RECORD_LEAK 6              // Variable o región sin liberar al terminar
+#define RECORD_SUMMARY 7           // Resumen de ejecución (--summary)
 
 /**
- * Estructura que representa un bloque de memoria en el pool.
+ * Tabla de nombres internados: asigna a cada nombre distinto un ID de 32 bits.
  * 
- * Cada bloque puede estar libre u ocupado por una variable. Los bloques forman
- * una lista enlazada que representa la fragmentación de la memoria. Cuando un
- * bloque está libre, puede ser asignado a una nueva variable usando uno de los
- * algoritmos de asignación (First-fit, Best-fit, Worst-fit).
+ * Los IDs son consecutivos desde 0 en orden de aparición. La búsqueda usa una
+ * tabla hash de direccionamiento abierto (FNV-1a, sondeo lineal) que guarda
+ * ID + 1 en cada ranura (0 = ranura vacía).
  */
-typedef struct MemoryBlock {
-    char variable_name[MAX_NAME_LENGTH];  // Nombre de la variable que ocupa el bloque (vacío si está libre)
-    void* address;                        // Dirección de inicio del bloque en el pool
-    size_t size;                          // Tamaño del bloque en bytes
-    bool is_free;                         // Indica si el bloque está libre (true) u ocupado (false)
-    struct MemoryBlock* next;             // Puntero al siguiente bloque en la lista enlazada
-} MemoryBlock;
+typedef struct NameTable {
+    char (*names)[MAX_NAME_LENGTH]; // Nombres por ID
+    uint32_t count;                // Nombres internados
+    uint32_t capacity;             // Capacidad de 'names'
+    uint32_t* slots;               // Ranuras de la tabla hash
+    size_t slot_count;             // Número de ranuras (potencia de 2)
+} NameTable;
+
+/**
+ * Tabla de bloques del pool en forma de arreglos paralelos (struct-of-arrays).
+ * 
+ * Cada bloque puede estar libre u ocupado por una variable. Los bloques cubren
+ * el pool completo sin huecos y se guardan ordenados por dirección (el bloque
+ * i+1 empieza donde termina el i), lo que representa la fragmentación de la
+ * memoria. Cada campo vive en su propio arreglo: los algoritmos de asignación
+ * (First-fit, Best-fit, Worst-fit) recorren solo tamaños y marcas de libre de
+ * forma secuencial, y los nombres, que ninguna búsqueda lee, quedan aparte.
+ * Un bloque se identifica por su índice en la tabla.
+ */
+typedef struct BlockTable {
+    size_t* offsets;              // Desplazamiento de cada bloque desde el inicio del pool
+    size_t* sizes;                // Tamaño de cada bloque en bytes
+    bool* is_free;                // Indica si cada bloque está libre (true) u ocupado (false)
+    uint32_t* name_ids;           // ID del nombre del ocupante (NAME_ID_NONE si está libre, NAME_ID_PADDING si es relleno libre)
+    int count;                    // Número de bloques
+    int capacity;                 // Capacidad reservada de los arreglos
+} BlockTable;
+
+/**
+ * Entrada del montículo de bloques libres: tamaño y posición del bloque.
+ */
+typedef struct FreeBlockEntry {
+    size_t size;                  // Tamaño del bloque cuando se registró
+    size_t offset;                // Desplazamiento del bloque desde el inicio del pool
+} FreeBlockEntry;
+
+/**
+ * Montículo de máximos con los bloques libres, para conocer el mayor en O(1).
+ * 
+ * Se registra una entrada cada vez que un bloque libre aparece o cambia de
+ * tamaño o posición, sin borrar las anteriores. Al consultar el máximo se
+ * descartan las entradas de la cima que ya no corresponden a un bloque libre
+ * de la tabla con ese mismo tamaño (borrado perezoso). Si las entradas
+ * obsoletas se acumulan, el montículo se reconstruye desde la tabla.
+ */
+typedef struct FreeBlockHeap {
+    FreeBlockEntry* entries;      // Arreglo del montículo (la raíz es el mayor)
+    int count;                    // Entradas en uso (incluye obsoletas)
+    int capacity;                 // Capacidad reservada
+    bool dirty;                   // Reconstruir antes de la próxima consulta
+} FreeBlockHeap;
+
+/**
+ * Búfer de la salida estructurada (--format=json|csv).
+ * 
+ * Cada registro se arma en 'row' y se copia a 'data', que se escribe en el
+ * archivo solo cuando acumula OUTPUT_BUFFER_SIZE bytes (o al terminar), para
+ * que las trazas con muchos PRINT no queden limitadas por la salida estándar.
+ */
+typedef struct OutputBuffer {
+    FILE* file;                   // Archivo destino
+    int format;                   // OUTPUT_JSON u OUTPUT_CSV
+    char* data;                   // Registros pendientes de escribir
+    size_t length;                // Bytes pendientes
+    size_t capacity;              // Capacidad de 'data'
+    char* row;                    // Registro en construcción
+    size_t row_length;
+    size_t row_capacity;
+    char* header;                 // Encabezado CSV del registro en construcción
+    size_t header_length;
+    size_t header_capacity;
+    int record_type;              // Tipo del registro en construcción (RECORD_*)
+    bool needs_header;            // El registro en construcción lleva encabezado CSV
+    bool row_failed;              // No hubo memoria para completar el registro en construcción
+    unsigned headers_written;     // Tipos cuyo encabezado CSV ya se escribió (bit por tipo)
+    size_t dropped;               // Registros descartados por falta de memoria
+} OutputBuffer;
+
+/**
+ * Histograma de latencias log-lineal (estilo HDR) en nanosegundos.
+ * 
+ * Los valores menores que LATENCY_SUB_COUNT tienen una clase cada uno; por
+ * encima, cada potencia de 2 se divide en LATENCY_SUB_COUNT clases iguales,
+ * así que el error relativo está acotado sin importar la magnitud. Registrar
+ * un valor es calcular un índice y sumar uno.
+ */
+typedef struct LatencyHistogram {
+    uint64_t counts[LATENCY_BUCKETS]; // Muestras por clase
+    uint64_t total;                   // Número de muestras
+    uint64_t max;                     // Mayor latencia observada (exacta)
+} LatencyHistogram;
 
 /**
  * Estructura que representa una variable gestionada por el sistema.
  * 
- * Mantiene la información de cada variable activa: su nombre, la dirección
- * donde está almacenada en el pool de memoria, y su tamaño. Esta estructura
- * permite buscar variables rápidamente por nombre.
+ * Mantiene la información de cada variable activa: el ID de su nombre en la
+ * tabla de símbolos, la dirección donde está almacenada en el pool de memoria,
+ * y su tamaño. Buscar una variable es comparar enteros, no cadenas.
  */
 typedef struct Variable {
-    char name[MAX_NAME_LENGTH];    // Nombre único de la variable
+    uint32_t name_id;              // ID del nombre único de la variable
     void* address;                 // Dirección de la variable en el pool de memoria
     size_t size;                   // Tamaño de la variable en bytes
 } Variable;
 
+/**
+ * Región de asignación por desplazamiento abierta con BEGIN_REGION.
+ * 
+ * Ocupa uno o más bloques grandes del pool (chunks) y reparte su espacio
+ * avanzando un puntero. Sus variables viven en una tabla propia y se liberan
+ * todas juntas en END_REGION devolviendo solo los chunks.
+ */
+typedef struct Region {
+    uint32_t name_id;                // ID del nombre de la región
+    uint32_t label_id;               // ID de la etiqueta de sus bloques ("región <nombre>")
+    void** chunks;                   // Direcciones de los bloques del pool que ocupa
+    int chunk_count;                 // Número de bloques reservados
+    int chunk_capacity;              // Capacidad de 'chunks'
+    size_t chunk_size;               // Tamaño del siguiente bloque (se duplica con cada uno)
+    char* bump;                      // Siguiente byte libre del bloque actual
+    char* limit;                     // Fin del bloque actual
+    Variable* variables;             // Variables asignadas en la región (NAME_ID_NONE = liberada)
+    int variable_count;              // Entradas usadas en 'variables'
+    int variable_capacity;           // Capacidad de 'variables'
+    uint64_t epoch;                  // Número de apertura de la región (ver RegionSlot)
+    int freed;                       // Variables liberadas con FREE antes de cerrar la región
+    int peak_live;                   // Máximo de variables vivas a la vez
+    size_t allocs;                   // Asignaciones realizadas en la región
+    size_t used;                     // Bytes entregados a variables
+    size_t reserved;                 // Bytes reservados del pool (suma de chunks)
+    size_t live_bytes;               // Bytes de las variables aún vivas
+    size_t padding;                  // Relleno de alineación dentro de sus chunks
+} Region;
+
+/**
+ * Ubicación de una variable de región en el índice por ID de nombre.
+ * 
+ * La entrada solo es válida si la región en 'depth' sigue siendo la misma
+ * apertura ('epoch'); así END_REGION invalida todas sus entradas sin
+ * recorrerlas.
+ */
+typedef struct RegionSlot {
+    uint32_t position;               // Posición + 1 en 'variables' de la región (0 = no está en una región)
+    uint32_t depth;                  // Región dueña (posición en la pila de regiones)
+    uint64_t epoch;                  // Apertura de la región dueña al registrar la variable
+} RegionSlot;
+
+/**
+ * Asignación grande servida con su propio mmap (--large-threshold).
+ */
+typedef struct LargeMapping {
+    void* address;                 // Inicio del mapeo (dirección de la variable)
+    size_t length;                 // Bytes mapeados (múltiplo de la página)
+    uint32_t name_id;              // ID del nombre de la variable
+} LargeMapping;
+
+/**
+ * Tabla de asignaciones grandes ordenada por dirección.
+ * 
+ * Vive aparte de la tabla de bloques: las asignaciones grandes no recorren
+ * las políticas de búsqueda, no dividen bloques del pool ni disparan fusiones,
+ * y al liberarlas el mapeo se devuelve entero al sistema.
+ */
+typedef struct LargeTable {
+    LargeMapping* entries;         // Mapeos vivos ordenados por dirección
+    int count;                     // Mapeos vivos
+    int capacity;                  // Capacidad de 'entries'
+} LargeTable;
+
 /**
  * Estructura principal del gestor de memoria.
  * 
  * Contiene todo el estado del sistema de gestión de memoria: el pool de memoria
- * simulado, la lista de bloques (libres y ocupados), la tabla de variables
+ * simulado, la tabla de bloques (libres y ocupados), la tabla de variables
  * activas, y el algoritmo de asignación configurado.
  */
 typedef struct MemoryManager {
     void* memory_pool;           // Bloque grande de memoria solicitado al sistema operativo
     size_t pool_size;             // Tamaño total del pool de memoria en bytes
-    MemoryBlock* blocks;          // Lista enlazada de bloques (libres y ocupados)
-    Variable* variables;          // Tabla de variables activas
+    BlockTable blocks;            // Tabla de bloques (libres y ocupados) ordenada por dirección
+    NameTable symbols;            // Nombres internados de variables, regiones y etiquetas
+    Variable* variables;          // Tabla de variables en orden de asignación (NAME_ID_NONE = liberada)
     int variable_count;           // Número de variables actualmente activas
+    int variable_slots;           // Entradas usadas en 'variables' (incluye liberadas)
+    int variable_capacity;        // Capacidad de 'variables'
+    uint32_t* variable_index;     // Por ID de nombre: posición + 1 en 'variables' (0 = no asignada)
+    uint32_t variable_index_capacity; // Capacidad de 'variable_index'
+    int max_variables;            // Máximo de variables activas (0 = sin límite)
+    size_t pool_reserved;         // Espacio virtual reservado con mmap para crecer (0 = pool fijo)
+    size_t grow_chunk;            // Bytes que se agregan al pool cuando no hay bloque (0 = no crece)
+    size_t pool_grows;            // Veces que creció el pool
+    bool phantom;                 // Pool solo de metadatos: no se escribe ni se copia el contenido
+    size_t page_granule;          // Páginas que se devuelven al sistema al liberar (0 = no se devuelven)
+    bool hold_page_release;       // No devolver páginas (REALLOC aún debe copiar el bloque liberado)
+    size_t released_bytes;        // Bytes devueltos al sistema con madvise(MADV_DONTNEED)
+    uint64_t* resident_map;       // Bit por página del pool residente (NULL = se consulta con mincore)
+    size_t resident_map_pages;    // Páginas que cubre resident_map
+    size_t resident_unit;         // Tamaño de las páginas de resident_map
+    size_t resident_pages;        // Páginas marcadas en resident_map
+    size_t page_releases;         // Llamadas a madvise que devolvieron páginas
+    size_t aligned_requests;      // ALLOC/REALLOC con alineación mayor que 1
+    size_t alignment_padding;     // Bytes de relleno inicial separados para alinear (acumulado)
+    size_t padding_blocks;        // Bloques libres creados con ese relleno (acumulado)
+    size_t padding_live;          // Relleno aún sin usar: bloques de relleno libres y relleno de regiones abiertas
+    size_t padding_live_blocks;   // Bloques de relleno que siguen libres sin fusionarse ni reutilizarse
+    size_t header_size;           // Cabecera dentro de cada bloque (0 = sin etiquetas en el pool)
+    size_t tag_hold_from;         // Inicio del bloque que REALLOC aún debe copiar (no escribir etiquetas)
+    size_t tag_hold_to;           // Fin (exclusivo) de ese bloque; igual a tag_hold_from si no hay
+    size_t large_threshold;       // Solicitudes desde este tamaño van a su propio mmap (0 = nunca)
+    LargeTable large;             // Asignaciones grandes vivas
+    size_t large_allocs;          // Asignaciones servidas con mmap directo
+    size_t large_bytes;           // Bytes mapeados por las asignaciones grandes vivas
+    size_t large_requested;       // Bytes pedidos por las asignaciones grandes vivas
     int allocation_algorithm;     // Algoritmo de asignación: 0=First-fit, 1=Best-fit, 2=Worst-fit
+    int coalesce_mode;            // Modo de fusión: COALESCE_EAGER o COALESCE_DEFERRED
+    int coalesce_interval;        // En modo diferido: fusionar cada N liberaciones (0 = solo bajo demanda)
+    int pending_frees;            // Liberaciones aún no fusionadas desde la última pasada
+    size_t merge_passes;          // Número de pasadas de fusión ejecutadas
+    int free_block_count;         // Número actual de bloques libres en la tabla
+    size_t free_bytes;            // Bytes en bloques libres (se actualiza en cada cambio de bloque)
+    FreeBlockHeap largest_free;   // Montículo para obtener el mayor bloque libre
+    int free_histogram[FREE_HISTOGRAM_BUCKETS]; // Bloques libres por clase log2 de tamaño
+    size_t requested_bytes;       // Bytes pedidos por las variables vivas (incluye regiones)
+    size_t high_water;            // Mayor desplazamiento ocupado alguna vez (marca de agua)
+    int metrics_interval;         // Imprimir métricas de fragmentación cada N operaciones (0 = nunca)
+    size_t executed_ops;          // Operaciones ejecutadas con execute_op
+    size_t op_counts[OP_COUNT];   // Operaciones ejecutadas por código
+    size_t op_failures[OP_COUNT]; // Operaciones fallidas por código
+    bool quiet;                   // No imprimir el mensaje de cada ALLOC/REALLOC/FREE/región
+    bool mute_errors;             // No imprimir los errores de las operaciones (solo contarlos)
+    LatencyHistogram* latency;    // Latencias por código de operación (se crea con la primera)
+    uint64_t message_nanos;       // Tiempo de imprimir mensajes en la operación actual (no cuenta como latencia)
+    OutputBuffer* output;         // Salida estructurada (NULL = mensajes de texto)
+    int peak_free_blocks;         // Máximo de bloques libres observado (pico de fragmentación)
+    double peak_external_fragmentation; // Mayor fragmentación externa tras una operación del heap
+    bool thread_safe;             // Si es true, las operaciones del heap central toman 'lock'
+    pthread_mutex_t lock;         // Protege la tabla de bloques en modo multihilo
+    bool owns_pool;               // false si el pool es una porción de otro (arena)
+    _Atomic(struct RemoteFree*) remote_head; // Pila sin locks de bloques liberados por otros hilos
+    atomic_size_t remote_received; // Total de liberaciones remotas recibidas
+    Region* regions;              // Pila de regiones abiertas (se crea con la primera)
+    int region_depth;             // Número de regiones abiertas
+    uint64_t region_epoch;        // Regiones abiertas desde el inicio (numera cada apertura)
+    RegionSlot* region_index;     // Por ID de nombre: variable de una región abierta
+    uint32_t region_index_capacity; // Capacidad de 'region_index'
 } MemoryManager;
 
 /**
- * Inicializa un nuevo gestor de memoria con el tamaño y algoritmo especificados.
+ * Operación de una traza ya interpretada.
  * 
- * Reserva memoria para la estructura del gestor, crea el pool de memoria del
- * tamaño solicitado, inicializa la tabla de variables, y crea el bloque libre
- * inicial que ocupa todo el pool. Configura el algoritmo de asignación a usar.
+ * Permite separar el parsing de la ejecución: una traza se puede leer una vez
+ * y reproducir después tantas veces como se quiera (por ejemplo, desde varios
+ * hilos) sin volver a tocar el texto.
+ */
+typedef struct TraceOp {
+    uint16_t opcode;               // OP_ALLOC, OP_REALLOC, OP_FREE, OP_PRINT, OP_STATS, OP_LATENCY, OP_*_REGION u OP_NONE
+    uint16_t align_shift;          // log2 de la alineación pedida en ALLOC/REALLOC (0 = sin alineación)
+    uint32_t name_id;              // ID del nombre de la variable o región (NAME_ID_NONE para PRINT)
+    size_t size;                   // Tamaño solicitado (ALLOC/REALLOC/BEGIN_REGION)
+} TraceOp;
+
+/**
+ * Traza completa cargada en memoria como arreglo dinámico de operaciones.
+ */
+typedef struct Trace {
+    TraceOp* ops;                  // Operaciones en orden de aparición
+    NameTable names;               // Nombres internados al cargar la traza
+    size_t count;                  // Número de operaciones cargadas
+    size_t capacity;               // Capacidad reservada del arreglo
+} Trace;
+
+/**
+ * Devuelve el instante actual de un reloj monótono en segundos.
+ *
+ * @return Segundos transcurridos desde un origen arbitrario pero fijo
+ */
+double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * Devuelve el tiempo de CPU consumido por el hilo que llama, en segundos.
+ *
+ * A diferencia del reloj monótono no avanza mientras el hilo espera la CPU,
+ * así que mide el costo de un hilo aunque compita con otros por los núcleos.
+ *
+ * @return Segundos de CPU del hilo actual
+ */
+double thread_cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * Devuelve el instante actual del reloj monótono en nanosegundos.
+ *
+ * Se usa para medir la latencia de cada operación; en Linux clock_gettime
+ * con CLOCK_MONOTONIC se resuelve en espacio de usuario (vDSO), sin llamada
+ * al sistema.
+ *
+ * @return Nanosegundos transcurridos desde un origen arbitrario pero fijo
+ */
+uint64_t monotonic_nanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Nombres de los tipos de registro (índice RECORD_*)
+const char* const record_type_names[] = {
+    "run", "op", "variable", "block", "stats", "latency", "leak", "summary"
+};
+
+// Nombres de los códigos de operación (índice OP_*)
+const char* const opcode_names[OP_COUNT] = {
+    "NONE", "ALLOC", "REALLOC", "FREE", "PRINT", "BEGIN_REGION", "END_REGION", "STATS", "LATENCY"
+};
+
+// Códigos de operación que modifican el heap: los que miden LATENCY y --summary
+const bool latency_reported_ops[OP_COUNT] = {
+    [OP_ALLOC] = true, [OP_REALLOC] = true, [OP_FREE] = true,
+    [OP_BEGIN_REGION] = true, [OP_END_REGION] = true
+};
+
+/**
+ * Crea el búfer de salida estructurada sobre un archivo.
  * 
- * @param pool_size Tamaño en bytes del pool de memoria a crear
- * @param algorithm Algoritmo de asignación: 0=First-fit, 1=Best-fit, 2=Worst-fit
- * @return Puntero al gestor de memoria inicializado, o NULL si hubo error
+ * @param file Archivo destino (normalmente stdout)
+ * @param format OUTPUT_JSON u OUTPUT_CSV
+ * @return Búfer creado, o NULL si no hubo memoria
  */
-MemoryManager* init_memory_manager(size_t pool_size, int algorithm) {
-    MemoryManager* mm = (MemoryManager*)malloc(sizeof(MemoryManager));
-    if (!mm) {
-        fprintf(stderr, "Error: No se pudo asignar memoria para el gestor\n");
+OutputBuffer* output_create(FILE* file, int format) {
+    OutputBuffer* out = (OutputBuffer*)calloc(1, sizeof(OutputBuffer));
+    if (!out) {
+        fprintf(stderr, "Error: No hay memoria para el búfer de salida\n");
         return NULL;
     }
-    
-    mm->memory_pool = malloc(pool_size);
-    if (!mm->memory_pool) {
-        fprintf(stderr, "Error: No se pudo asignar el bloque de memoria principal\n");
-        free(mm);
+    out->data = (char*)malloc(OUTPUT_BUFFER_SIZE);
+    if (!out->data) {
+        fprintf(stderr, "Error: No hay memoria para el búfer de salida\n");
+        free(out);
         return NULL;
     }
-    
-    mm->pool_size = pool_size;
-    mm->blocks = NULL;
-    mm->variables = (Variable*)calloc(MAX_VARIABLES, sizeof(Variable));
-    mm->variable_count = 0;
-    mm->allocation_algorithm = algorithm;
-    
-    // Inicializar el bloque libre principal
-    MemoryBlock* free_block = (MemoryBlock*)malloc(sizeof(MemoryBlock));
-    strcpy(free_block->variable_name, "");
-    free_block->address = mm->memory_pool;
-    free_block->size = pool_size;
-    free_block->is_free = true;
-    free_block->next = NULL;
-    mm->blocks = free_block;
-    
-    return mm;
+    out->capacity = OUTPUT_BUFFER_SIZE;
+    out->file = file;
+    out->format = format;
+    return out;
 }
 
 /**
- * Libera todos los recursos asociados al gestor de memoria.
+ * Escribe en el archivo todo lo acumulado en el búfer.
  * 
- * Recorre la lista de bloques liberando cada nodo, libera el pool de memoria,
- * la tabla de variables, y finalmente la estructura del gestor. Esta función
- * debe llamarse al finalizar el uso del gestor para evitar fugas de memoria.
+ * @param out Búfer de salida
+ */
+void output_flush(OutputBuffer* out) {
+    if (out->length > 0) {
+        fwrite(out->data, 1, out->length, out->file);
+        out->length = 0;
+    }
+    fflush(out->file);
+}
+
+/**
+ * Vacía el búfer y libera sus recursos.
  * 
- * @param mm Puntero al gestor de memoria a destruir (puede ser NULL)
+ * @param out Búfer de salida (puede ser NULL)
  */
-void destroy_memory_manager(MemoryManager* mm) {
-    if (!mm) return;
-    
-    // Liberar todos los bloques
-    MemoryBlock* current = mm->blocks;
-    while (current) {
-        MemoryBlock* next = current->next;
-        free(current);
-        current = next;
+void output_destroy(OutputBuffer* out) {
+    if (!out) return;
+    output_flush(out);
+    if (out->dropped > 0) {
+        fprintf(stderr, "Error: Se descartaron %zu registros de salida por falta de memoria\n", out->dropped);
     }
-    
-    free(mm->variables);
-    free(mm->memory_pool);
-    free(mm);
+    free(out->data);
+    free(out->row);
+    free(out->header);
+    free(out);
 }
 
 /**
- * Busca una variable en la tabla de variables por su nombre.
+ * Asegura espacio para agregar bytes a una cadena creciente.
  * 
- * Recorre la tabla de variables activas buscando una cuyo nombre coincida
- * exactamente con el proporcionado. La búsqueda es case-sensitive y requiere
- * coincidencia exacta.
+ * @param data Cadena (se realoja si hace falta)
+ * @param length Longitud actual
+ * @param capacity Capacidad actual
+ * @param count Número de bytes que se van a agregar
+ * @return true si hay espacio, false si no hay memoria (la cadena no cambia)
+ */
+bool text_reserve(char** data, size_t length, size_t* capacity, size_t count) {
+    if (length + count <= *capacity) {
+        return true;
+    }
+    size_t new_capacity = *capacity ? *capacity : 256;
+    while (new_capacity < length + count) {
+        new_capacity *= 2;
+    }
+    char* grown = (char*)realloc(*data, new_capacity);
+    if (!grown) {
+        return false;
+    }
+    *data = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+/**
+ * Agrega bytes a una cadena creciente (fila o encabezado en construcción).
  * 
- * @param mm Puntero al gestor de memoria
- * @param name Nombre de la variable a buscar
- * @return Puntero a la estructura Variable si se encuentra, NULL si no existe
+ * @param data Cadena (se realoja si hace falta)
+ * @param length Longitud actual
+ * @param capacity Capacidad actual
+ * @param text Bytes a agregar
+ * @param count Número de bytes
+ * @return true si se agregaron, false si no hay memoria (la cadena no cambia)
  */
-Variable* find_variable(MemoryManager* mm, const char* name) {
-    for (int i = 0; i < mm->variable_count; i++) {
-        if (strcmp(mm->variables[i].name, name) == 0) {
-            return &mm->variables[i];
-        }
+bool text_append(char** data, size_t* length, size_t* capacity, const char* text, size_t count) {
+    if (!text_reserve(data, *length, capacity, count)) {
+        return false;
     }
-    return NULL;
+    memcpy(*data + *length, text, count);
+    *length += count;
+    return true;
 }
 
 /**
- * Encuentra el primer bloque libre que tenga suficiente espacio.
+ * Agrega bytes a la fila del registro en construcción.
  * 
- * Recorre la lista enlazada de bloques buscando el primer bloque que esté libre
- * y tenga un tamaño mayor o igual al solicitado. Esta es la base para el
- * algoritmo First-fit.
+ * Si no hay memoria marca el registro como fallido: record_end lo descarta
+ * entero y lo reporta en vez de escribir una fila incompleta.
  * 
- * @param mm Puntero al gestor de memoria
- * @param size Tamaño mínimo requerido en bytes
- * @return Puntero al primer bloque libre que cumple, NULL si no hay ninguno
+ * @param out Búfer de salida
+ * @param text Bytes a agregar
+ * @param count Número de bytes
  */
-MemoryBlock* find_free_block(MemoryManager* mm, size_t size) {
-    MemoryBlock* current = mm->blocks;
-    while (current) {
-        if (current->is_free && current->size >= size) {
-            return current;
-        }
-        current = current->next;
+void row_append(OutputBuffer* out, const char* text, size_t count) {
+    if (!text_append(&out->row, &out->row_length, &out->row_capacity, text, count)) {
+        out->row_failed = true;
     }
-    return NULL;
 }
 
 /**
- * Algoritmo First-fit: encuentra el primer bloque libre que pueda satisfacer la solicitud.
+ * Agrega bytes al encabezado CSV del registro en construcción.
  * 
- * Busca secuencialmente en la lista de bloques y selecciona el primer bloque
- * libre que tenga suficiente espacio. Es rápido pero puede generar más
- * fragmentación que otros algoritmos.
+ * @param out Búfer de salida
+ * @param text Bytes a agregar
+ * @param count Número de bytes
+ */
+void header_append(OutputBuffer* out, const char* text, size_t count) {
+    if (!text_append(&out->header, &out->header_length, &out->header_capacity, text, count)) {
+        out->row_failed = true;
+    }
+}
+
+/**
+ * Agrega texto a la fila del registro en construcción.
  * 
- * @param mm Puntero al gestor de memoria
- * @param size Tamaño requerido en bytes
- * @return Puntero al bloque seleccionado, NULL si no hay espacio suficiente
+ * @param out Búfer de salida
+ * @param text Texto terminado en '\0'
  */
-MemoryBlock* first_fit(MemoryManager* mm, size_t size) {
-    return find_free_block(mm, size);
+void record_append(OutputBuffer* out, const char* text) {
+    row_append(out, text, strlen(text));
 }
 
 /**
- * Algoritmo Best-fit: encuentra el bloque libre más pequeño que pueda satisfacer la solicitud.
+ * Comienza un registro del tipo indicado.
  * 
- * Recorre todos los bloques libres y selecciona el que tenga el tamaño más
- * cercano (pero mayor o igual) al solicitado. Minimiza el desperdicio de
- * memoria pero requiere recorrer toda la lista, siendo más lento.
+ * En JSON cada registro es un objeto en su propia línea (JSON Lines) con el
+ * campo "type"; en CSV es una fila cuya primera columna es el tipo, precedida
+ * la primera vez por una fila de encabezado "#<tipo>,<campo>,...".
  * 
- * @param mm Puntero al gestor de memoria
- * @param size Tamaño requerido en bytes
- * @return Puntero al bloque seleccionado, NULL si no hay espacio suficiente
+ * @param out Búfer de salida
+ * @param type Tipo de registro (RECORD_*)
  */
-MemoryBlock* best_fit(MemoryManager* mm, size_t size) {
-    MemoryBlock* best = NULL;
-    MemoryBlock* current = mm->blocks;
-    
-    while (current) {
-        if (current->is_free && current->size >= size) {
-            if (!best || current->size < best->size) {
-                best = current;
-            }
+void record_begin(OutputBuffer* out, int type) {
+    out->record_type = type;
+    out->row_length = 0;
+    out->header_length = 0;
+    out->row_failed = false;
+    out->needs_header = out->format == OUTPUT_CSV && !(out->headers_written & (1u << type));
+    if (out->format == OUTPUT_JSON) {
+        record_append(out, "{\"type\":\"");
+        record_append(out, record_type_names[type]);
+        record_append(out, "\"");
+    } else {
+        record_append(out, record_type_names[type]);
+        if (out->needs_header) {
+            header_append(out, "#", 1);
+            header_append(out, record_type_names[type], strlen(record_type_names[type]));
         }
-        current = current->next;
     }
-    
-    return best;
 }
 
 /**
- * Algoritmo Worst-fit: encuentra el bloque libre más grande disponible.
+ * Agrega el separador y el nombre de un campo (en JSON, en la fila; en CSV,
+ * en el encabezado si el registro lo lleva).
  * 
- * Recorre todos los bloques libres y selecciona el de mayor tamaño que pueda
- * satisfacer la solicitud. Deja bloques grandes libres que pueden ser útiles
- * para futuras asignaciones grandes, pero puede generar más fragmentación.
+ * @param out Búfer de salida
+ * @param key Nombre del campo
+ */
+void record_key(OutputBuffer* out, const char* key) {
+    size_t key_length = strlen(key);
+    row_append(out, ",", 1);
+    if (out->format == OUTPUT_JSON) {
+        row_append(out, "\"", 1);
+        row_append(out, key, key_length);
+        row_append(out, "\":", 2);
+    } else if (out->needs_header) {
+        header_append(out, ",", 1);
+        header_append(out, key, key_length);
+    }
+}
+
+/**
+ * Agrega un campo con su valor ya formateado.
  * 
- * @param mm Puntero al gestor de memoria
- * @param size Tamaño requerido en bytes
- * @return Puntero al bloque seleccionado, NULL si no hay espacio suficiente
+ * @param out Búfer de salida
+ * @param key Nombre del campo
+ * @param value Valor formateado (en JSON, ya con comillas si es cadena)
  */
-MemoryBlock* worst_fit(MemoryManager* mm, size_t size) {
-    MemoryBlock* worst = NULL;
-    MemoryBlock* current = mm->blocks;
-    
-    while (current) {
-        if (current->is_free && current->size >= size) {
-            if (!worst || current->size > worst->size) {
-                worst = current;
-            }
+void record_raw(OutputBuffer* out, const char* key, const char* value) {
+    record_key(out, key);
+    row_append(out, value, strlen(value));
+}
+
+/**
+ * Agrega un campo de texto, escapándolo según el formato.
+ * 
+ * El valor se escapa directamente en la fila, que se agranda de antemano
+ * para el peor caso (cada byte como \u00XX), así que no se trunca.
+ * 
+ * @param out Búfer de salida
+ * @param key Nombre del campo
+ * @param value Texto del campo
+ */
+void record_string(OutputBuffer* out, const char* key, const char* value) {
+    record_key(out, key);
+    size_t length = strlen(value);
+    if (length > (SIZE_MAX - 2) / 6 ||
+        !text_reserve(&out->row, out->row_length, &out->row_capacity, 6 * length + 2)) {
+        out->row_failed = true;
+        return;
+    }
+    char* escaped = out->row + out->row_length;
+    size_t n = 0;
+    bool quote = out->format == OUTPUT_JSON || strpbrk(value, ",\"\n") != NULL;
+    if (quote) escaped[n++] = '"';
+    for (const char* p = value; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (out->format == OUTPUT_JSON && (c == '"' || c == '\\')) {
+            escaped[n++] = '\\';
+            escaped[n++] = (char)c;
+        } else if (out->format == OUTPUT_JSON && c < 0x20) {
+            static const char hex[] = "0123456789abcdef";
+            memcpy(escaped + n, "\\u00", 4);
+            escaped[n + 4] = hex[c >> 4];
+            escaped[n + 5] = hex[c & 0xf];
+            n += 6;
+        } else if (c == '"') {
+            escaped[n++] = '"';
+            escaped[n++] = '"';
+        } else {
+            escaped[n++] = (char)c;
         }
-        current = current->next;
     }
-    
-    return worst;
+    if (quote) escaped[n++] = '"';
+    out->row_length += n;
 }
 
 /**
- * Selecciona un bloque libre usando el algoritmo configurado en el gestor.
+ * Agrega un campo entero sin signo.
  * 
- * Llama al algoritmo de asignación correspondiente según el valor de
- * allocation_algorithm en el gestor. Si el valor no es válido, usa First-fit
- * por defecto.
+ * @param out Búfer de salida
+ * @param key Nombre del campo
+ * @param value Valor
+ */
+void record_size(OutputBuffer* out, const char* key, size_t value) {
+    // Conversión directa a decimal (snprintf domina el costo con millones de registros)
+    char text[32];
+    char* p = text + sizeof(text) - 1;
+    *p = '\0';
+    do {
+        *--p = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    record_raw(out, key, p);
+}
+
+/**
+ * Agrega un campo numérico con decimales.
  * 
- * @param mm Puntero al gestor de memoria
- * @param size Tamaño requerido en bytes
- * @return Puntero al bloque seleccionado, NULL si no hay espacio suficiente
+ * @param out Búfer de salida
+ * @param key Nombre del campo
+ * @param value Valor
  */
-MemoryBlock* select_block(MemoryManager* mm, size_t size) {
-    switch (mm->allocation_algorithm) {
-        case 0: return first_fit(mm, size);
-        case 1: return best_fit(mm, size);
-        case 2: return worst_fit(mm, size);
-        default: return first_fit(mm, size);
+void record_double(OutputBuffer* out, const char* key, double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.6g", value);
+    record_raw(out, key, text);
+}
+
+/**
+ * Agrega un campo booleano (true/false en JSON, 1/0 en CSV).
+ * 
+ * @param out Búfer de salida
+ * @param key Nombre del campo
+ * @param value Valor
+ */
+void record_bool(OutputBuffer* out, const char* key, bool value) {
+    if (out->format == OUTPUT_JSON) {
+        record_raw(out, key, value ? "true" : "false");
+    } else {
+        record_raw(out, key, value ? "1" : "0");
     }
 }
 
 /**
- * Divide un bloque si es más grande que el tamaño necesario.
+ * Pasa bytes al búfer de salida.
  * 
- * Si el bloque tiene más espacio del requerido, crea un nuevo bloque libre
- * con el espacio sobrante y lo inserta después del bloque actual en la lista.
- * Esto permite reutilizar el espacio sobrante en futuras asignaciones.
+ * Si el búfer no puede crecer, escribe lo acumulado y después los bytes
+ * directamente en el archivo, así que nunca se pierden.
  * 
- * @param block Puntero al bloque a dividir
- * @param size Tamaño que se necesita del bloque (el resto se convierte en bloque libre)
+ * @param out Búfer de salida
+ * @param text Bytes a escribir
+ * @param count Número de bytes
  */
-void split_block(MemoryBlock* block, size_t size) {
-    if (block->size > size) {
-        MemoryBlock* new_block = (MemoryBlock*)malloc(sizeof(MemoryBlock));
-        new_block->address = (char*)block->address + size;
-        new_block->size = block->size - size;
-        new_block->is_free = true;
-        strcpy(new_block->variable_name, "");
-        new_block->next = block->next;
-        block->next = new_block;
-        block->size = size;
+void output_write(OutputBuffer* out, const char* text, size_t count) {
+    if (!text_append(&out->data, &out->length, &out->capacity, text, count)) {
+        fwrite(out->data, 1, out->length, out->file);
+        out->length = 0;
+        fwrite(text, 1, count, out->file);
     }
 }
 
 /**
- * Fusiona bloques libres que sean adyacentes en memoria.
- * 
- * Recorre la lista de bloques y cuando encuentra dos bloques libres consecutivos
- * que son adyacentes en memoria (el final de uno coincide con el inicio del otro),
- * los fusiona en un solo bloque libre más grande. Esto reduce la fragmentación
- * y facilita futuras asignaciones grandes.
+ * Termina el registro y lo pasa al búfer, que se escribe cuando se llena.
  * 
- * @param mm Puntero al gestor de memoria
+ * @param out Búfer de salida
  */
-void merge_free_blocks(MemoryManager* mm) {
-    MemoryBlock* current = mm->blocks;
-    while (current && current->next) {
-        if (current->is_free && current->next->is_free) {
-            // Verificar si son adyacentes
-            void* end_current = (char*)current->address + current->size;
-            if (end_current == current->next->address) {
-                // Fusionar bloques
-                current->size += current->next->size;
-                MemoryBlock* to_remove = current->next;
-                current->next = to_remove->next;
-                free(to_remove);
-            } else {
-                current = current->next;
-            }
-        } else {
-            current = current->next;
+void record_end(OutputBuffer* out) {
+    if (out->format == OUTPUT_JSON) {
+        record_append(out, "}");
+    } else if (out->needs_header) {
+        header_append(out, "\n", 1);
+    }
+    record_append(out, "\n");
+    if (out->row_failed) {
+        if (out->dropped++ == 0) {
+            fprintf(stderr, "Error: No hay memoria para un registro de salida; se descarta entero\n");
         }
+        return;
+    }
+    if (out->needs_header) {
+        out->headers_written |= 1u << out->record_type;
+        output_write(out, out->header, out->header_length);
+    }
+    output_write(out, out->row, out->row_length);
+    if (out->length >= OUTPUT_BUFFER_SIZE) {
+        fwrite(out->data, 1, out->length, out->file);
+        out->length = 0;
     }
 }
 
 /**
- * Asigna memoria para una nueva variable.
+ * Imprime el mensaje de texto de una operación (solo en formato de texto).
  * 
- * Valida que la variable no exista, que no se haya alcanzado el límite de
- * variables, y que haya suficiente memoria disponible. Usa el algoritmo
- * configurado para seleccionar un bloque libre, lo divide si es necesario,
- * y llena la memoria asignada con el nombre de la variable repetido. Registra
- * la variable en la tabla de variables.
+ * Con --format=json|csv el resultado de cada operación se emite como
+ * registro desde execute_op, así que los mensajes se omiten. El tiempo de
+ * formatear e imprimir se acumula en message_nanos para que execute_op lo
+ * descuente de la latencia de la operación.
  * 
  * @param mm Puntero al gestor de memoria
- * @param var_name Nombre único de la variable a crear
- * @param size Tamaño en bytes a asignar
- * @return true si la asignación fue exitosa, false en caso de error
+ * @param format Formato de printf
  */
-bool alloc_memory(MemoryManager* mm, const char* var_name, size_t size) {
-    // Verificar si la variable ya existe
-    if (find_variable(mm, var_name)) {
-        fprintf(stderr, "Error: La variable '%s' ya existe\n", var_name);
-        return false;
-    }
-
-    // Validar capacidad de la tabla de variables ANTES de modificar bloques
-    if (mm->variable_count >= MAX_VARIABLES) {
-            fprintf(stderr, "Error: Se alcanzó el límite de variables\n");
-            return false;
-        }
-    
-    // Seleccionar bloque según el algoritmo
-    MemoryBlock* block = select_block(mm, size);
-    if (!block) {
-        fprintf(stderr, "Error: No hay suficiente memoria para asignar %zu bytes a '%s'\n", size, var_name);
-        return false;
-    }
-    
-    // Asignar el bloque
-    block->is_free = false;
-    strcpy(block->variable_name, var_name);
-    
-    // Dividir el bloque si es necesario
-    split_block(block, size);
-    
-    // Agregar a la tabla de variables (ya validado el límite)
-    Variable* var = &mm->variables[mm->variable_count];
-    strcpy(var->name, var_name);
-    var->address = block->address;
-    var->size = size;
-    mm->variable_count++;
-    
-    // Llenar toda la memoria con el nombre de la variable (repetido)
-    size_t name_len = strlen(var_name);
-    if (name_len > 0) {
-        for (size_t i = 0; i < size; i++) {
-            ((char*)block->address)[i] = var_name[i % name_len];
-        }
-    } else {
-        memset(block->address, 0, size);
+void op_message(MemoryManager* mm, const char* format, ...) {
+    if (mm->output || mm->quiet) {
+        return;
     }
-    
-    printf("ALLOC: Variable '%s' asignada con %zu bytes\n", var_name, size);
-    return true;
+    uint64_t start = monotonic_nanos();
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    mm->message_nanos += monotonic_nanos() - start;
 }
 
 /**
- * Redimensiona una variable existente.
+ * Imprime el error de una operación por la salida de error.
  * 
- * Si el nuevo tamaño es menor, reduce el bloque y crea un bloque libre con
- * el espacio sobrante. Si es mayor, intenta expandir el bloque en el lugar si
- * hay un bloque libre adyacente. Si no es posible expandir en el lugar,
- * busca un nuevo bloque más grande, copia los datos, y libera el bloque anterior.
- * En todos los casos, rellena la memoria con el nombre de la variable.
+ * Con mute_errors solo se cuenta la falla (execute_op la registra en
+ * op_failures): lo usa --compare, donde varios hilos reproducen la misma
+ * traza y sus mensajes se intercalarían. Como en op_message, el tiempo de
+ * imprimir no cuenta como latencia de la operación.
  * 
  * @param mm Puntero al gestor de memoria
- * @param var_name Nombre de la variable a redimensionar
- * @param new_size Nuevo tamaño en bytes
- * @return true si el redimensionamiento fue exitoso, false en caso de error
+ * @param format Formato de printf
  */
-bool realloc_memory(MemoryManager* mm, const char* var_name, size_t new_size) {
-    Variable* var = find_variable(mm, var_name);
-    if (!var) {
-        fprintf(stderr, "Error: La variable '%s' no existe\n", var_name);
-        return false;
+void op_error(MemoryManager* mm, const char* format, ...) {
+    if (mm->mute_errors) {
+        return;
     }
-    
-    // Buscar el bloque asociado
-    MemoryBlock* block = mm->blocks;
-    while (block) {
-        if (block->address == var->address && !block->is_free) {
-            break;
-        }
-        block = block->next;
+    uint64_t start = monotonic_nanos();
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    mm->message_nanos += monotonic_nanos() - start;
+}
+
+/**
+ * Calcula el hash FNV-1a de un nombre.
+ * 
+ * @param name Nombre terminado en '\0'
+ * @return Hash de 32 bits
+ */
+uint32_t hash_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
     }
-    
-    if (!block) {
-        fprintf(stderr, "Error: No se encontró el bloque para '%s'\n", var_name);
-        return false;
+    return hash;
+}
+
+/**
+ * Inicializa una tabla de nombres vacía.
+ * 
+ * @param table Tabla a inicializar
+ */
+void name_table_init(NameTable* table) {
+    table->names = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    table->slots = NULL;
+    table->slot_count = 0;
+}
+
+/**
+ * Libera la memoria de una tabla de nombres.
+ * 
+ * @param table Tabla a liberar
+ */
+void name_table_free(NameTable* table) {
+    free(table->names);
+    free(table->slots);
+    name_table_init(table);
+}
+
+/**
+ * Busca el ID de un nombre ya internado.
+ * 
+ * @param table Tabla de nombres
+ * @param name Nombre a buscar
+ * @return ID del nombre, o NAME_ID_NONE si no está en la tabla
+ */
+uint32_t name_table_find(const NameTable* table, const char* name) {
+    if (table->slot_count == 0) {
+        return NAME_ID_NONE;
     }
-    
-    size_t old_size = var->size;
-    
-    if (new_size <= old_size) {
-        // Reducir el tamaño
-        if (block->size > new_size) {
-            // Crear un nuevo bloque libre con el espacio sobrante
-            MemoryBlock* free_block = (MemoryBlock*)malloc(sizeof(MemoryBlock));
-            free_block->address = (char*)block->address + new_size;
-            free_block->size = block->size - new_size;
-            free_block->is_free = true;
-            strcpy(free_block->variable_name, "");
-            free_block->next = block->next;
-            block->next = free_block;
-            block->size = new_size;
-            merge_free_blocks(mm);
+    size_t mask = table->slot_count - 1;
+    for (size_t i = hash_name(name) & mask; table->slots[i] != 0; i = (i + 1) & mask) {
+        uint32_t id = table->slots[i] - 1;
+        if (strcmp(table->names[id], name) == 0) {
+            return id;
         }
-        var->size = new_size;
-       // --- NUEVO: Rellenar TODO el bloque resultante con el nombre de la variable ---
-        // La consigna exige que en REALLOC se rellene toda la memoria con el nombre.
-        // Aunque la región "cabeza" ya estaba llena, lo garantizamos explícitamente.
-        size_t name_len = strlen(var_name);
-        if (name_len > 0) {
-            for (size_t i = 0; i < new_size; i++) {
-                ((char*)block->address)[i] = var_name[i % name_len];
+    }
+    return NAME_ID_NONE;
+}
+
+/**
+ * Devuelve el ID de un nombre, internándolo si es la primera vez que aparece.
+ * 
+ * @param table Tabla de nombres
+ * @param name Nombre (se trunca a MAX_NAME_LENGTH - 1 caracteres)
+ * @return ID del nombre, o NAME_ID_NONE si no hay memoria
+ */
+uint32_t name_table_intern(NameTable* table, const char* name) {
+    uint32_t id = name_table_find(table, name);
+    if (id != NAME_ID_NONE) {
+        return id;
+    }
+
+    if (table->count == table->capacity) {
+        uint32_t capacity = table->capacity ? table->capacity * 2 : 64;
+        char (*names)[MAX_NAME_LENGTH] = realloc(table->names, (size_t)capacity * MAX_NAME_LENGTH);
+        if (!names) {
+            return NAME_ID_NONE;
+        }
+        table->names = names;
+        table->capacity = capacity;
+    }
+
+    // Mantener la carga de la tabla hash por debajo del 50%
+    if ((size_t)(table->count + 1) * 2 > table->slot_count) {
+        size_t slot_count = table->slot_count ? table->slot_count * 2 : 128;
+        uint32_t* slots = (uint32_t*)calloc(slot_count, sizeof(uint32_t));
+        if (!slots) {
+            return NAME_ID_NONE;
+        }
+        for (uint32_t i = 0; i < table->count; i++) {
+            size_t j = hash_name(table->names[i]) & (slot_count - 1);
+            while (slots[j] != 0) {
+                j = (j + 1) & (slot_count - 1);
             }
+            slots[j] = i + 1;
+        }
+        free(table->slots);
+        table->slots = slots;
+        table->slot_count = slot_count;
+    }
+
+    id = table->count++;
+    memset(table->names[id], 0, MAX_NAME_LENGTH);
+    snprintf(table->names[id], MAX_NAME_LENGTH, "%s", name);
+    size_t mask = table->slot_count - 1;
+    size_t i = hash_name(table->names[id]) & mask;
+    while (table->slots[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    table->slots[i] = id + 1;
+    return id;
+}
+
+/**
+ * Devuelve el nombre asociado a un ID.
+ * 
+ * @param table Tabla de nombres
+ * @param id ID devuelto por name_table_intern
+ * @return Nombre, o "" para NAME_ID_NONE
+ */
+const char* name_table_get(const NameTable* table, uint32_t id) {
+    return id == NAME_ID_NONE ? "" : table->names[id];
+}
+
+/**
+ * Asegura capacidad en la tabla de bloques para al menos 'count' bloques.
+ * 
+ * Los arreglos crecen al doble para que las inserciones cuesten O(1)
+ * amortizado en memoria (el desplazamiento de la cola es un memmove).
+ * 
+ * @param table Tabla de bloques
+ * @param count Número de bloques que debe poder guardar
+ * @return true si hay capacidad, false si no hubo memoria
+ */
+bool block_table_reserve(BlockTable* table, int count) {
+    if (count <= table->capacity) {
+        return true;
+    }
+    int capacity = table->capacity ? table->capacity : 64;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    size_t* offsets = (size_t*)realloc(table->offsets, (size_t)capacity * sizeof(size_t));
+    if (offsets) table->offsets = offsets;
+    size_t* sizes = (size_t*)realloc(table->sizes, (size_t)capacity * sizeof(size_t));
+    if (sizes) table->sizes = sizes;
+    bool* is_free = (bool*)realloc(table->is_free, (size_t)capacity * sizeof(bool));
+    if (is_free) table->is_free = is_free;
+    uint32_t* name_ids = (uint32_t*)realloc(table->name_ids, (size_t)capacity * sizeof(uint32_t));
+    if (name_ids) table->name_ids = name_ids;
+    if (!offsets || !sizes || !is_free || !name_ids) {
+        fprintf(stderr, "Error: No hay memoria para la tabla de bloques\n");
+        return false;
+    }
+    table->capacity = capacity;
+    return true;
+}
+
+/**
+ * Inicializa la tabla de bloques con un único bloque libre que cubre el pool.
+ * 
+ * @param table Tabla a inicializar
+ * @param pool_size Tamaño del pool en bytes
+ * @return true si la tabla se creó, false si no hubo memoria
+ */
+bool block_table_init(BlockTable* table, size_t pool_size) {
+    memset(table, 0, sizeof(*table));
+    if (!block_table_reserve(table, 1)) {
+        return false;
+    }
+    table->offsets[0] = 0;
+    table->sizes[0] = pool_size;
+    table->is_free[0] = true;
+    table->name_ids[0] = NAME_ID_NONE;
+    table->count = 1;
+    return true;
+}
+
+/**
+ * Libera los arreglos de la tabla de bloques.
+ * 
+ * @param table Tabla a liberar
+ */
+void block_table_free(BlockTable* table) {
+    free(table->offsets);
+    free(table->sizes);
+    free(table->is_free);
+    free(table->name_ids);
+    memset(table, 0, sizeof(*table));
+}
+
+/**
+ * Inserta un bloque en la posición indicada desplazando los siguientes.
+ * 
+ * @param table Tabla de bloques
+ * @param index Posición del nuevo bloque (0..count)
+ * @param offset Desplazamiento del bloque desde el inicio del pool
+ * @param size Tamaño del bloque en bytes
+ * @param is_free Si el bloque está libre
+ * @param name_id ID del nombre del ocupante (NAME_ID_NONE si está libre)
+ * @return true si se insertó, false si no hubo memoria
+ */
+bool block_table_insert(BlockTable* table, int index, size_t offset, size_t size, bool is_free, uint32_t name_id) {
+    if (!block_table_reserve(table, table->count + 1)) {
+        return false;
+    }
+    int tail = table->count - index;
+    memmove(table->offsets + index + 1, table->offsets + index, (size_t)tail * sizeof(size_t));
+    memmove(table->sizes + index + 1, table->sizes + index, (size_t)tail * sizeof(size_t));
+    memmove(table->is_free + index + 1, table->is_free + index, (size_t)tail * sizeof(bool));
+    memmove(table->name_ids + index + 1, table->name_ids + index, (size_t)tail * sizeof(uint32_t));
+    table->offsets[index] = offset;
+    table->sizes[index] = size;
+    table->is_free[index] = is_free;
+    table->name_ids[index] = name_id;
+    table->count++;
+    return true;
+}
+
+/**
+ * Quita un bloque de la tabla desplazando los siguientes.
+ * 
+ * @param table Tabla de bloques
+ * @param index Posición del bloque a quitar
+ */
+void block_table_remove(BlockTable* table, int index) {
+    int tail = table->count - index - 1;
+    memmove(table->offsets + index, table->offsets + index + 1, (size_t)tail * sizeof(size_t));
+    memmove(table->sizes + index, table->sizes + index + 1, (size_t)tail * sizeof(size_t));
+    memmove(table->is_free + index, table->is_free + index + 1, (size_t)tail * sizeof(bool));
+    memmove(table->name_ids + index, table->name_ids + index + 1, (size_t)tail * sizeof(uint32_t));
+    table->count--;
+}
+
+/**
+ * Busca por búsqueda binaria el bloque que contiene un desplazamiento.
+ * 
+ * @param table Tabla de bloques
+ * @param offset Desplazamiento desde el inicio del pool
+ * @return Índice del último bloque que empieza en o antes de offset, BLOCK_NONE si no hay
+ */
+int block_table_find_containing(const BlockTable* table, size_t offset) {
+    int low = 0;
+    int high = table->count - 1;
+    int found = BLOCK_NONE;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        if (table->offsets[mid] <= offset) {
+            found = mid;
+            low = mid + 1;
         } else {
-            memset(block->address, 0, new_size);
+            high = mid - 1;
+        }
+    }
+    return found;
+}
+
+/**
+ * Busca por búsqueda binaria el bloque que empieza exactamente en un desplazamiento.
+ * 
+ * @param table Tabla de bloques
+ * @param offset Desplazamiento desde el inicio del pool
+ * @return Índice del bloque, BLOCK_NONE si ningún bloque empieza ahí
+ */
+int block_table_find(const BlockTable* table, size_t offset) {
+    int index = block_table_find_containing(table, offset);
+    return index != BLOCK_NONE && table->offsets[index] == offset ? index : BLOCK_NONE;
+}
+
+/**
+ * Agrega una entrada al montículo de bloques libres.
+ * 
+ * Si no hay memoria para crecer, marca el montículo para reconstruirlo en la
+ * próxima consulta en vez de perder el bloque.
+ * 
+ * @param heap Montículo de bloques libres
+ * @param size Tamaño del bloque
+ * @param offset Desplazamiento del bloque
+ */
+void free_heap_push(FreeBlockHeap* heap, size_t size, size_t offset) {
+    if (heap->count == heap->capacity) {
+        int capacity = heap->capacity ? heap->capacity * 2 : 64;
+        FreeBlockEntry* entries = (FreeBlockEntry*)realloc(heap->entries, (size_t)capacity * sizeof(FreeBlockEntry));
+        if (!entries) {
+            heap->dirty = true;
+            return;
+        }
+        heap->entries = entries;
+        heap->capacity = capacity;
+    }
+    int i = heap->count++;
+    while (i > 0 && heap->entries[(i - 1) / 2].size < size) {
+        heap->entries[i] = heap->entries[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->entries[i].size = size;
+    heap->entries[i].offset = offset;
+}
+
+/**
+ * Quita la cima del montículo de bloques libres.
+ * 
+ * @param heap Montículo de bloques libres (no vacío)
+ */
+void free_heap_pop(FreeBlockHeap* heap) {
+    FreeBlockEntry last = heap->entries[--heap->count];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count && heap->entries[child + 1].size > heap->entries[child].size) {
+            child++;
         }
+        if (heap->entries[child].size <= last.size) {
+            break;
+        }
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    if (heap->count > 0) {
+        heap->entries[i] = last;
+    }
+}
+
+/**
+ * Reconstruye el montículo con los bloques libres actuales de la tabla.
+ * 
+ * @param heap Montículo de bloques libres
+ * @param table Tabla de bloques
+ */
+void free_heap_rebuild(FreeBlockHeap* heap, const BlockTable* table) {
+    heap->count = 0;
+    heap->dirty = false;
+    for (int i = 0; i < table->count; i++) {
+        if (table->is_free[i]) {
+            free_heap_push(heap, table->sizes[i], table->offsets[i]);
+        }
+    }
+}
+
+/**
+ * Libera el arreglo del montículo de bloques libres.
+ * 
+ * @param heap Montículo a liberar
+ */
+void free_heap_free(FreeBlockHeap* heap) {
+    free(heap->entries);
+    heap->entries = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+}
+
+/**
+ * Clase log2 de un tamaño de bloque: k tal que 2^k <= size < 2^(k+1).
+ * 
+ * @param size Tamaño en bytes (0 cae en la clase 0)
+ * @return Índice de la clase en el histograma de bloques libres
+ */
+int size_bucket(size_t size) {
+    return size > 1 ? 63 - __builtin_clzll((unsigned long long)size) : 0;
+}
+
+/**
+ * Suma o resta un bloque libre en el histograma por clases de tamaño.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño del bloque
+ * @param delta +1 si el bloque aparece, -1 si desaparece
+ */
+void free_histogram_update(MemoryManager* mm, size_t size, int delta) {
+    mm->free_histogram[size_bucket(size)] += delta;
+}
 
-        printf("REALLOC: Variable '%s' redimensionada de %zu a %zu bytes\n", var_name, old_size, new_size);
+/**
+ * Agranda resident_map para que cubra las páginas de un pool de pool_size bytes.
+ * 
+ * Las páginas nuevas quedan como no residentes (el pool recién habilitado
+ * no se tocó).
+ * 
+ * @param mm Puntero al gestor de memoria (con resident_map)
+ * @param pool_size Tamaño del pool a cubrir
+ * @return true si el mapa alcanza, false si no hay memoria (el mapa no cambia)
+ */
+bool resident_map_reserve(MemoryManager* mm, size_t pool_size) {
+    size_t unit = mm->resident_unit;
+    uintptr_t base = (uintptr_t)mm->memory_pool / unit * unit;
+    uintptr_t end = ((uintptr_t)mm->memory_pool + pool_size + unit - 1) / unit * unit;
+    size_t pages = (size_t)(end - base) / unit;
+    if (pages <= mm->resident_map_pages && mm->resident_map) {
         return true;
-    } else {
-        // Intentar expandir el bloque
-        // Verificar si hay espacio libre después del bloque
-        MemoryBlock* next = block->next;
-        size_t available = block->size;
-        
-        if (next && next->is_free) {
-            void* end_current = (char*)block->address + block->size;
-            if (end_current == next->address) {
-                available += next->size;
+    }
+    size_t old_words = (mm->resident_map_pages + 63) / 64;
+    size_t words = (pages + 63) / 64;
+    uint64_t* map = (uint64_t*)realloc(mm->resident_map, (words ? words : 1) * sizeof(uint64_t));
+    if (!map) {
+        return false;
+    }
+    memset(map + old_words, 0, (words - old_words) * sizeof(uint64_t));
+    mm->resident_map = map;
+    mm->resident_map_pages = pages;
+    return true;
+}
+
+/**
+ * Empieza a llevar la cuenta de las páginas residentes del pool.
+ * 
+ * Una única consulta con mincore da el punto de partida (un pool de malloc
+ * puede compartir páginas ya tocadas); después touch_pool marca las páginas
+ * que el gestor escribe y release_free_pages desmarca las que devuelve, así
+ * que STATS y FRAG obtienen la memoria residente en O(1). Una página de
+ * 'unit' bytes cuenta como residente si lo es alguna de sus páginas base.
+ * Si no hay memoria para el mapa se sigue consultando con mincore.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param unit Tamaño de página del mapa (página base o página enorme)
+ */
+void track_resident_pages(MemoryManager* mm, size_t unit) {
+    free(mm->resident_map);
+    mm->resident_map = NULL;
+    mm->resident_map_pages = 0;
+    mm->resident_pages = 0;
+    mm->resident_unit = unit;
+    if (!resident_map_reserve(mm, mm->pool_size)) {
+        return;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t base = (uintptr_t)mm->memory_pool / unit * unit;
+    uintptr_t start = (uintptr_t)mm->memory_pool / page * page;
+    uintptr_t end = ((uintptr_t)mm->memory_pool + mm->pool_size + page - 1) / page * page;
+    unsigned char residency[RESIDENCY_BATCH];
+    for (uintptr_t address = start; address < end; address += (uintptr_t)RESIDENCY_BATCH * page) {
+        size_t pages = (end - address) / page;
+        if (pages > RESIDENCY_BATCH) {
+            pages = RESIDENCY_BATCH;
+        }
+        if (mincore((void*)address, pages * page, residency) != 0) {
+            continue;
+        }
+        for (size_t i = 0; i < pages; i++) {
+            size_t index = (size_t)(address + i * page - base) / unit;
+            if ((residency[i] & 1) && !(mm->resident_map[index / 64] & (1ull << (index % 64)))) {
+                mm->resident_map[index / 64] |= 1ull << (index % 64);
+                mm->resident_pages++;
             }
         }
-        
-        if (available >= new_size) {
-            // Expandir en el lugar
-            if (next && next->is_free) {
-                void* end_current = (char*)block->address + block->size;
-                if (end_current == next->address) {
-                    size_t needed = new_size - block->size;
-                    if (needed <= next->size) {
-                        block->size = new_size;
-                        next->size -= needed;
-                        if (next->size == 0) {
-                            MemoryBlock* to_remove = next;
-                            block->next = next->next;
-                            free(to_remove);
-                        } else {
-                            next->address = (char*)next->address + needed;
-                        }
-                        var->size = new_size;
-                        // Llenar toda la nueva memoria con el nombre (repetido)
-                        size_t name_len = strlen(var_name);
-                        if (name_len > 0) {
-                            for (size_t i = old_size; i < new_size; i++) {
-                                ((char*)block->address)[i] = var_name[i % name_len];
-                            }
-                        } else {
-                            memset((char*)block->address + old_size, 0, new_size - old_size);
-                        }
-                        printf("REALLOC: Variable '%s' expandida de %zu a %zu bytes\n", var_name, old_size, new_size);
-                        return true;
-                    }
-                }
+    }
+}
+
+/**
+ * Marca como residentes las páginas del pool que se van a escribir.
+ * 
+ * Ignora las direcciones fuera del pool (asignaciones grandes con mmap
+ * propio). El costo es una comprobación por página, menor que escribir los
+ * bytes.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param address Primer byte escrito
+ * @param count Bytes escritos
+ */
+void touch_pool(MemoryManager* mm, const void* address, size_t count) {
+    uintptr_t pool = (uintptr_t)mm->memory_pool;
+    uintptr_t start = (uintptr_t)address;
+    if (!mm->resident_map || count == 0 || start < pool || start >= pool + mm->pool_size) {
+        return;
+    }
+    size_t unit = mm->resident_unit;
+    uintptr_t base = pool / unit * unit;
+    size_t first = (size_t)(start - base) / unit;
+    size_t last = (size_t)(start + count - 1 - base) / unit;
+    for (size_t index = first; index <= last; index++) {
+        uint64_t bit = 1ull << (index % 64);
+        if (!(mm->resident_map[index / 64] & bit)) {
+            mm->resident_map[index / 64] |= bit;
+            mm->resident_pages++;
+        }
+    }
+}
+
+/**
+ * Desmarca las páginas devueltas al sistema (rango alineado a resident_unit).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param from Desplazamiento del primer byte devuelto
+ * @param to Desplazamiento final (exclusivo) del rango devuelto
+ */
+void untouch_pool(MemoryManager* mm, size_t from, size_t to) {
+    if (!mm->resident_map) {
+        return;
+    }
+    size_t unit = mm->resident_unit;
+    size_t skew = (size_t)((uintptr_t)mm->memory_pool % unit);
+    for (size_t index = (from + skew) / unit; index < (to + skew) / unit; index++) {
+        uint64_t bit = 1ull << (index % 64);
+        if (mm->resident_map[index / 64] & bit) {
+            mm->resident_map[index / 64] &= ~bit;
+            mm->resident_pages--;
+        }
+    }
+}
+
+/**
+ * Escribe en el pool las etiquetas de un bloque (--headers).
+ * 
+ * La cabecera, al inicio del bloque, guarda el tamaño y el bit de ocupado;
+ * los bloques libres llevan además un pie con su tamaño al final, que le
+ * permite al bloque siguiente llegar a la cabecera del anterior. La tabla
+ * de bloques sigue siendo el índice: las etiquetas reflejan su estado en
+ * memoria para que el costo de cabeceras y pies sea el de un asignador
+ * real. No escribe en el pool fantasma ni dentro del bloque que REALLOC
+ * aún debe copiar (tag_hold_from..tag_hold_to).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del bloque
+ */
+void write_block_tags(MemoryManager* mm, int index) {
+    if (mm->header_size == 0 || mm->phantom) {
+        return;
+    }
+    const BlockTable* table = &mm->blocks;
+    size_t offset = table->offsets[index];
+    size_t size = table->sizes[index];
+    if (offset < mm->tag_hold_to && offset + size > mm->tag_hold_from) {
+        return;
+    }
+    char* start = (char*)mm->memory_pool + offset;
+    uint64_t header = ((uint64_t)size << 1) | (table->is_free[index] ? 0 : BLOCK_TAG_USED);
+    memcpy(start, &header, sizeof(header));
+    touch_pool(mm, start, sizeof(header));
+    if (table->is_free[index]) {
+        uint64_t footer = size;
+        memcpy(start + size - BLOCK_FOOTER_SIZE, &footer, sizeof(footer));
+        touch_pool(mm, start + size - BLOCK_FOOTER_SIZE, sizeof(footer));
+    }
+}
+
+/**
+ * Reescribe las etiquetas de todos los bloques que tocan un rango del pool.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param from Desplazamiento inicial del rango
+ * @param to Desplazamiento final (exclusivo) del rango
+ */
+void write_range_tags(MemoryManager* mm, size_t from, size_t to) {
+    if (mm->header_size == 0) {
+        return;
+    }
+    const BlockTable* table = &mm->blocks;
+    for (int i = block_table_find_containing(table, from); i != BLOCK_NONE && i < table->count &&
+         table->offsets[i] < to; i++) {
+        write_block_tags(mm, i);
+    }
+}
+
+/**
+ * Inicializa un gestor de memoria sobre un pool ya reservado.
+ * 
+ * Crea la estructura del gestor, la tabla de variables y el bloque libre
+ * inicial que ocupa todo el pool recibido. El gestor no es dueño del pool: se
+ * usa para las arenas, que son porciones de un único pool compartido.
+ * 
+ * @param pool Memoria que gestionará el gestor
+ * @param pool_size Tamaño en bytes del pool
+ * @param algorithm Algoritmo de asignación: 0=First-fit, 1=Best-fit, 2=Worst-fit
+ * @return Puntero al gestor de memoria inicializado, o NULL si hubo error
+ */
+MemoryManager* init_memory_manager_with_pool(void* pool, size_t pool_size, int algorithm) {
+    MemoryManager* mm = (MemoryManager*)malloc(sizeof(MemoryManager));
+    if (!mm) {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el gestor\n");
+        return NULL;
+    }
+    
+    mm->memory_pool = pool;
+    mm->owns_pool = false;
+    mm->pool_size = pool_size;
+    name_table_init(&mm->symbols);
+    mm->variables = (Variable*)calloc(VARIABLE_TABLE_INITIAL, sizeof(Variable));
+    mm->variable_count = 0;
+    mm->variable_slots = 0;
+    mm->variable_capacity = VARIABLE_TABLE_INITIAL;
+    mm->variable_index = NULL;
+    mm->variable_index_capacity = 0;
+    mm->max_variables = 0;
+    mm->pool_reserved = 0;
+    mm->grow_chunk = 0;
+    mm->pool_grows = 0;
+    mm->allocation_algorithm = algorithm;
+    mm->coalesce_mode = COALESCE_EAGER;
+    mm->coalesce_interval = 0;
+    mm->pending_frees = 0;
+    mm->merge_passes = 0;
+    mm->free_block_count = 1;
+    mm->peak_free_blocks = 1;
+    mm->peak_external_fragmentation = 0.0;
+    mm->free_bytes = pool_size;
+    memset(&mm->largest_free, 0, sizeof(mm->largest_free));
+    memset(mm->free_histogram, 0, sizeof(mm->free_histogram));
+    mm->requested_bytes = 0;
+    mm->high_water = 0;
+    mm->metrics_interval = 0;
+    mm->executed_ops = 0;
+    mm->message_nanos = 0;
+    memset(mm->op_counts, 0, sizeof(mm->op_counts));
+    memset(mm->op_failures, 0, sizeof(mm->op_failures));
+    mm->phantom = false;
+    mm->page_granule = 0;
+    mm->hold_page_release = false;
+    mm->released_bytes = 0;
+    mm->resident_map = NULL;
+    mm->resident_map_pages = 0;
+    mm->resident_unit = 0;
+    mm->resident_pages = 0;
+    mm->page_releases = 0;
+    mm->aligned_requests = 0;
+    mm->alignment_padding = 0;
+    mm->padding_blocks = 0;
+    mm->padding_live = 0;
+    mm->padding_live_blocks = 0;
+    mm->header_size = 0;
+    mm->tag_hold_from = 0;
+    mm->tag_hold_to = 0;
+    mm->large_threshold = 0;
+    memset(&mm->large, 0, sizeof(mm->large));
+    mm->large_allocs = 0;
+    mm->large_bytes = 0;
+    mm->large_requested = 0;
+    mm->quiet = false;
+    mm->mute_errors = false;
+    mm->latency = NULL;
+    mm->output = NULL;
+    mm->thread_safe = false;
+    pthread_mutex_init(&mm->lock, NULL);
+    atomic_init(&mm->remote_head, NULL);
+    atomic_init(&mm->remote_received, 0);
+    mm->regions = NULL;
+    mm->region_depth = 0;
+    mm->region_epoch = 0;
+    mm->region_index = NULL;
+    mm->region_index_capacity = 0;
+    
+    // Inicializar el bloque libre principal
+    if (!block_table_init(&mm->blocks, pool_size)) {
+        free(mm->variables);
+        free(mm);
+        return NULL;
+    }
+    free_heap_push(&mm->largest_free, pool_size, 0);
+    free_histogram_update(mm, pool_size, 1);
+    
+    return mm;
+}
+
+/**
+ * Inicializa un nuevo gestor de memoria con el tamaño y algoritmo especificados.
+ * 
+ * Reserva el pool de memoria del tamaño solicitado al sistema operativo y
+ * crea sobre él el gestor (tabla de variables y bloque libre inicial que
+ * ocupa todo el pool). Configura el algoritmo de asignación a usar.
+ * 
+ * @param pool_size Tamaño en bytes del pool de memoria a crear
+ * @param algorithm Algoritmo de asignación: 0=First-fit, 1=Best-fit, 2=Worst-fit
+ * @return Puntero al gestor de memoria inicializado, o NULL si hubo error
+ */
+MemoryManager* init_memory_manager(size_t pool_size, int algorithm) {
+    void* pool = malloc(pool_size);
+    if (!pool) {
+        fprintf(stderr, "Error: No se pudo asignar el bloque de memoria principal\n");
+        return NULL;
+    }
+    
+    MemoryManager* mm = init_memory_manager_with_pool(pool, pool_size, algorithm);
+    if (!mm) {
+        free(pool);
+        return NULL;
+    }
+    mm->owns_pool = true;
+    track_resident_pages(mm, (size_t)sysconf(_SC_PAGESIZE));
+    return mm;
+}
+
+/**
+ * Inicializa un gestor con el pool en memoria obtenida con mmap.
+ * 
+ * Reserva 'limit' bytes de espacio virtual sin permisos y habilita solo los
+ * primeros pool_size (redondeados a página); grow_pool habilita después
+ * tramos de 'chunk' bytes. Con páginas normales o THP la reserva usa
+ * MAP_NORESERVE, así que no ocupa memoria física ni cuenta para el límite de
+ * compromiso. Con THP el pool se alinea a página enorme y se marca con
+ * MADV_HUGEPAGE; con MAP_HUGETLB las páginas salen del conjunto reservado
+ * por el sistema (/proc/sys/vm/nr_hugepages) y la reserva falla si no
+ * alcanza. En todos los casos las páginas que quedan completamente libres
+ * se devuelven al sistema (release_free_pages), de a páginas enormes salvo
+ * con páginas normales, para no partir las páginas enormes.
+ * 
+ * @param pool_size Tamaño inicial del pool en bytes
+ * @param limit Tamaño máximo que puede alcanzar el pool (con chunk > 0)
+ * @param chunk Tamaño mínimo de cada crecimiento (0 = pool fijo)
+ * @param page_mode PAGES_MMAP, PAGES_THP o PAGES_HUGETLB
+ * @param algorithm Algoritmo de asignación: 0=First-fit, 1=Best-fit, 2=Worst-fit
+ * @return Puntero al gestor de memoria inicializado, o NULL si hubo error
+ */
+MemoryManager* init_mapped_memory_manager(size_t pool_size, size_t limit, size_t chunk, int page_mode,
+                                          int algorithm) {
+    size_t granule = page_mode == PAGES_MMAP ? (size_t)sysconf(_SC_PAGESIZE) : HUGE_PAGE_SIZE;
+    if (chunk == 0 || limit < pool_size) {
+        limit = pool_size;
+    }
+    if (limit > SIZE_MAX - 2 * granule) {
+        fprintf(stderr, "Error: No se pudieron reservar %zu bytes de espacio virtual para el pool\n", limit);
+        return NULL;
+    }
+    limit = (limit + granule - 1) / granule * granule;
+
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | (page_mode == PAGES_HUGETLB ? MAP_HUGETLB : MAP_NORESERVE);
+    size_t length = page_mode == PAGES_THP ? limit + granule : limit;
+    char* mapping = (char*)mmap(NULL, length, PROT_NONE, flags, -1, 0);
+    if (mapping == MAP_FAILED) {
+        if (page_mode == PAGES_HUGETLB) {
+            fprintf(stderr, "Error: No hay %zu bytes de páginas enormes reservadas para MAP_HUGETLB "
+                            "(vea /proc/sys/vm/nr_hugepages o use --mmap=thp)\n", limit);
+        } else {
+            fprintf(stderr, "Error: No se pudieron reservar %zu bytes de espacio virtual para el pool\n", limit);
+        }
+        return NULL;
+    }
+    char* pool = mapping;
+    if (page_mode == PAGES_THP) {
+        // Alinear el pool a página enorme y devolver el sobrante de los extremos
+        pool = (char*)(((uintptr_t)mapping + granule - 1) & ~(uintptr_t)(granule - 1));
+        size_t head = (size_t)(pool - mapping);
+        if (head > 0) {
+            munmap(mapping, head);
+        }
+        munmap(pool + limit, granule - head);
+        // Si THP está deshabilitado el pool sigue funcionando con páginas normales
+        madvise(pool, limit, MADV_HUGEPAGE);
+    }
+    size_t committed = (pool_size + granule - 1) / granule * granule;
+    if (mprotect(pool, committed, PROT_READ | PROT_WRITE) != 0) {
+        fprintf(stderr, "Error: No se pudo asignar el bloque de memoria principal\n");
+        munmap(pool, limit);
+        return NULL;
+    }
+
+    MemoryManager* mm = init_memory_manager_with_pool(pool, pool_size, algorithm);
+    if (!mm) {
+        munmap(pool, limit);
+        return NULL;
+    }
+    mm->owns_pool = true;
+    mm->pool_reserved = limit;
+    mm->grow_chunk = chunk;
+    mm->page_granule = granule;
+    track_resident_pages(mm, granule);
+    return mm;
+}
+
+/**
+ * Inicializa un gestor con un pool fantasma de solo metadatos (--phantom).
+ * 
+ * Reserva el rango virtual con mmap sin permisos y nunca lo habilita: las
+ * direcciones de variables y bloques son válidas para la aritmética de la
+ * tabla de bloques, pero el contenido no existe. ALLOC y REALLOC no llenan
+ * la memoria con el nombre ni copian datos al reubicar, así que el tamaño
+ * del pool solo está limitado por el espacio de direcciones (terabytes) y
+ * el costo de cada operación es solo el de los metadatos. Cualquier acceso
+ * al contenido provoca una violación de segmento en vez de pasar inadvertido.
+ * 
+ * @param pool_size Tamaño inicial del pool en bytes
+ * @param limit Tamaño máximo que puede alcanzar el pool (con chunk > 0)
+ * @param chunk Tamaño mínimo de cada crecimiento (0 = pool fijo)
+ * @param algorithm Algoritmo de asignación: 0=First-fit, 1=Best-fit, 2=Worst-fit
+ * @return Puntero al gestor de memoria inicializado, o NULL si hubo error
+ */
+MemoryManager* init_phantom_memory_manager(size_t pool_size, size_t limit, size_t chunk, int algorithm) {
+    if (chunk == 0 || limit < pool_size) {
+        limit = pool_size;
+    }
+    void* pool = mmap(NULL, limit, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (pool == MAP_FAILED) {
+        fprintf(stderr, "Error: No se pudieron reservar %zu bytes de espacio virtual para el pool\n", limit);
+        return NULL;
+    }
+
+    MemoryManager* mm = init_memory_manager_with_pool(pool, pool_size, algorithm);
+    if (!mm) {
+        munmap(pool, limit);
+        return NULL;
+    }
+    mm->owns_pool = true;
+    mm->pool_reserved = limit;
+    mm->grow_chunk = chunk;
+    mm->phantom = true;
+    return mm;
+}
+
+/**
+ * Configuración común de los gestores que crea el programa.
+ * 
+ * Agrupa las opciones de línea de comandos que definen un gestor, para crear
+ * con los mismos parámetros el de la ejecución secuencial y los de --compare
+ * y --batch-replay.
+ */
+typedef struct ManagerConfig {
+    size_t pool_size;              // Tamaño inicial del pool en bytes
+    size_t grow_chunk;             // Crecer de a este tamaño cuando no hay bloque (0 = pool fijo)
+    size_t pool_limit;             // Tamaño máximo del pool si crece
+    int max_variables;             // Máximo de variables activas (0 = sin límite)
+    bool phantom;                  // Pool fantasma (solo metadatos)
+    bool headers;                  // Etiquetas de bloque dentro del pool (--headers)
+    size_t large_threshold;        // Umbral de las asignaciones con mmap directo (0 = desactivado)
+    int page_mode;                 // PAGES_MALLOC, PAGES_MMAP, PAGES_THP o PAGES_HUGETLB
+    int coalesce_mode;             // COALESCE_EAGER o COALESCE_DEFERRED
+    int coalesce_interval;         // Fusionar cada N liberaciones en modo diferido
+} ManagerConfig;
+
+/**
+ * Crea un gestor con la configuración dada y el algoritmo indicado.
+ * 
+ * @param config Configuración del gestor
+ * @param algorithm Algoritmo de asignación: 0=First-fit, 1=Best-fit, 2=Worst-fit
+ * @return Puntero al gestor de memoria inicializado, o NULL si hubo error
+ */
+MemoryManager* create_configured_manager(const ManagerConfig* config, int algorithm) {
+    MemoryManager* mm;
+    if (config->phantom) {
+        mm = init_phantom_memory_manager(config->pool_size, config->pool_limit, config->grow_chunk, algorithm);
+    } else if (config->grow_chunk > 0 || config->page_mode != PAGES_MALLOC) {
+        mm = init_mapped_memory_manager(config->pool_size, config->pool_limit, config->grow_chunk,
+                                        config->page_mode == PAGES_MALLOC ? PAGES_MMAP : config->page_mode,
+                                        algorithm);
+    } else {
+        mm = init_memory_manager(config->pool_size, algorithm);
+    }
+    if (!mm) {
+        return NULL;
+    }
+    mm->max_variables = config->max_variables;
+    mm->coalesce_mode = config->coalesce_mode;
+    mm->coalesce_interval = config->coalesce_interval;
+    mm->large_threshold = config->large_threshold;
+    if (config->headers) {
+        mm->header_size = BLOCK_HEADER_SIZE;
+        write_block_tags(mm, 0);
+    }
+    return mm;
+}
+
+/**
+ * Libera todos los recursos asociados al gestor de memoria.
+ * 
+ * Libera la tabla de bloques, los mapeos de las asignaciones grandes, el pool
+ * de memoria, la tabla de variables, y finalmente la estructura del gestor. Esta función
+ * debe llamarse al finalizar el uso del gestor para evitar fugas de memoria.
+ * 
+ * @param mm Puntero al gestor de memoria a destruir (puede ser NULL)
+ */
+void destroy_memory_manager(MemoryManager* mm) {
+    if (!mm) return;
+    
+    // Liberar la tabla de bloques
+    block_table_free(&mm->blocks);
+    free_heap_free(&mm->largest_free);
+    for (int i = 0; i < mm->large.count; i++) {
+        munmap(mm->large.entries[i].address, mm->large.entries[i].length);
+    }
+    free(mm->large.entries);
+    free(mm->latency);
+    output_destroy(mm->output);
+    
+    free(mm->variables);
+    free(mm->variable_index);
+    for (int i = 0; i < mm->region_depth; i++) {
+        free(mm->regions[i].variables);
+        free(mm->regions[i].chunks);
+    }
+    free(mm->regions);
+    free(mm->region_index);
+    free(mm->resident_map);
+    name_table_free(&mm->symbols);
+    if (mm->owns_pool && mm->pool_reserved > 0) {
+        munmap(mm->memory_pool, mm->pool_reserved);
+    } else if (mm->owns_pool) {
+        free(mm->memory_pool);
+    }
+    pthread_mutex_destroy(&mm->lock);
+    free(mm);
+}
+
+/**
+ * Devuelve el nombre de un símbolo del gestor.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre en la tabla de símbolos
+ * @return Nombre, o "" para NAME_ID_NONE
+ */
+const char* symbol_name(MemoryManager* mm, uint32_t name_id) {
+    return name_table_get(&mm->symbols, name_id);
+}
+
+/**
+ * Busca una variable en la tabla de variables por el ID de su nombre.
+ * 
+ * Como los nombres se internan una sola vez, los IDs son consecutivos y
+ * sirven de índice directo: variable_index guarda la posición de cada
+ * variable activa, así que la búsqueda es O(1) sin importar cuántas haya.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre de la variable a buscar
+ * @return Puntero a la estructura Variable si se encuentra, NULL si no existe
+ */
+Variable* find_variable(MemoryManager* mm, uint32_t name_id) {
+    if (name_id >= mm->variable_index_capacity || mm->variable_index[name_id] == 0) {
+        return NULL;
+    }
+    return &mm->variables[mm->variable_index[name_id] - 1];
+}
+
+/**
+ * Asegura espacio para agregar una variable con el ID dado.
+ * 
+ * La tabla de variables y el índice por ID crecen al doble cuando se llenan.
+ * Se llama antes de tocar la tabla de bloques, para que una falta de memoria
+ * no deje un bloque ocupado sin variable.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre de la variable que se va a agregar
+ * @return true si hay espacio, false si no hubo memoria
+ */
+bool variable_table_reserve(MemoryManager* mm, uint32_t name_id) {
+    if (mm->variable_slots == mm->variable_capacity) {
+        int new_capacity = mm->variable_capacity * 2;
+        Variable* variables = (Variable*)realloc(mm->variables, (size_t)new_capacity * sizeof(Variable));
+        if (!variables) {
+            return false;
+        }
+        mm->variables = variables;
+        mm->variable_capacity = new_capacity;
+    }
+    if (name_id >= mm->variable_index_capacity) {
+        uint32_t new_capacity = mm->variable_index_capacity ? mm->variable_index_capacity : VARIABLE_TABLE_INITIAL;
+        while (new_capacity <= name_id) {
+            new_capacity *= 2;
+        }
+        uint32_t* index = (uint32_t*)realloc(mm->variable_index, (size_t)new_capacity * sizeof(uint32_t));
+        if (!index) {
+            return false;
+        }
+        memset(index + mm->variable_index_capacity, 0,
+               (size_t)(new_capacity - mm->variable_index_capacity) * sizeof(uint32_t));
+        mm->variable_index = index;
+        mm->variable_index_capacity = new_capacity;
+    }
+    return true;
+}
+
+/**
+ * Agrega una variable al final de la tabla (requiere variable_table_reserve).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre de la variable
+ * @param address Dirección de la variable en el pool
+ * @param size Tamaño pedido en bytes
+ */
+void variable_table_add(MemoryManager* mm, uint32_t name_id, void* address, size_t size) {
+    Variable* var = &mm->variables[mm->variable_slots++];
+    var->name_id = name_id;
+    var->address = address;
+    var->size = size;
+    mm->variable_index[name_id] = (uint32_t)mm->variable_slots;
+    mm->variable_count++;
+}
+
+/**
+ * Quita una variable de la tabla.
+ * 
+ * La entrada se marca como liberada (NAME_ID_NONE) para no mover las demás;
+ * cuando las entradas liberadas superan a las activas, la tabla se compacta
+ * en una pasada que conserva el orden de asignación (el de PRINT y las
+ * fugas), así que quitar cuesta O(1) amortizado.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param var Variable a quitar (deja de ser válida)
+ */
+void variable_table_remove(MemoryManager* mm, Variable* var) {
+    mm->variable_index[var->name_id] = 0;
+    var->name_id = NAME_ID_NONE;
+    mm->variable_count--;
+    if (mm->variable_slots - mm->variable_count <= mm->variable_count + VARIABLE_TABLE_INITIAL) {
+        return;
+    }
+    int write = 0;
+    for (int read = 0; read < mm->variable_slots; read++) {
+        if (mm->variables[read].name_id != NAME_ID_NONE) {
+            mm->variables[write] = mm->variables[read];
+            mm->variable_index[mm->variables[write].name_id] = (uint32_t)(write + 1);
+            write++;
+        }
+    }
+    mm->variable_slots = write;
+}
+
+/**
+ * Devuelve la dirección de inicio de un bloque.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del bloque en la tabla
+ * @return Dirección del bloque dentro del pool
+ */
+void* block_address(MemoryManager* mm, int index) {
+    return (char*)mm->memory_pool + mm->blocks.offsets[index];
+}
+
+/**
+ * Busca el bloque que comienza en una dirección del pool.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param address Dirección de inicio del bloque
+ * @return Índice del bloque, BLOCK_NONE si ningún bloque empieza en esa dirección
+ */
+int block_index_at(MemoryManager* mm, const void* address) {
+    if ((const char*)address < (const char*)mm->memory_pool) {
+        return BLOCK_NONE;
+    }
+    return block_table_find(&mm->blocks, (size_t)((const char*)address - (const char*)mm->memory_pool));
+}
+
+/**
+ * Devuelve la dirección del contenido de un bloque.
+ * 
+ * Con --headers el contenido empieza después de la cabecera del bloque; sin
+ * etiquetas coincide con el inicio del bloque.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del bloque en la tabla
+ * @return Dirección que se entrega a la variable
+ */
+void* payload_address(MemoryManager* mm, int index) {
+    return (char*)block_address(mm, index) + mm->header_size;
+}
+
+/**
+ * Busca el bloque cuyo contenido comienza en una dirección del pool.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param address Dirección entregada a la variable (ver payload_address)
+ * @return Índice del bloque, BLOCK_NONE si ningún bloque tiene ahí su contenido
+ */
+int payload_block_at(MemoryManager* mm, const void* address) {
+    if ((const char*)address < (const char*)mm->memory_pool + mm->header_size) {
+        return BLOCK_NONE;
+    }
+    return block_index_at(mm, (const char*)address - mm->header_size);
+}
+
+/**
+ * Calcula el tamaño de bloque que necesita una solicitud.
+ * 
+ * Sin etiquetas es el tamaño pedido. Con --headers suma la cabecera y
+ * redondea a BLOCK_TAG_ALIGN, con un mínimo de BLOCK_MIN_SIZE para que el
+ * bloque pueda llevar cabecera y pie cuando se libere. La diferencia con lo
+ * pedido cuenta como fragmentación interna.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Bytes pedidos
+ * @return Bytes de bloque, SIZE_MAX si el tamaño no es representable
+ */
+size_t block_size_for(MemoryManager* mm, size_t size) {
+    if (mm->header_size == 0) {
+        return size;
+    }
+    if (size > SIZE_MAX - mm->header_size - BLOCK_TAG_ALIGN) {
+        return SIZE_MAX;
+    }
+    size_t block_size = (size + mm->header_size + BLOCK_TAG_ALIGN - 1) / BLOCK_TAG_ALIGN * BLOCK_TAG_ALIGN;
+    return block_size < BLOCK_MIN_SIZE ? BLOCK_MIN_SIZE : block_size;
+}
+
+/**
+ * Encuentra el primer bloque libre que tenga suficiente espacio.
+ * 
+ * Recorre el arreglo de tamaños en orden de dirección buscando el primer
+ * bloque que esté libre y tenga un tamaño mayor o igual al solicitado. Esta
+ * es la base para el algoritmo First-fit.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño mínimo requerido en bytes
+ * @return Índice del primer bloque libre que cumple, BLOCK_NONE si no hay ninguno
+ */
+int find_free_block(MemoryManager* mm, size_t size) {
+    const size_t* sizes = mm->blocks.sizes;
+    const bool* is_free = mm->blocks.is_free;
+    int count = mm->blocks.count;
+    for (int i = 0; i < count; i++) {
+        if (is_free[i] && sizes[i] >= size) {
+            return i;
+        }
+    }
+    return BLOCK_NONE;
+}
+
+/**
+ * Algoritmo First-fit: encuentra el primer bloque libre que pueda satisfacer la solicitud.
+ * 
+ * Busca secuencialmente en la tabla de bloques y selecciona el primer bloque
+ * libre que tenga suficiente espacio. Es rápido pero puede generar más
+ * fragmentación que otros algoritmos.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño requerido en bytes
+ * @return Índice del bloque seleccionado, BLOCK_NONE si no hay espacio suficiente
+ */
+int first_fit(MemoryManager* mm, size_t size) {
+    return find_free_block(mm, size);
+}
+
+/**
+ * Núcleo de búsqueda Best-fit/Worst-fit sobre los arreglos de la tabla de bloques.
+ * 
+ * Recibe los tamaños y estados de 'count' bloques y devuelve el índice del
+ * bloque libre elegido (BLOCK_NONE si ninguno alcanza). Ante tamaños iguales
+ * todas las variantes eligen el de menor dirección (menor índice).
+ */
+typedef int (*FitKernel)(const size_t* sizes, const bool* is_free, int count, size_t size);
+
+/**
+ * Conjunto de núcleos de búsqueda de una misma familia de instrucciones.
+ */
+typedef struct FitKernels {
+    const char* name;             // Nombre de la variante ("escalar", "sse4", "avx2")
+    FitKernel best;               // Menor bloque libre suficiente
+    FitKernel worst;              // Mayor bloque libre suficiente
+} FitKernels;
+
+/**
+ * Continúa una búsqueda Best-fit escalar desde el bloque 'start'.
+ * 
+ * Las variantes vectoriales la usan para los bloques sobrantes que no llenan
+ * un vector, partiendo del mejor bloque que ya encontraron.
+ * 
+ * @param sizes Tamaños de los bloques
+ * @param is_free Estado de los bloques
+ * @param start Primer índice a revisar
+ * @param count Número de bloques
+ * @param size Tamaño requerido en bytes
+ * @param best Mejor bloque encontrado hasta 'start' (o BLOCK_NONE)
+ * @return Índice del bloque seleccionado, BLOCK_NONE si no hay espacio suficiente
+ */
+int best_fit_tail(const size_t* sizes, const bool* is_free, int start, int count, size_t size, int best) {
+    size_t best_size = best == BLOCK_NONE ? SIZE_MAX : sizes[best];
+    for (int i = start; i < count; i++) {
+        if (is_free[i] && sizes[i] >= size && sizes[i] < best_size) {
+            best = i;
+            best_size = sizes[i];
+        }
+    }
+    return best;
+}
+
+/**
+ * Continúa una búsqueda Worst-fit escalar desde el bloque 'start'.
+ * 
+ * @param sizes Tamaños de los bloques
+ * @param is_free Estado de los bloques
+ * @param start Primer índice a revisar
+ * @param count Número de bloques
+ * @param size Tamaño requerido en bytes
+ * @param worst Mejor bloque encontrado hasta 'start' (o BLOCK_NONE)
+ * @return Índice del bloque seleccionado, BLOCK_NONE si no hay espacio suficiente
+ */
+int worst_fit_tail(const size_t* sizes, const bool* is_free, int start, int count, size_t size, int worst) {
+    size_t worst_size = worst == BLOCK_NONE ? 0 : sizes[worst];
+    for (int i = start; i < count; i++) {
+        if (is_free[i] && sizes[i] >= size && (worst == BLOCK_NONE || sizes[i] > worst_size)) {
+            worst = i;
+            worst_size = sizes[i];
+        }
+    }
+    return worst;
+}
+
+/**
+ * Núcleo Best-fit escalar (disponible en cualquier arquitectura).
+ */
+int best_fit_scalar(const size_t* sizes, const bool* is_free, int count, size_t size) {
+    return best_fit_tail(sizes, is_free, 0, count, size, BLOCK_NONE);
+}
+
+/**
+ * Núcleo Worst-fit escalar (disponible en cualquier arquitectura).
+ */
+int worst_fit_scalar(const size_t* sizes, const bool* is_free, int count, size_t size) {
+    return worst_fit_tail(sizes, is_free, 0, count, size, BLOCK_NONE);
+}
+
+/**
+ * Combina los candidatos de cada carril de un núcleo vectorial.
+ * 
+ * Cada carril recorre índices crecientes y se queda con el primero de los
+ * empates, así que basta con desempatar entre carriles por el menor índice
+ * para respetar el orden de la versión escalar.
+ * 
+ * @param sizes Tamaños de los bloques
+ * @param lanes Índice elegido por cada carril (-1 si ninguno)
+ * @param lane_count Número de carriles
+ * @param largest true para Worst-fit (mayor tamaño), false para Best-fit
+ * @return Índice del bloque elegido, BLOCK_NONE si ningún carril encontró uno
+ */
+int fit_reduce_lanes(const size_t* sizes, const int64_t* lanes, int lane_count, bool largest) {
+    int result = BLOCK_NONE;
+    for (int l = 0; l < lane_count; l++) {
+        if (lanes[l] < 0) {
+            continue;
+        }
+        int index = (int)lanes[l];
+        if (result == BLOCK_NONE ||
+            (largest ? sizes[index] > sizes[result] : sizes[index] < sizes[result]) ||
+            (sizes[index] == sizes[result] && index < result)) {
+            result = index;
+        }
+    }
+    return result;
+}
+
+#if defined(__x86_64__)
+/*
+ * Núcleos vectoriales para x86-64. Los tamaños son enteros de 64 bits sin
+ * signo y AVX2/SSE4.2 solo comparan con signo, así que se invierte el bit más
+ * alto (sesgo) para que la comparación con signo respete el orden sin signo.
+ * Los estados libre/ocupado (un byte por bloque) se amplían a 64 bits para
+ * usarlos como máscara de cada carril.
+ */
+
+__attribute__((target("sse4.2")))
+int best_fit_sse4(const size_t* sizes, const bool* is_free, int count, size_t size) {
+    const __m128i bias = _mm_set1_epi64x(INT64_MIN);
+    const __m128i need = _mm_set1_epi64x((long long)(size ^ (size_t)INT64_MIN));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i step = _mm_set1_epi64x(2);
+    __m128i best = _mm_set1_epi64x(INT64_MAX);   // SIZE_MAX con sesgo
+    __m128i best_index = _mm_set1_epi64x(-1);
+    __m128i index = _mm_set_epi64x(1, 0);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(sizes + i)), bias);
+        uint16_t flags;
+        memcpy(&flags, is_free + i, sizeof(flags));
+        __m128i used = _mm_cmpeq_epi64(_mm_cvtepu8_epi64(_mm_cvtsi32_si128(flags)), zero);
+        __m128i small = _mm_cmpgt_epi64(need, s);
+        __m128i better = _mm_cmpgt_epi64(best, s);
+        __m128i take = _mm_andnot_si128(_mm_or_si128(used, small), better);
+        best = _mm_blendv_epi8(best, s, take);
+        best_index = _mm_blendv_epi8(best_index, index, take);
+        index = _mm_add_epi64(index, step);
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, best_index);
+    return best_fit_tail(sizes, is_free, i, count, size, fit_reduce_lanes(sizes, lanes, 2, false));
+}
+
+__attribute__((target("sse4.2")))
+int worst_fit_sse4(const size_t* sizes, const bool* is_free, int count, size_t size) {
+    const __m128i bias = _mm_set1_epi64x(INT64_MIN);
+    const __m128i need = _mm_set1_epi64x((long long)(size ^ (size_t)INT64_MIN));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i none = _mm_set1_epi64x(-1);
+    const __m128i step = _mm_set1_epi64x(2);
+    __m128i worst = _mm_set1_epi64x(INT64_MIN);  // 0 con sesgo
+    __m128i worst_index = none;
+    __m128i index = _mm_set_epi64x(1, 0);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(sizes + i)), bias);
+        uint16_t flags;
+        memcpy(&flags, is_free + i, sizeof(flags));
+        __m128i used = _mm_cmpeq_epi64(_mm_cvtepu8_epi64(_mm_cvtsi32_si128(flags)), zero);
+        __m128i small = _mm_cmpgt_epi64(need, s);
+        __m128i better = _mm_or_si128(_mm_cmpgt_epi64(s, worst), _mm_cmpeq_epi64(worst_index, none));
+        __m128i take = _mm_andnot_si128(_mm_or_si128(used, small), better);
+        worst = _mm_blendv_epi8(worst, s, take);
+        worst_index = _mm_blendv_epi8(worst_index, index, take);
+        index = _mm_add_epi64(index, step);
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, worst_index);
+    return worst_fit_tail(sizes, is_free, i, count, size, fit_reduce_lanes(sizes, lanes, 2, true));
+}
+
+__attribute__((target("avx2")))
+int best_fit_avx2(const size_t* sizes, const bool* is_free, int count, size_t size) {
+    const __m256i bias = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i need = _mm256_set1_epi64x((long long)(size ^ (size_t)INT64_MIN));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i step = _mm256_set1_epi64x(4);
+    __m256i best = _mm256_set1_epi64x(INT64_MAX);   // SIZE_MAX con sesgo
+    __m256i best_index = _mm256_set1_epi64x(-1);
+    __m256i index = _mm256_setr_epi64x(0, 1, 2, 3);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i s = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(sizes + i)), bias);
+        uint32_t flags;
+        memcpy(&flags, is_free + i, sizeof(flags));
+        __m256i used = _mm256_cmpeq_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128((int)flags)), zero);
+        __m256i small = _mm256_cmpgt_epi64(need, s);
+        __m256i better = _mm256_cmpgt_epi64(best, s);
+        __m256i take = _mm256_andnot_si256(_mm256_or_si256(used, small), better);
+        best = _mm256_blendv_epi8(best, s, take);
+        best_index = _mm256_blendv_epi8(best_index, index, take);
+        index = _mm256_add_epi64(index, step);
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, best_index);
+    return best_fit_tail(sizes, is_free, i, count, size, fit_reduce_lanes(sizes, lanes, 4, false));
+}
+
+__attribute__((target("avx2")))
+int worst_fit_avx2(const size_t* sizes, const bool* is_free, int count, size_t size) {
+    const __m256i bias = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i need = _mm256_set1_epi64x((long long)(size ^ (size_t)INT64_MIN));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i none = _mm256_set1_epi64x(-1);
+    const __m256i step = _mm256_set1_epi64x(4);
+    __m256i worst = _mm256_set1_epi64x(INT64_MIN);  // 0 con sesgo
+    __m256i worst_index = none;
+    __m256i index = _mm256_setr_epi64x(0, 1, 2, 3);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i s = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(sizes + i)), bias);
+        uint32_t flags;
+        memcpy(&flags, is_free + i, sizeof(flags));
+        __m256i used = _mm256_cmpeq_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128((int)flags)), zero);
+        __m256i small = _mm256_cmpgt_epi64(need, s);
+        __m256i better = _mm256_or_si256(_mm256_cmpgt_epi64(s, worst), _mm256_cmpeq_epi64(worst_index, none));
+        __m256i take = _mm256_andnot_si256(_mm256_or_si256(used, small), better);
+        worst = _mm256_blendv_epi8(worst, s, take);
+        worst_index = _mm256_blendv_epi8(worst_index, index, take);
+        index = _mm256_add_epi64(index, step);
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, worst_index);
+    return worst_fit_tail(sizes, is_free, i, count, size, fit_reduce_lanes(sizes, lanes, 4, true));
+}
+#endif
+
+// Variantes disponibles, de la más simple a la más ancha
+const FitKernels fit_kernel_table[] = {
+    {"escalar", best_fit_scalar, worst_fit_scalar},
+#if defined(__x86_64__)
+    {"sse4", best_fit_sse4, worst_fit_sse4},
+    {"avx2", best_fit_avx2, worst_fit_avx2},
+#endif
+};
+#define FIT_KERNEL_COUNT ((int)(sizeof(fit_kernel_table) / sizeof(fit_kernel_table[0])))
+
+// Variante en uso; se elige una sola vez según la CPU (select_fit_kernels)
+const FitKernels* fit_kernels = &fit_kernel_table[0];
+
+/**
+ * Indica si la CPU actual soporta una variante de los núcleos de búsqueda.
+ * 
+ * @param kernels Variante a comprobar
+ * @return true si se puede ejecutar en esta CPU
+ */
+bool fit_kernels_supported(const FitKernels* kernels) {
+#if defined(__x86_64__)
+    if (kernels->best == best_fit_avx2) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (kernels->best == best_fit_sse4) {
+        return __builtin_cpu_supports("sse4.2");
+    }
+#endif
+    return kernels->best == best_fit_scalar;
+}
+
+/**
+ * Busca una variante de los núcleos de búsqueda por nombre.
+ * 
+ * @param name Nombre de la variante ("escalar", "sse4", "avx2")
+ * @return Variante encontrada, NULL si no existe en esta arquitectura
+ */
+const FitKernels* find_fit_kernels(const char* name) {
+    for (int k = 0; k < FIT_KERNEL_COUNT; k++) {
+        if (strcmp(fit_kernel_table[k].name, name) == 0) {
+            return &fit_kernel_table[k];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Elige la variante más ancha de los núcleos de búsqueda que soporta la CPU.
+ * 
+ * Se llama una vez al inicio, antes de crear hilos.
+ */
+void select_fit_kernels(void) {
+    for (int k = FIT_KERNEL_COUNT - 1; k >= 0; k--) {
+        if (fit_kernels_supported(&fit_kernel_table[k])) {
+            fit_kernels = &fit_kernel_table[k];
+            return;
+        }
+    }
+}
+
+/**
+ * Algoritmo Best-fit: encuentra el bloque libre más pequeño que pueda satisfacer la solicitud.
+ * 
+ * Recorre todos los bloques libres y selecciona el que tenga el tamaño más
+ * cercano (pero mayor o igual) al solicitado. Minimiza el desperdicio de
+ * memoria pero requiere recorrer toda la tabla, siendo más lento. El recorrido
+ * lo hace el núcleo elegido para la CPU (escalar, SSE4.2 o AVX2).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño requerido en bytes
+ * @return Índice del bloque seleccionado, BLOCK_NONE si no hay espacio suficiente
+ */
+int best_fit(MemoryManager* mm, size_t size) {
+    return fit_kernels->best(mm->blocks.sizes, mm->blocks.is_free, mm->blocks.count, size);
+}
+
+/**
+ * Algoritmo Worst-fit: encuentra el bloque libre más grande disponible.
+ * 
+ * Recorre todos los bloques libres y selecciona el de mayor tamaño que pueda
+ * satisfacer la solicitud. Deja bloques grandes libres que pueden ser útiles
+ * para futuras asignaciones grandes, pero puede generar más fragmentación.
+ * El recorrido lo hace el núcleo elegido para la CPU (escalar, SSE4.2 o AVX2).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño requerido en bytes
+ * @return Índice del bloque seleccionado, BLOCK_NONE si no hay espacio suficiente
+ */
+int worst_fit(MemoryManager* mm, size_t size) {
+    return fit_kernels->worst(mm->blocks.sizes, mm->blocks.is_free, mm->blocks.count, size);
+}
+
+/**
+ * Selecciona un bloque libre usando el algoritmo configurado en el gestor.
+ * 
+ * Llama al algoritmo de asignación correspondiente según el valor de
+ * allocation_algorithm en el gestor. Si el valor no es válido, usa First-fit
+ * por defecto.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño requerido en bytes
+ * @return Índice del bloque seleccionado, BLOCK_NONE si no hay espacio suficiente
+ */
+int select_block(MemoryManager* mm, size_t size) {
+    switch (mm->allocation_algorithm) {
+        case 0: return first_fit(mm, size);
+        case 1: return best_fit(mm, size);
+        case 2: return worst_fit(mm, size);
+        default: return first_fit(mm, size);
+    }
+}
+
+/**
+ * Registra que apareció un nuevo bloque libre en la tabla.
+ *
+ * Incrementa el contador de bloques libres y actualiza el pico de
+ * fragmentación observado. Debe llamarse cada vez que un bloque pasa a estar
+ * libre o se crea un bloque libre nuevo (por división o reducción).
+ *
+ * @param mm Puntero al gestor de memoria
+ */
+void note_free_block_added(MemoryManager* mm) {
+    mm->free_block_count++;
+    if (mm->free_block_count > mm->peak_free_blocks) {
+        mm->peak_free_blocks = mm->free_block_count;
+    }
+}
+
+/**
+ * Registra en el montículo el tamaño y la posición actuales de un bloque libre.
+ * 
+ * Debe llamarse cada vez que un bloque libre aparece o cambia de tamaño o de
+ * posición; la entrada anterior queda obsoleta y se descarta al consultar.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del bloque libre
+ */
+void note_free_block_changed(MemoryManager* mm, int index) {
+    free_heap_push(&mm->largest_free, mm->blocks.sizes[index], mm->blocks.offsets[index]);
+}
+
+/**
+ * Actualiza la marca de agua con el final de un bloque ocupado.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del bloque ocupado
+ */
+void note_high_water(MemoryManager* mm, int index) {
+    size_t end = mm->blocks.offsets[index] + mm->blocks.sizes[index];
+    if (end > mm->high_water) {
+        mm->high_water = end;
+    }
+}
+
+/**
+ * Deja de contar un bloque libre como relleno de alineación.
+ * 
+ * Se llama cuando el bloque se reutiliza o se fusiona con un vecino: su
+ * espacio deja de ser relleno sin usar.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del bloque
+ */
+void forget_padding_block(MemoryManager* mm, int index) {
+    if (mm->blocks.name_ids[index] == NAME_ID_PADDING) {
+        mm->padding_live -= mm->blocks.sizes[index];
+        mm->padding_live_blocks--;
+        mm->blocks.name_ids[index] = NAME_ID_NONE;
+    }
+}
+
+/**
+ * Marca un bloque libre como ocupado y actualiza las estadísticas.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del bloque
+ * @param label_id ID de la etiqueta del bloque (nombre de la variable, hilo o región)
+ */
+void mark_block_used(MemoryManager* mm, int index, uint32_t label_id) {
+    forget_padding_block(mm, index);
+    free_histogram_update(mm, mm->blocks.sizes[index], -1);
+    mm->blocks.is_free[index] = false;
+    mm->blocks.name_ids[index] = label_id;
+    mm->free_block_count--;
+    mm->free_bytes -= mm->blocks.sizes[index];
+    write_block_tags(mm, index);
+}
+
+/**
+ * Devuelve al sistema las páginas que un rango recién liberado dejó libres.
+ * 
+ * Recorre las rachas de bloques libres que tocan las páginas del rango y
+ * aplica madvise(MADV_DONTNEED) a las páginas (de page_granule bytes) que
+ * quedan completamente dentro de una racha: la memoria residente del pool
+ * sigue a los datos vivos en vez de al pico. Considera la racha completa y
+ * no solo el bloque, así que funciona igual antes o después de fusionar.
+ * Las páginas de la racha fuera del rango ya estaban libres y se
+ * devolvieron al liberarse. El final del pool cuenta como libre hasta el
+ * borde de su última página. Con --headers cada bloque libre se trata por
+ * separado y se conservan las páginas de sus etiquetas. No hace nada en
+ * pools de malloc ni fantasmas.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param from Desplazamiento del primer byte liberado
+ * @param to Desplazamiento final (exclusivo) del rango liberado
+ */
+void release_free_pages(MemoryManager* mm, size_t from, size_t to) {
+    size_t granule = mm->page_granule;
+    if (granule == 0 || mm->hold_page_release || to <= from) {
+        return;
+    }
+    const BlockTable* table = &mm->blocks;
+    bool tagged = mm->header_size > 0;
+    size_t low = from / granule * granule;
+    size_t high = (to + granule - 1) / granule * granule;
+    int i = block_table_find_containing(table, low);
+    while (i < table->count && table->offsets[i] < high) {
+        if (!table->is_free[i]) {
+            i++;
+            continue;
+        }
+        size_t run_start = table->offsets[i];
+        size_t run_end = run_start;
+        while (i < table->count && table->is_free[i] && run_end < high) {
+            run_end = table->offsets[i] + table->sizes[i];
+            i++;
+            if (tagged) {
+                break;
+            }
+        }
+        if (tagged) {
+            // Cada bloque libre conserva su cabecera y su pie
+            run_start += mm->header_size;
+            run_end -= BLOCK_FOOTER_SIZE;
+        } else if (i == table->count && run_end == mm->pool_size) {
+            run_end = (run_end + granule - 1) / granule * granule;
+        }
+        size_t span_start = (run_start + granule - 1) / granule * granule;
+        size_t span_end = run_end / granule * granule;
+        if (span_start < low) {
+            span_start = low;
+        }
+        if (span_end > high) {
+            span_end = high;
+        }
+        if (span_end > span_start &&
+            madvise((char*)mm->memory_pool + span_start, span_end - span_start, MADV_DONTNEED) == 0) {
+            mm->released_bytes += span_end - span_start;
+            mm->page_releases++;
+            untouch_pool(mm, span_start, span_end);
+        }
+    }
+}
+
+/**
+ * Calcula cuántos bytes del pool están residentes en memoria física.
+ * 
+ * Consulta con mincore las páginas del pool de a RESIDENCY_BATCH. Cuenta
+ * páginas completas, así que en un pool de malloc puede incluir memoria
+ * vecina que comparte la primera o la última página.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @return Bytes residentes (0 en un pool fantasma)
+ */
+size_t pool_resident_bytes(MemoryManager* mm) {
+    if (mm->phantom) {
+        return 0;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)mm->memory_pool / page * page;
+    uintptr_t end = ((uintptr_t)mm->memory_pool + mm->pool_size + page - 1) / page * page;
+    unsigned char residency[RESIDENCY_BATCH];
+    size_t resident = 0;
+    for (uintptr_t address = start; address < end; address += (uintptr_t)RESIDENCY_BATCH * page) {
+        size_t pages = (end - address) / page;
+        if (pages > RESIDENCY_BATCH) {
+            pages = RESIDENCY_BATCH;
+        }
+        if (mincore((void*)address, pages * page, residency) != 0) {
+            continue;
+        }
+        for (size_t i = 0; i < pages; i++) {
+            resident += residency[i] & 1;
+        }
+    }
+    return resident * page;
+}
+
+/**
+ * Memoria residente del pool según la cuenta incremental (ver track_resident_pages).
+ * 
+ * Es O(1), así que la usan STATS y FRAG; PRINT y el resumen final
+ * consultan con mincore (pool_resident_bytes). Sin cuenta (arenas o sin
+ * memoria para el mapa) también consulta con mincore.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @return Bytes residentes (0 en un pool fantasma)
+ */
+size_t pool_resident_estimate(MemoryManager* mm) {
+    if (mm->phantom) {
+        return 0;
+    }
+    if (!mm->resident_map) {
+        return pool_resident_bytes(mm);
+    }
+    return mm->resident_pages * mm->resident_unit;
+}
+
+/**
+ * Marca un bloque ocupado como libre y actualiza las estadísticas.
+ * 
+ * No fusiona: el llamador decide cuándo solicitar la fusión. Devuelve al
+ * sistema las páginas que quedan completamente libres.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del bloque
+ */
+void mark_block_free(MemoryManager* mm, int index) {
+    mm->blocks.is_free[index] = true;
+    mm->blocks.name_ids[index] = NAME_ID_NONE;
+    mm->free_bytes += mm->blocks.sizes[index];
+    free_histogram_update(mm, mm->blocks.sizes[index], 1);
+    note_free_block_added(mm);
+    note_free_block_changed(mm, index);
+    write_block_tags(mm, index);
+    release_free_pages(mm, mm->blocks.offsets[index], mm->blocks.offsets[index] + mm->blocks.sizes[index]);
+}
+
+/**
+ * Devuelve el tamaño del mayor bloque libre en O(1) amortizado.
+ * 
+ * Descarta las entradas obsoletas de la cima del montículo y lo reconstruye
+ * si acumula más del doble de entradas que bloques libres. En modo de fusión
+ * diferido refleja la tabla tal como está, sin fusionar pendientes.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @return Tamaño del mayor bloque libre, 0 si no hay ninguno
+ */
+size_t largest_free_block(MemoryManager* mm) {
+    FreeBlockHeap* heap = &mm->largest_free;
+    const BlockTable* table = &mm->blocks;
+    if (heap->dirty || heap->count > 2 * mm->free_block_count + 64) {
+        free_heap_rebuild(heap, table);
+    }
+    while (heap->count > 0) {
+        int index = block_table_find(table, heap->entries[0].offset);
+        if (index != BLOCK_NONE && table->is_free[index] && table->sizes[index] == heap->entries[0].size) {
+            return heap->entries[0].size;
+        }
+        free_heap_pop(heap);
+    }
+    return 0;
+}
+
+/**
+ * Divide un bloque si es más grande que el tamaño necesario.
+ * 
+ * Si el bloque tiene más espacio del requerido, crea un nuevo bloque libre
+ * con el espacio sobrante y lo inserta después del bloque actual en la tabla.
+ * Esto permite reutilizar el espacio sobrante en futuras asignaciones. Si la
+ * tabla no puede crecer, el bloque conserva su tamaño completo. Con
+ * --headers tampoco se divide si el sobrante no alcanza para sus etiquetas.
+ * 
+ * @param mm Puntero al gestor de memoria (lleva la cuenta de bloques libres)
+ * @param index Índice del bloque a dividir
+ * @param size Tamaño que se necesita del bloque (el resto se convierte en bloque libre)
+ */
+void split_block(MemoryManager* mm, int index, size_t size) {
+    BlockTable* table = &mm->blocks;
+    if (table->sizes[index] > size &&
+        (mm->header_size == 0 || table->sizes[index] - size >= BLOCK_MIN_SIZE) &&
+        block_table_insert(table, index + 1, table->offsets[index] + size,
+                           table->sizes[index] - size, true, NAME_ID_NONE)) {
+        if (table->is_free[index]) {
+            if (table->name_ids[index] == NAME_ID_PADDING) {
+                // Solo el frente sigue siendo relleno
+                mm->padding_live -= table->sizes[index] - size;
+            }
+            free_histogram_update(mm, table->sizes[index], -1);
+            free_histogram_update(mm, size, 1);
+            table->sizes[index] = size;
+            note_free_block_changed(mm, index);
+        } else {
+            table->sizes[index] = size;
+            mm->free_bytes += table->sizes[index + 1];
+        }
+        free_histogram_update(mm, table->sizes[index + 1], 1);
+        note_free_block_added(mm);
+        note_free_block_changed(mm, index + 1);
+        write_block_tags(mm, index);
+        write_block_tags(mm, index + 1);
+    }
+    if (!table->is_free[index]) {
+        note_high_water(mm, index);
+    }
+}
+
+/**
+ * Fusiona bloques libres que sean adyacentes en memoria.
+ * 
+ * Como la tabla cubre el pool sin huecos y está ordenada por dirección, dos
+ * bloques consecutivos siempre son adyacentes en memoria. Una sola pasada
+ * compacta los arreglos acumulando cada racha de bloques libres en el primero
+ * de ella. Esto reduce la fragmentación y facilita futuras asignaciones grandes.
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void merge_free_blocks(MemoryManager* mm) {
+    BlockTable* table = &mm->blocks;
+    int write = 0;
+    bool grown = false;
+    for (int read = 1; read < table->count; read++) {
+        if (table->is_free[write] && table->is_free[read]) {
+            // Fusionar bloques (un relleno fusionado ya no es relleno sin usar)
+            forget_padding_block(mm, write);
+            forget_padding_block(mm, read);
+            free_histogram_update(mm, table->sizes[write], -1);
+            free_histogram_update(mm, table->sizes[read], -1);
+            table->sizes[write] += table->sizes[read];
+            free_histogram_update(mm, table->sizes[write], 1);
+            mm->free_block_count--;
+            grown = true;
+        } else {
+            if (grown) {
+                note_free_block_changed(mm, write);
+                write_block_tags(mm, write);
+                grown = false;
+            }
+            write++;
+            if (write != read) {
+                table->offsets[write] = table->offsets[read];
+                table->sizes[write] = table->sizes[read];
+                table->is_free[write] = table->is_free[read];
+                table->name_ids[write] = table->name_ids[read];
+            }
+        }
+    }
+    if (grown) {
+        note_free_block_changed(mm, write);
+        write_block_tags(mm, write);
+    }
+    if (table->count > 0) {
+        table->count = write + 1;
+    }
+    mm->pending_frees = 0;
+    mm->merge_passes++;
+}
+
+/**
+ * Solicita una sola fusión para varias liberaciones ya marcadas.
+ *
+ * En modo COALESCE_EAGER hace una única pasada aunque se hayan liberado
+ * muchos bloques; en modo COALESCE_DEFERRED cuenta cada liberación como
+ * pendiente, igual que si se hubieran solicitado por separado.
+ *
+ * @param mm Puntero al gestor de memoria
+ * @param frees Número de bloques liberados (0 = nada que fusionar)
+ */
+void request_merge_batch(MemoryManager* mm, int frees) {
+    if (frees <= 0) {
+        return;
+    }
+    if (mm->coalesce_mode == COALESCE_EAGER) {
+        merge_free_blocks(mm);
+        return;
+    }
+    mm->pending_frees += frees;
+    if (mm->coalesce_interval > 0 && mm->pending_frees >= mm->coalesce_interval) {
+        merge_free_blocks(mm);
+    }
+}
+
+/**
+ * Solicita la fusión de bloques libres tras una liberación o reducción.
+ *
+ * En modo COALESCE_EAGER fusiona inmediatamente (comportamiento original). En
+ * modo COALESCE_DEFERRED solo acumula la liberación pendiente y ejecuta una
+ * pasada por lotes cuando se alcanzan coalesce_interval liberaciones; el resto
+ * de pasadas ocurren bajo demanda (asignación fallida o PRINT).
+ *
+ * @param mm Puntero al gestor de memoria
+ */
+void request_merge(MemoryManager* mm) {
+    request_merge_batch(mm, 1);
+}
+
+/**
+ * Ejecuta la pasada de fusión pendiente, si la hay.
+ *
+ * En modo diferido garantiza que la tabla de bloques quede totalmente fusionada
+ * antes de operaciones que necesitan ver la memoria real (PRINT, reintentos de
+ * asignación). En modo inmediato no hace nada porque nunca hay pendientes.
+ *
+ * @param mm Puntero al gestor de memoria
+ */
+void flush_pending_merges(MemoryManager* mm) {
+    if (mm->pending_frees > 0) {
+        merge_free_blocks(mm);
+    }
+}
+
+/**
+ * Agrega memoria al final de un pool que puede crecer (--grow).
+ * 
+ * El pool es un rango virtual reservado con mmap sin permisos; crecer es
+ * habilitar con mprotect el siguiente tramo, que queda contiguo al anterior.
+ * El tramo nuevo se une a la tabla de bloques como bloque libre al final
+ * (extendiendo el último si ya estaba libre), así que ninguna dirección
+ * cambia. Se crece de a múltiplos de grow_chunk lo justo para que quepa la
+ * solicitud.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño de la solicitud que no encontró bloque
+ * @return true si el pool creció, false si no puede crecer o no alcanza la reserva
+ */
+bool grow_pool(MemoryManager* mm, size_t size) {
+    if (mm->grow_chunk == 0) {
+        return false;
+    }
+    BlockTable* table = &mm->blocks;
+    int last = table->count - 1;
+    size_t trailing = table->is_free[last] ? table->sizes[last] : 0;
+    size_t needed = size > trailing ? size - trailing : 1;
+    size_t growth = (needed + mm->grow_chunk - 1) / mm->grow_chunk * mm->grow_chunk;
+    if (growth < needed || growth > mm->pool_reserved - mm->pool_size) {
+        return false;
+    }
+    if (mm->resident_map && !resident_map_reserve(mm, mm->pool_size + growth)) {
+        // Sin memoria para el mapa se vuelve a consultar con mincore
+        free(mm->resident_map);
+        mm->resident_map = NULL;
+        mm->resident_map_pages = 0;
+    }
+    // mprotect exige un rango alineado a la página del mapeo; la página
+    // parcial del final actual ya es accesible, así que se habilita desde su
+    // inicio. El pool fantasma nunca se habilita.
+    if (!mm->phantom) {
+        size_t granule = mm->page_granule;
+        size_t start = mm->pool_size / granule * granule;
+        size_t end = (mm->pool_size + growth + granule - 1) / granule * granule;
+        if (mprotect((char*)mm->memory_pool + start, end - start, PROT_READ | PROT_WRITE) != 0) {
+            return false;
+        }
+    }
+
+    if (trailing > 0) {
+        forget_padding_block(mm, last);
+        free_histogram_update(mm, table->sizes[last], -1);
+        table->sizes[last] += growth;
+        free_histogram_update(mm, table->sizes[last], 1);
+        note_free_block_changed(mm, last);
+    } else {
+        if (!block_table_insert(table, table->count, mm->pool_size, growth, true, NAME_ID_NONE)) {
+            return false;
+        }
+        free_histogram_update(mm, growth, 1);
+        note_free_block_added(mm);
+        note_free_block_changed(mm, table->count - 1);
+    }
+    mm->free_bytes += growth;
+    mm->pool_size += growth;
+    mm->pool_grows++;
+    write_block_tags(mm, table->count - 1);
+    return true;
+}
+
+/**
+ * Calcula el relleno necesario para que un bloque empiece alineado.
+ * 
+ * La alineación es de la dirección real (inicio del pool + desplazamiento),
+ * que es la que ven las líneas de caché y las páginas.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param offset Desplazamiento del bloque
+ * @param align Alineación (potencia de 2)
+ * @return Bytes desde offset hasta la siguiente dirección alineada
+ */
+size_t alignment_padding_at(MemoryManager* mm, size_t offset, size_t align) {
+    return (size_t)(-((uintptr_t)mm->memory_pool + offset) & (uintptr_t)(align - 1));
+}
+
+/**
+ * Calcula el relleno que debe separarse delante de un bloque para alinear su contenido.
+ * 
+ * Con --headers lo que se alinea es el contenido, después de la cabecera, y
+ * el relleno, que queda como bloque libre, debe alcanzar para sus propias
+ * etiquetas: si es menor que BLOCK_MIN_SIZE se salta a la siguiente
+ * dirección alineada.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param offset Desplazamiento del bloque libre
+ * @param align Alineación (potencia de 2)
+ * @return Bytes de relleno desde offset hasta el inicio del bloque alineado
+ */
+size_t block_alignment_padding(MemoryManager* mm, size_t offset, size_t align) {
+    size_t padding = alignment_padding_at(mm, offset + mm->header_size, align);
+    while (mm->header_size > 0 && padding > 0 && padding < BLOCK_MIN_SIZE) {
+        padding += align;
+    }
+    return padding;
+}
+
+/**
+ * Selecciona un bloque libre donde quepa la solicitud a partir de una dirección alineada.
+ * 
+ * Los núcleos de búsqueda solo comparan tamaños, así que las solicitudes
+ * alineadas usan este recorrido escalar: un bloque sirve si su tamaño
+ * alcanza para el relleno inicial más la solicitud. First-fit toma el
+ * primero; Best-fit y Worst-fit, el menor o el mayor de los que sirven.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño requerido en bytes
+ * @param align Alineación (potencia de 2 mayor que 1)
+ * @return Índice del bloque seleccionado, BLOCK_NONE si ninguno sirve
+ */
+int select_aligned_block(MemoryManager* mm, size_t size, size_t align) {
+    const BlockTable* table = &mm->blocks;
+    int chosen = BLOCK_NONE;
+    for (int i = 0; i < table->count; i++) {
+        if (!table->is_free[i] || table->sizes[i] < size ||
+            block_alignment_padding(mm, table->offsets[i], align) > table->sizes[i] - size) {
+            continue;
+        }
+        if (mm->allocation_algorithm != 1 && mm->allocation_algorithm != 2) {
+            return i;
+        }
+        if (chosen == BLOCK_NONE ||
+            (mm->allocation_algorithm == 1 ? table->sizes[i] < table->sizes[chosen]
+                                           : table->sizes[i] > table->sizes[chosen])) {
+            chosen = i;
+        }
+    }
+    return chosen;
+}
+
+/**
+ * Separa el relleno inicial de un bloque libre como bloque libre propio.
+ * 
+ * El relleno queda en la tabla como un bloque libre reutilizable por
+ * solicitudes chicas, etiquetado NAME_ID_PADDING; se contabiliza en
+ * alignment_padding y padding_blocks (acumulados) y en padding_live y
+ * padding_live_blocks, que bajan cuando se fusiona o se reutiliza.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param block Bloque libre elegido por select_aligned_block
+ * @param align Alineación (potencia de 2)
+ * @return Índice del bloque libre alineado, BLOCK_NONE si la tabla no pudo crecer
+ */
+int split_alignment_padding(MemoryManager* mm, int block, size_t align) {
+    size_t padding = block_alignment_padding(mm, mm->blocks.offsets[block], align);
+    if (padding == 0) {
+        return block;
+    }
+    split_block(mm, block, padding);
+    if (mm->blocks.sizes[block] != padding) {
+        return BLOCK_NONE;
+    }
+    mm->alignment_padding += padding;
+    mm->padding_blocks++;
+    if (mm->blocks.name_ids[block] != NAME_ID_PADDING) {
+        // Si el bloque ya era relleno, su frente ya estaba contado
+        mm->blocks.name_ids[block] = NAME_ID_PADDING;
+        mm->padding_live += padding;
+        mm->padding_live_blocks++;
+    }
+    return block + 1;
+}
+
+/**
+ * Selecciona un bloque libre y, si no hay ninguno, reintenta tras fusionar.
+ *
+ * En modo diferido la tabla puede contener bloques libres adyacentes sin
+ * fusionar que, juntos, sí satisfacen la solicitud. Por eso una asignación
+ * fallida dispara la pasada de fusión pendiente y un segundo intento. Si
+ * aun así no hay bloque y el pool puede crecer, se agrega memoria al final
+ * (con margen para el relleno si hay alineación). Con align > 1 el bloque
+ * devuelto ya empieza alineado: el relleno se separó como bloque libre.
+ *
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño requerido en bytes
+ * @param align Alineación de la dirección (potencia de 2; 1 = sin alineación)
+ * @return Índice del bloque seleccionado, BLOCK_NONE si no hay espacio suficiente
+ */
+int select_block_coalescing(MemoryManager* mm, size_t size, size_t align) {
+    if (align <= 1) {
+        int block = select_block(mm, size);
+        if (block == BLOCK_NONE && mm->pending_frees > 0) {
+            merge_free_blocks(mm);
+            block = select_block(mm, size);
+        }
+        if (block == BLOCK_NONE && grow_pool(mm, size)) {
+            block = select_block(mm, size);
+        }
+        return block;
+    }
+
+    int block = select_aligned_block(mm, size, align);
+    if (block == BLOCK_NONE && mm->pending_frees > 0) {
+        merge_free_blocks(mm);
+        block = select_aligned_block(mm, size, align);
+    }
+    // Margen para el relleno, que con etiquetas puede llegar a align - 1 + BLOCK_MIN_SIZE
+    size_t margin = align - 1 + (mm->header_size > 0 ? BLOCK_MIN_SIZE : 0);
+    if (block == BLOCK_NONE && size <= SIZE_MAX - margin && grow_pool(mm, size + margin)) {
+        block = select_aligned_block(mm, size, align);
+    }
+    return block == BLOCK_NONE ? BLOCK_NONE : split_alignment_padding(mm, block, align);
+}
+
+/**
+ * Calcula cuánto puede crecer un bloque en el lugar.
+ *
+ * Suma al tamaño del bloque el del bloque siguiente si está libre.
+ *
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del bloque ocupado
+ * @return Tamaño máximo alcanzable sin mover el bloque
+ */
+size_t in_place_capacity(MemoryManager* mm, int index) {
+    const BlockTable* table = &mm->blocks;
+    size_t available = table->sizes[index];
+    if (index + 1 < table->count && table->is_free[index + 1]) {
+        available += table->sizes[index + 1];
+    }
+    return available;
+}
+
+/**
+ * Vuelve a ocupar un rango concreto que había sido liberado.
+ *
+ * Localiza el bloque libre que contiene el rango [address, address+size),
+ * separa la parte libre anterior y posterior como bloques independientes y
+ * marca el rango como ocupado. Se usa para deshacer una liberación cuando el
+ * bloque original ya pudo haberse fusionado con sus vecinos.
+ *
+ * @param mm Puntero al gestor de memoria
+ * @param address Dirección de inicio del rango a recuperar
+ * @param size Tamaño del rango en bytes
+ * @return Índice del bloque ocupado que cubre exactamente el rango, BLOCK_NONE si no está libre
+ */
+int reserve_range(MemoryManager* mm, void* address, size_t size) {
+    BlockTable* table = &mm->blocks;
+    size_t offset = (size_t)((char*)address - (char*)mm->memory_pool);
+    int block = block_table_find_containing(table, offset);
+    if (block == BLOCK_NONE || !table->is_free[block] ||
+        offset + size > table->offsets[block] + table->sizes[block]) {
+        return BLOCK_NONE;
+    }
+
+    size_t front = offset - table->offsets[block];
+    if (front > 0) {
+        // La parte anterior queda como bloque libre y el rango pasa al siguiente
+        split_block(mm, block, front);
+        if (table->offsets[block] + table->sizes[block] != offset) {
+            return BLOCK_NONE;
+        }
+        block++;
+    }
+    mark_block_used(mm, block, NAME_ID_NONE);
+    split_block(mm, block, size);
+    return block;
+}
+
+/**
+ * Marca como libre el bloque ocupado cuyo contenido comienza en una dirección.
+ * 
+ * No fusiona, para que quien libera varios bloques seguidos solicite una sola
+ * fusión con request_merge_batch.
+ * 
+ * @param mm Puntero a la arena dueña del bloque
+ * @param address Dirección entregada por take_block
+ * @return true si se liberó el bloque, false si no había un bloque ocupado ahí
+ */
+bool mark_block_free_at(MemoryManager* mm, void* address) {
+    int block = payload_block_at(mm, address);
+    if (block == BLOCK_NONE || mm->blocks.is_free[block]) {
+        return false;
+    }
+    mark_block_free(mm, block);
+    return true;
+}
+
+/**
+ * Marca como libre el bloque ocupado cuyo contenido comienza en una dirección.
+ * 
+ * En modo multihilo debe llamarse con el lock de la arena tomado. Solicita la
+ * fusión según el modo configurado (inmediato o diferido).
+ * 
+ * @param mm Puntero a la arena dueña del bloque
+ * @param address Dirección entregada por take_block
+ */
+void release_block_at(MemoryManager* mm, void* address) {
+    if (mark_block_free_at(mm, address)) {
+        request_merge(mm);
+    }
+}
+
+/**
+ * Llena un rango de memoria con el nombre de la variable repetido.
+ * 
+ * @param address Inicio del bloque de la variable
+ * @param from Primer byte (relativo al bloque) a rellenar
+ * @param to Byte final (exclusivo) a rellenar
+ * @param name Nombre de la variable
+ */
+void fill_with_name(void* address, size_t from, size_t to, const char* name) {
+    size_t name_len = strlen(name);
+    if (name_len > 0) {
+        for (size_t i = from; i < to; i++) {
+            ((char*)address)[i] = name[i % name_len];
+        }
+    } else {
+        memset((char*)address + from, 0, to - from);
+    }
+}
+
+/**
+ * Llena el contenido de una variable con su nombre, salvo en el pool fantasma.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param address Inicio del bloque de la variable
+ * @param from Primer byte (relativo al bloque) a rellenar
+ * @param to Byte final (exclusivo) a rellenar
+ * @param name Nombre de la variable
+ */
+void fill_payload(MemoryManager* mm, void* address, size_t from, size_t to, const char* name) {
+    if (!mm->phantom) {
+        fill_with_name(address, from, to, name);
+        touch_pool(mm, (char*)address + from, to > from ? to - from : 0);
+    }
+}
+
+/**
+ * Copia el contenido de una variable reubicada, salvo en el pool fantasma.
+ * 
+ * Usa memmove porque el bloque nuevo puede solaparse con el anterior si este
+ * se fusionó con sus vecinos.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param to Dirección de destino
+ * @param from Dirección de origen
+ * @param size Bytes a copiar
+ */
+void copy_payload(MemoryManager* mm, void* to, const void* from, size_t size) {
+    if (!mm->phantom) {
+        memmove(to, from, size);
+        touch_pool(mm, to, size);
+    }
+}
+
+/**
+ * Selecciona un bloque libre, lo marca como ocupado y lo recorta al tamaño pedido.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Tamaño en bytes a reservar
+ * @param label_id ID de la etiqueta del bloque (nombre de la variable, hilo o región)
+ * @return Dirección del contenido del bloque reservado, o NULL si no hay espacio suficiente
+ */
+void* take_block(MemoryManager* mm, size_t size, uint32_t label_id) {
+    size_t block_size = block_size_for(mm, size);
+    int block = select_block_coalescing(mm, block_size, 1);
+    if (block == BLOCK_NONE) {
+        return NULL;
+    }
+    mark_block_used(mm, block, label_id);
+    split_block(mm, block, block_size);
+    return payload_address(mm, block);
+}
+
+/**
+ * Reserva un chunk nuevo para una región y lo convierte en el chunk actual.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param region Región que recibe el chunk
+ * @param size Tamaño del chunk en bytes
+ * @return true si se reservó el chunk, false si no hay memoria
+ */
+bool region_add_chunk(MemoryManager* mm, Region* region, size_t size) {
+    if (region->chunk_count == region->chunk_capacity) {
+        int capacity = region->chunk_capacity ? region->chunk_capacity * 2 : 4;
+        void** chunks = (void**)realloc(region->chunks, (size_t)capacity * sizeof(void*));
+        if (!chunks) {
+            return false;
+        }
+        region->chunks = chunks;
+        region->chunk_capacity = capacity;
+    }
+    char* address = (char*)take_block(mm, size, region->label_id);
+    if (!address) {
+        return false;
+    }
+    region->chunks[region->chunk_count++] = address;
+    region->reserved += size;
+    region->bump = address;
+    region->limit = address + size;
+    return true;
+}
+
+/**
+ * Crea una región de asignación por desplazamiento (bump allocation).
+ * 
+ * Las variables asignadas mientras la región está activa se colocan una tras
+ * otra dentro de bloques grandes (chunks) reservados del pool, sin buscar en
+ * la tabla de bloques ni tocar la tabla global de variables. END_REGION las
+ * libera todas juntas devolviendo solo los chunks. Las regiones se pueden
+ * anidar: ALLOC siempre usa la región más interna.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre de la región en la tabla de símbolos
+ * @param chunk_size Tamaño del primer chunk en bytes (0 = REGION_CHUNK_SIZE)
+ * @return true si la región se abrió, false si se superó el anidamiento o no hay memoria
+ */
+bool begin_region(MemoryManager* mm, uint32_t name_id, size_t chunk_size) {
+    const char* name = symbol_name(mm, name_id);
+    if (mm->region_depth >= MAX_REGION_DEPTH) {
+        op_error(mm, "Error: Se alcanzó el máximo de regiones anidadas (%d)\n", MAX_REGION_DEPTH);
+        return false;
+    }
+    if (!mm->regions) {
+        mm->regions = (Region*)calloc(MAX_REGION_DEPTH, sizeof(Region));
+        if (!mm->regions) {
+            op_error(mm, "Error: No hay memoria para la región '%s'\n", name);
+            return false;
+        }
+    }
+
+    Region* region = &mm->regions[mm->region_depth];
+    memset(region, 0, sizeof(Region));
+    region->name_id = name_id;
+    char label[MAX_NAME_LENGTH];
+    snprintf(label, sizeof(label), "región %.40s", name);
+    region->label_id = name_table_intern(&mm->symbols, label);
+    region->chunk_size = chunk_size > 0 ? chunk_size : REGION_CHUNK_SIZE;
+    if (!region_add_chunk(mm, region, region->chunk_size)) {
+        op_error(mm, "Error: No hay suficiente memoria para la región '%s'\n", name);
+        free(region->chunks);
+        region->chunks = NULL;
+        return false;
+    }
+    region->epoch = ++mm->region_epoch;
+    mm->region_depth++;
+
+    op_message(mm, "BEGIN_REGION: Región '%s' abierta con %zu bytes\n", name, region->chunk_size);
+    region->chunk_size *= 2;
+    return true;
+}
+
+/**
+ * Busca una variable en las regiones activas.
+ * 
+ * Usa region_index, así que cuesta O(1) sin importar cuántas variables
+ * tengan las regiones (un nombre vive en una sola región a la vez). Las
+ * entradas de regiones ya cerradas se descartan por su número de apertura.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre de la variable
+ * @param owner Salida opcional: región donde está la variable
+ * @return Puntero a la variable, NULL si no está en ninguna región activa
+ */
+Variable* find_region_variable(MemoryManager* mm, uint32_t name_id, Region** owner) {
+    if (name_id >= mm->region_index_capacity) {
+        return NULL;
+    }
+    RegionSlot* slot = &mm->region_index[name_id];
+    if (slot->position == 0 || slot->depth >= (uint32_t)mm->region_depth ||
+        mm->regions[slot->depth].epoch != slot->epoch) {
+        return NULL;
+    }
+    Region* region = &mm->regions[slot->depth];
+    if (owner) {
+        *owner = region;
+    }
+    return &region->variables[slot->position - 1];
+}
+
+/**
+ * Asegura espacio en region_index para el ID dado (crece al doble).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre de la variable
+ * @return true si hay espacio, false si no hay memoria
+ */
+bool region_index_reserve(MemoryManager* mm, uint32_t name_id) {
+    if (name_id < mm->region_index_capacity) {
+        return true;
+    }
+    uint32_t new_capacity = mm->region_index_capacity ? mm->region_index_capacity : VARIABLE_TABLE_INITIAL;
+    while (new_capacity <= name_id) {
+        new_capacity *= 2;
+    }
+    RegionSlot* index = (RegionSlot*)realloc(mm->region_index, (size_t)new_capacity * sizeof(RegionSlot));
+    if (!index) {
+        return false;
+    }
+    memset(index + mm->region_index_capacity, 0,
+           (size_t)(new_capacity - mm->region_index_capacity) * sizeof(RegionSlot));
+    mm->region_index = index;
+    mm->region_index_capacity = new_capacity;
+    return true;
+}
+
+/**
+ * Obtiene espacio contiguo de la región actual desplazando el puntero.
+ * 
+ * Si el chunk actual no alcanza, reserva otro del pool del doble de tamaño
+ * que el anterior (o del tamaño de la solicitud si es mayor, o solo de ese
+ * tamaño si el doble no cabe), así que una región con n bytes ocupa O(log n)
+ * chunks. El espacio sobrante del chunk anterior se pierde hasta END_REGION,
+ * como en cualquier asignador por desplazamiento.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param region Región activa
+ * @param size Bytes solicitados
+ * @param align Alineación de la dirección (potencia de 2; 1 = sin alineación)
+ * @return Dirección del espacio, NULL si no hay memoria
+ */
+void* region_bump(MemoryManager* mm, Region* region, size_t size, size_t align) {
+    size_t available = (size_t)(region->limit - region->bump);
+    size_t padding = alignment_padding_at(mm, (size_t)(region->bump - (char*)mm->memory_pool), align);
+    if (available < size || available - size < padding) {
+        if (size > SIZE_MAX - align) {
+            return NULL;
+        }
+        size_t needed = size + align - 1;
+        size_t chunk = needed > region->chunk_size ? needed : region->chunk_size;
+        if (!region_add_chunk(mm, region, chunk) && (chunk == needed || !region_add_chunk(mm, region, needed))) {
+            return NULL;
+        }
+        if (region->chunk_size <= SIZE_MAX / 2) {
+            region->chunk_size *= 2;
+        }
+        padding = alignment_padding_at(mm, (size_t)(region->bump - (char*)mm->memory_pool), align);
+    }
+    // El relleno queda sin usar hasta END_REGION
+    region->bump += padding;
+    region->padding += padding;
+    mm->alignment_padding += padding;
+    mm->padding_live += padding;
+    void* address = region->bump;
+    region->bump += size;
+    region->used += size;
+    return address;
+}
+
+/**
+ * ALLOC dentro de la región más interna: O(1), sin recorrer la tabla de bloques.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre único de la variable
+ * @param size Tamaño en bytes
+ * @param align Alineación de la dirección (potencia de 2; 1 = sin alineación)
+ * @return true si la asignación fue exitosa, false si no hay memoria
+ */
+bool region_alloc(MemoryManager* mm, uint32_t name_id, size_t size, size_t align) {
+    Region* region = &mm->regions[mm->region_depth - 1];
+    const char* var_name = symbol_name(mm, name_id);
+    if (region->variable_count == region->variable_capacity) {
+        int capacity = region->variable_capacity ? region->variable_capacity * 2 : 16;
+        Variable* variables = (Variable*)realloc(region->variables, (size_t)capacity * sizeof(Variable));
+        if (!variables) {
+            op_error(mm, "Error: No hay memoria para registrar '%s'\n", var_name);
+            return false;
+        }
+        region->variables = variables;
+        region->variable_capacity = capacity;
+    }
+    if (!region_index_reserve(mm, name_id)) {
+        op_error(mm, "Error: No hay memoria para registrar '%s'\n", var_name);
+        return false;
+    }
+
+    void* address = region_bump(mm, region, size, align);
+    if (!address) {
+        op_error(mm, "Error: No hay suficiente memoria para asignar %zu bytes a '%s' en la región '%s'\n",
+                 size, var_name, symbol_name(mm, region->name_id));
+        return false;
+    }
+
+    Variable* var = &region->variables[region->variable_count];
+    var->name_id = name_id;
+    var->address = address;
+    var->size = size;
+    RegionSlot* slot = &mm->region_index[name_id];
+    slot->position = (uint32_t)++region->variable_count;
+    slot->depth = (uint32_t)(mm->region_depth - 1);
+    slot->epoch = region->epoch;
+    region->allocs++;
+    region->live_bytes += size;
+    mm->requested_bytes += size;
+    if (region->variable_count - region->freed > region->peak_live) {
+        region->peak_live = region->variable_count - region->freed;
+    }
+    fill_payload(mm, address, 0, size, var_name);
+
+    op_message(mm, "ALLOC: Variable '%s' asignada con %zu bytes en la región '%s'\n", var_name, size,
+           symbol_name(mm, region->name_id));
+    return true;
+}
+
+/**
+ * REALLOC de una variable de región.
+ * 
+ * Si la variable es la última asignada del chunk actual crece o se reduce en
+ * el lugar moviendo el puntero; si no (o si su dirección no cumple la nueva
+ * alineación), se copia a espacio nuevo de la misma región (el espacio
+ * anterior se recupera en END_REGION).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param region Región dueña de la variable
+ * @param var Variable a redimensionar
+ * @param new_size Nuevo tamaño en bytes
+ * @param align Alineación de la dirección (potencia de 2; 1 = sin alineación)
+ * @return true si el redimensionamiento fue exitoso, false si no hay memoria
+ */
+bool region_realloc(MemoryManager* mm, Region* region, Variable* var, size_t new_size, size_t align) {
+    const char* var_name = symbol_name(mm, var->name_id);
+    size_t old_size = var->size;
+    bool is_last = (char*)var->address + var->size == region->bump;
+    bool misaligned = ((uintptr_t)var->address & (uintptr_t)(align - 1)) != 0;
+    if (is_last && !misaligned && (size_t)(region->limit - (char*)var->address) >= new_size) {
+        region->bump = (char*)var->address + new_size;
+        region->used = region->used - old_size + new_size;
+    } else if (new_size > old_size || misaligned) {
+        void* address = region_bump(mm, region, new_size, align);
+        if (!address) {
+            op_error(mm, "Error: No hay suficiente memoria para expandir '%s'\n", var_name);
+            return false;
+        }
+        copy_payload(mm, address, var->address, old_size < new_size ? old_size : new_size);
+        var->address = address;
+    }
+    var->size = new_size;
+    region->live_bytes = region->live_bytes - old_size + new_size;
+    mm->requested_bytes = mm->requested_bytes - old_size + new_size;
+    if (new_size > old_size) {
+        fill_payload(mm, var->address, old_size, new_size, var_name);
+    }
+    op_message(mm, "REALLOC: Variable '%s' redimensionada de %zu a %zu bytes en la región '%s'\n",
+           var_name, old_size, new_size, symbol_name(mm, region->name_id));
+    return true;
+}
+
+/**
+ * FREE de una variable de región.
+ * 
+ * La memoria no se recupera hasta END_REGION; solo se marca la entrada como
+ * liberada (NAME_ID_NONE) para que el nombre se pueda volver a usar.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param region Región dueña de la variable
+ * @param var Variable a liberar
+ */
+void region_free(MemoryManager* mm, Region* region, Variable* var) {
+    op_message(mm, "FREE: Variable '%s' liberada (la región '%s' recupera su memoria en END_REGION)\n",
+           symbol_name(mm, var->name_id), symbol_name(mm, region->name_id));
+    mm->region_index[var->name_id].position = 0;
+    var->name_id = NAME_ID_NONE;
+    region->freed++;
+    region->live_bytes -= var->size;
+    mm->requested_bytes -= var->size;
+}
+
+/**
+ * Cierra la región más interna y libera de una vez todas sus variables.
+ * 
+ * No recorre las variables: marca como libres los chunks de la región (uno por
+ * cada vez que se agotó el chunk anterior), fusiona una sola vez y descarta su
+ * tabla; sus entradas en region_index quedan invalidadas por el número de
+ * apertura. Imprime las estadísticas de uso de la región.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre esperado de la región (NAME_ID_NONE = la más interna)
+ * @return true si se cerró la región, false si no hay regiones abiertas o el nombre no coincide
+ */
+bool end_region(MemoryManager* mm, uint32_t name_id) {
+    if (mm->region_depth == 0) {
+        op_error(mm, "Error: END_REGION sin región abierta\n");
+        return false;
+    }
+    Region* region = &mm->regions[mm->region_depth - 1];
+    if (name_id != NAME_ID_NONE && name_id != region->name_id) {
+        op_error(mm, "Error: END_REGION '%s' no coincide con la región abierta '%s'\n",
+                 symbol_name(mm, name_id), symbol_name(mm, region->name_id));
+        return false;
+    }
+
+    int released = 0;
+    for (int i = 0; i < region->chunk_count; i++) {
+        if (mark_block_free_at(mm, region->chunks[i])) {
+            released++;
+        }
+    }
+    request_merge_batch(mm, released);
+    mm->requested_bytes -= region->live_bytes;
+    mm->padding_live -= region->padding;
+    mm->region_depth--;
+
+    op_message(mm, "END_REGION: Región '%s' liberada: %zu asignaciones (%d activas al cerrar, pico %d), "
+           "%zu bytes usados de %zu reservados en %d bloques (%.1f%% de uso)\n",
+           symbol_name(mm, region->name_id), region->allocs, region->variable_count - region->freed, region->peak_live,
+           region->used, region->reserved, region->chunk_count,
+           region->reserved > 0 ? 100.0 * (double)region->used / (double)region->reserved : 0.0);
+    free(region->variables);
+    free(region->chunks);
+    region->variables = NULL;
+    region->chunks = NULL;
+    return true;
+}
+
+/**
+ * Busca por búsqueda binaria la asignación grande que empieza en una dirección.
+ * 
+ * @param table Tabla de asignaciones grandes
+ * @param address Dirección de la variable
+ * @return Índice del mapeo, BLOCK_NONE si la dirección no es de una asignación grande
+ */
+int large_table_find(const LargeTable* table, const void* address) {
+    int low = 0;
+    int high = table->count - 1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        if ((uintptr_t)table->entries[mid].address < (uintptr_t)address) {
+            low = mid + 1;
+        } else if ((uintptr_t)table->entries[mid].address > (uintptr_t)address) {
+            high = mid - 1;
+        } else {
+            return mid;
+        }
+    }
+    return BLOCK_NONE;
+}
+
+/**
+ * Agrega un mapeo a la tabla de asignaciones grandes conservando el orden.
+ * 
+ * @param table Tabla de asignaciones grandes
+ * @param address Inicio del mapeo
+ * @param length Bytes mapeados
+ * @param name_id ID del nombre de la variable
+ * @return true si se agregó, false si la tabla no pudo crecer
+ */
+bool large_table_insert(LargeTable* table, void* address, size_t length, uint32_t name_id) {
+    if (table->count == table->capacity) {
+        int capacity = table->capacity ? table->capacity * 2 : 16;
+        LargeMapping* entries = (LargeMapping*)realloc(table->entries, (size_t)capacity * sizeof(LargeMapping));
+        if (!entries) {
+            return false;
+        }
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+    int index = table->count;
+    while (index > 0 && (uintptr_t)table->entries[index - 1].address > (uintptr_t)address) {
+        table->entries[index] = table->entries[index - 1];
+        index--;
+    }
+    table->entries[index].address = address;
+    table->entries[index].length = length;
+    table->entries[index].name_id = name_id;
+    table->count++;
+    return true;
+}
+
+/**
+ * Quita un mapeo de la tabla de asignaciones grandes.
+ * 
+ * @param table Tabla de asignaciones grandes
+ * @param index Índice del mapeo
+ */
+void large_table_remove(LargeTable* table, int index) {
+    memmove(&table->entries[index], &table->entries[index + 1],
+            (size_t)(table->count - index - 1) * sizeof(LargeMapping));
+    table->count--;
+}
+
+/**
+ * Mapea memoria nueva para una asignación grande.
+ * 
+ * El tamaño se redondea a páginas. Si la alineación pedida supera la página,
+ * mapea de más y recorta los extremos. En el pool fantasma el mapeo no tiene
+ * permisos ni respaldo, igual que el pool.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param size Bytes pedidos
+ * @param align Alineación de la dirección (potencia de 2)
+ * @param length Salida: bytes mapeados
+ * @return Dirección del mapeo, NULL si no se pudo mapear
+ */
+void* large_map(MemoryManager* mm, size_t size, size_t align, size_t* length) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t extra = align > page ? align - page : 0;
+    if (size > SIZE_MAX - page - extra) {
+        return NULL;
+    }
+    size_t mapped = (size + page - 1) / page * page;
+    int prot = mm->phantom ? PROT_NONE : PROT_READ | PROT_WRITE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | (mm->phantom ? MAP_NORESERVE : 0);
+    char* raw = (char*)mmap(NULL, mapped + extra, prot, flags, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+    char* address = raw;
+    if (extra > 0) {
+        address = (char*)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+        if (address > raw) {
+            munmap(raw, (size_t)(address - raw));
+        }
+        if (address + mapped < raw + mapped + extra) {
+            munmap(address + mapped, (size_t)(raw + mapped + extra - (address + mapped)));
+        }
+    }
+    *length = mapped;
+    return address;
+}
+
+/**
+ * Devuelve al sistema el mapeo de una asignación grande y lo quita de la tabla.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param index Índice del mapeo
+ * @param size Bytes que pedía la variable
+ */
+void large_release(MemoryManager* mm, int index, size_t size) {
+    LargeMapping* mapping = &mm->large.entries[index];
+    munmap(mapping->address, mapping->length);
+    mm->large_bytes -= mapping->length;
+    mm->large_requested -= size;
+    large_table_remove(&mm->large, index);
+}
+
+/**
+ * Asigna una variable grande con su propio mmap (--large-threshold).
+ * 
+ * No toca la tabla de bloques: la solicitud no pasa por la política de
+ * búsqueda ni divide bloques del pool, como el umbral de mmap de malloc.
+ * El llamador ya reservó el espacio en la tabla de variables.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre de la variable
+ * @param size Tamaño en bytes a asignar
+ * @param align Alineación de la dirección (potencia de 2)
+ * @return true si la asignación fue exitosa, false si no se pudo mapear
+ */
+bool large_alloc(MemoryManager* mm, uint32_t name_id, size_t size, size_t align) {
+    const char* var_name = symbol_name(mm, name_id);
+    size_t length;
+    void* address = large_map(mm, size, align, &length);
+    if (!address || !large_table_insert(&mm->large, address, length, name_id)) {
+        if (address) {
+            munmap(address, length);
+        }
+        op_error(mm, "Error: No se pudo mapear memoria para asignar %zu bytes a '%s'\n", size, var_name);
+        return false;
+    }
+    variable_table_add(mm, name_id, address, size);
+    mm->large_allocs++;
+    mm->large_bytes += length;
+    mm->large_requested += size;
+    fill_payload(mm, address, 0, size, var_name);
+
+    op_message(mm, "ALLOC: Variable '%s' asignada con %zu bytes (mmap directo)\n", var_name, size);
+    return true;
+}
+
+/**
+ * Redimensiona una variable grande.
+ * 
+ * Si el nuevo tamaño sigue por encima del umbral, ajusta el mapeo con
+ * mremap (o con un mapeo nuevo si la alineación supera la página); si queda
+ * por debajo, mueve la variable a un bloque del pool y devuelve el mapeo.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param var Variable a redimensionar
+ * @param index Índice de su mapeo en la tabla de asignaciones grandes
+ * @param new_size Nuevo tamaño en bytes
+ * @param align Alineación de la dirección (potencia de 2)
+ * @return true si el redimensionamiento fue exitoso, false en caso de error
+ */
+bool large_realloc(MemoryManager* mm, Variable* var, int index, size_t new_size, size_t align) {
+    const char* var_name = symbol_name(mm, var->name_id);
+    size_t old_size = var->size;
+    size_t copy_size = old_size < new_size ? old_size : new_size;
+    LargeMapping mapping = mm->large.entries[index];
+
+    if (new_size < mm->large_threshold) {
+        size_t block_size = block_size_for(mm, new_size);
+        int block = select_block_coalescing(mm, block_size, align);
+        if (block == BLOCK_NONE) {
+            op_error(mm, "Error: No hay suficiente memoria para mover '%s' al pool\n", var_name);
+            return false;
+        }
+        mark_block_used(mm, block, var->name_id);
+        split_block(mm, block, block_size);
+        void* address = payload_address(mm, block);
+        copy_payload(mm, address, var->address, copy_size);
+        large_release(mm, index, old_size);
+        var->address = address;
+        var->size = new_size;
+        mm->requested_bytes += new_size;
+        fill_payload(mm, address, copy_size, new_size, var_name);
+        op_message(mm, "REALLOC: Variable '%s' reasignada de %zu a %zu bytes\n", var_name, old_size, new_size);
+        return true;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t length = mapping.length;
+    void* address = mapping.address;
+    bool misaligned = ((uintptr_t)address & (uintptr_t)(align - 1)) != 0;
+    if (new_size > SIZE_MAX - page) {
+        address = NULL;
+    } else if (align <= page) {
+        length = (new_size + page - 1) / page * page;
+        if (length != mapping.length) {
+            address = mremap(mapping.address, mapping.length, length, MREMAP_MAYMOVE);
+            address = address == MAP_FAILED ? NULL : address;
+        }
+    } else if (misaligned || (new_size + page - 1) / page * page != mapping.length) {
+        address = large_map(mm, new_size, align, &length);
+        if (address) {
+            copy_payload(mm, address, mapping.address, copy_size);
+            munmap(mapping.address, mapping.length);
+        }
+    }
+    if (!address) {
+        op_error(mm, "Error: No se pudo mapear memoria para redimensionar '%s' a %zu bytes\n", var_name, new_size);
+        return false;
+    }
+
+    // El mapeo pudo moverse: se reubica en la tabla (ya hay capacidad)
+    large_table_remove(&mm->large, index);
+    large_table_insert(&mm->large, address, length, var->name_id);
+    mm->large_bytes = mm->large_bytes - mapping.length + length;
+    mm->large_requested = mm->large_requested - old_size + new_size;
+    var->address = address;
+    var->size = new_size;
+    fill_payload(mm, address, copy_size, new_size, var_name);
+    op_message(mm, "REALLOC: Variable '%s' redimensionada de %zu a %zu bytes (mmap directo)\n",
+               var_name, old_size, new_size);
+    return true;
+}
+
+/**
+ * Mueve una variable del pool a su propio mmap porque crece por encima del umbral.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param var Variable a redimensionar
+ * @param block Bloque del pool que ocupa
+ * @param new_size Nuevo tamaño en bytes
+ * @param align Alineación de la dirección (potencia de 2)
+ * @return true si el redimensionamiento fue exitoso, false si no se pudo mapear
+ */
+bool large_realloc_from_pool(MemoryManager* mm, Variable* var, int block, size_t new_size, size_t align) {
+    const char* var_name = symbol_name(mm, var->name_id);
+    size_t old_size = var->size;
+    size_t copy_size = old_size < new_size ? old_size : new_size;
+    size_t length;
+    void* address = large_map(mm, new_size, align, &length);
+    if (!address || !large_table_insert(&mm->large, address, length, var->name_id)) {
+        if (address) {
+            munmap(address, length);
+        }
+        op_error(mm, "Error: No se pudo mapear memoria para redimensionar '%s' a %zu bytes\n", var_name, new_size);
+        return false;
+    }
+    copy_payload(mm, address, var->address, copy_size);
+    mark_block_free(mm, block);
+    request_merge(mm);
+    mm->requested_bytes -= old_size;
+    mm->large_allocs++;
+    mm->large_bytes += length;
+    mm->large_requested += new_size;
+    var->address = address;
+    var->size = new_size;
+    fill_payload(mm, address, copy_size, new_size, var_name);
+    op_message(mm, "REALLOC: Variable '%s' reasignada de %zu a %zu bytes (mmap directo)\n", var_name, old_size, new_size);
+    return true;
+}
+
+/**
+ * Cuenta las variables activas: las de la tabla y las vivas de las regiones
+ * abiertas (a lo sumo MAX_REGION_DEPTH).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @return Número de variables activas
+ */
+int active_variable_count(const MemoryManager* mm) {
+    int count = mm->variable_count;
+    for (int r = 0; r < mm->region_depth; r++) {
+        count += mm->regions[r].variable_count - mm->regions[r].freed;
+    }
+    return count;
+}
+
+/**
+ * Asigna memoria para una nueva variable.
+ * 
+ * Valida que la variable no exista, que no se haya alcanzado el límite de
+ * variables (incluidas las de regiones abiertas), y que haya suficiente
+ * memoria disponible. Usa el algoritmo
+ * configurado para seleccionar un bloque libre, lo divide si es necesario,
+ * y llena la memoria asignada con el nombre de la variable repetido. Registra
+ * la variable en la tabla de variables. Las solicitudes desde large_threshold
+ * se sirven con su propio mmap (ver large_alloc).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre único de la variable a crear
+ * @param size Tamaño en bytes a asignar
+ * @param align Alineación de la dirección (potencia de 2; 1 = sin alineación)
+ * @return true si la asignación fue exitosa, false en caso de error
+ */
+bool alloc_variable(MemoryManager* mm, uint32_t name_id, size_t size, size_t align) {
+    const char* var_name = symbol_name(mm, name_id);
+    if (align > 1) {
+        mm->aligned_requests++;
+    }
+
+    // Verificar si la variable ya existe
+    if (find_variable(mm, name_id) || find_region_variable(mm, name_id, NULL)) {
+        op_error(mm, "Error: La variable '%s' ya existe\n", var_name);
+        return false;
+    }
+
+    // Validar el límite ANTES de modificar bloques (cuenta también las de regiones)
+    if (mm->max_variables > 0 && active_variable_count(mm) >= mm->max_variables) {
+        op_error(mm, "Error: Se alcanzó el límite de variables (%d)\n", mm->max_variables);
+        return false;
+    }
+
+    // Con una región abierta, la variable se asigna dentro de ella
+    if (mm->region_depth > 0) {
+        return region_alloc(mm, name_id, size, align);
+    }
+    if (!variable_table_reserve(mm, name_id)) {
+        op_error(mm, "Error: No hay memoria para registrar '%s'\n", var_name);
+        return false;
+    }
+
+    // Las solicitudes grandes no pasan por el pool
+    if (mm->large_threshold > 0 && size >= mm->large_threshold) {
+        return large_alloc(mm, name_id, size, align);
+    }
+    
+    // Seleccionar bloque según el algoritmo (fusionando pendientes si hace falta)
+    size_t block_size = block_size_for(mm, size);
+    int block = select_block_coalescing(mm, block_size, align);
+    if (block == BLOCK_NONE) {
+        op_error(mm, "Error: No hay suficiente memoria para asignar %zu bytes a '%s'\n", size, var_name);
+        return false;
+    }
+    
+    // Asignar el bloque
+    mark_block_used(mm, block, name_id);
+    
+    // Dividir el bloque si es necesario
+    split_block(mm, block, block_size);
+    char* address = (char*)payload_address(mm, block);
+    
+    // Agregar a la tabla de variables (el espacio ya se reservó)
+    variable_table_add(mm, name_id, address, size);
+    mm->requested_bytes += size;
+    
+    // Llenar toda la memoria con el nombre de la variable (repetido)
+    fill_payload(mm, address, 0, size, var_name);
+    
+    op_message(mm, "ALLOC: Variable '%s' asignada con %zu bytes\n", var_name, size);
+    return true;
+}
+
+/**
+ * Redimensiona una variable existente.
+ * 
+ * Si el nuevo tamaño es menor, reduce el bloque y crea un bloque libre con
+ * el espacio sobrante. Si es mayor, intenta expandir el bloque en el lugar si
+ * hay un bloque libre adyacente. Si no es posible expandir en el lugar,
+ * busca un nuevo bloque más grande, copia los datos, y libera el bloque anterior.
+ * Si la dirección actual no cumple la alineación pedida, la variable siempre
+ * se reubica. Una variable que cruza large_threshold pasa entre el pool y su
+ * propio mmap. En todos los casos, rellena la memoria con el nombre de la variable.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre de la variable a redimensionar
+ * @param new_size Nuevo tamaño en bytes
+ * @param align Alineación de la dirección (potencia de 2; 1 = sin alineación)
+ * @return true si el redimensionamiento fue exitoso, false en caso de error
+ */
+bool realloc_variable(MemoryManager* mm, uint32_t name_id, size_t new_size, size_t align) {
+    const char* var_name = symbol_name(mm, name_id);
+    Variable* var = find_variable(mm, name_id);
+    Region* region = NULL;
+    if (align > 1) {
+        mm->aligned_requests++;
+    }
+    if (!var && (var = find_region_variable(mm, name_id, &region))) {
+        return region_realloc(mm, region, var, new_size, align);
+    }
+    if (!var) {
+        op_error(mm, "Error: La variable '%s' no existe\n", var_name);
+        return false;
+    }
+    int mapping = mm->large.count > 0 ? large_table_find(&mm->large, var->address) : BLOCK_NONE;
+    if (mapping != BLOCK_NONE) {
+        return large_realloc(mm, var, mapping, new_size, align);
+    }
+    
+    // Buscar el bloque asociado
+    BlockTable* table = &mm->blocks;
+    int block = payload_block_at(mm, var->address);
+    
+    if (block == BLOCK_NONE || table->is_free[block]) {
+        op_error(mm, "Error: No se encontró el bloque para '%s'\n", var_name);
+        return false;
+    }
+    if (mm->large_threshold > 0 && new_size >= mm->large_threshold) {
+        return large_realloc_from_pool(mm, var, block, new_size, align);
+    }
+    
+    char* address = (char*)var->address;
+    size_t old_size = var->size;
+    size_t block_size = block_size_for(mm, new_size);
+    bool misaligned = ((uintptr_t)address & (uintptr_t)(align - 1)) != 0;
+    
+    if (new_size <= old_size && !misaligned) {
+        // Reducir el tamaño
+        if (table->sizes[block] > block_size) {
+            // Crear un nuevo bloque libre con el espacio sobrante
+            size_t tail_end = table->offsets[block] + table->sizes[block];
+            split_block(mm, block, block_size);
+            release_free_pages(mm, table->offsets[block] + block_size, tail_end);
+            request_merge(mm);
+        }
+        mm->requested_bytes = mm->requested_bytes - old_size + new_size;
+        var->size = new_size;
+       // --- NUEVO: Rellenar TODO el bloque resultante con el nombre de la variable ---
+        // La consigna exige que en REALLOC se rellene toda la memoria con el nombre.
+        // Aunque la región "cabeza" ya estaba llena, lo garantizamos explícitamente.
+        fill_payload(mm, address, 0, new_size, var_name);
+
+        op_message(mm, "REALLOC: Variable '%s' redimensionada de %zu a %zu bytes\n", var_name, old_size, new_size);
+        return true;
+    } else {
+        // Intentar expandir el bloque
+        // Verificar si hay espacio libre después del bloque
+        size_t available = misaligned ? 0 : in_place_capacity(mm, block);
+        if (!misaligned && available < block_size && mm->pending_frees > 0) {
+            // En modo diferido el vecino libre puede estar partido en varios bloques
+            // (la fusión compacta la tabla, así que el índice puede cambiar)
+            flush_pending_merges(mm);
+            block = payload_block_at(mm, address);
+            available = in_place_capacity(mm, block);
+        }
+        int next = block + 1;
+        
+        if (!misaligned && available >= block_size) {
+            // Expandir en el lugar (el bloque puede ya tener el espacio si no se dividió)
+            size_t needed = block_size > table->sizes[block] ? block_size - table->sizes[block] : 0;
+            if (needed > 0) {
+                if (mm->header_size > 0 && table->sizes[next] - needed < BLOCK_MIN_SIZE) {
+                    // El sobrante no alcanzaría para sus etiquetas: se absorbe entero
+                    needed = table->sizes[next];
+                }
+                table->sizes[block] += needed;
+                note_high_water(mm, block);
+                if (table->name_ids[next] == NAME_ID_PADDING) {
+                    // El relleno absorbido ya no está sin usar
+                    mm->padding_live -= needed;
+                    if (needed == table->sizes[next]) {
+                        mm->padding_live_blocks--;
+                    }
+                }
+                free_histogram_update(mm, table->sizes[next], -1);
+                table->sizes[next] -= needed;
+                mm->free_bytes -= needed;
+                if (table->sizes[next] == 0) {
+                    block_table_remove(table, next);
+                    mm->free_block_count--;
+                } else {
+                    table->offsets[next] += needed;
+                    free_histogram_update(mm, table->sizes[next], 1);
+                    note_free_block_changed(mm, next);
+                    write_block_tags(mm, next);
+                }
+                write_block_tags(mm, block);
+            }
+            mm->requested_bytes = mm->requested_bytes - old_size + new_size;
+            var->size = new_size;
+            // Llenar toda la nueva memoria con el nombre (repetido)
+            fill_payload(mm, address, old_size, new_size, var_name);
+            op_message(mm, "REALLOC: Variable '%s' expandida de %zu a %zu bytes\n", var_name, old_size, new_size);
+            return true;
+        }
+        
+        // No se puede expandir en el lugar, intentar reasignar
+        // Liberar el bloque actual
+        // (sus páginas se devuelven y sus etiquetas se reescriben recién después de copiar los datos)
+        void* old_addr = var->address;
+        size_t old_offset = table->offsets[block];
+        size_t old_block_size = table->sizes[block];
+        mm->hold_page_release = true;
+        if (mm->header_size > 0) {
+            mm->tag_hold_from = old_offset;
+            mm->tag_hold_to = old_offset + old_block_size;
+        }
+        mark_block_free(mm, block);
+        request_merge(mm);
+        
+        // Intentar asignar uno nuevo
+        int new_block = select_block_coalescing(mm, block_size, align);
+        if (new_block == BLOCK_NONE) {
+            op_error(mm, "Error: No hay suficiente memoria para expandir '%s'\n", var_name);
+            // Restaurar: el bloque original pudo fusionarse con sus vecinos
+            block = reserve_range(mm, (char*)mm->memory_pool + old_offset, old_block_size);
+            if (block != BLOCK_NONE) {
+                table->name_ids[block] = name_id;
+            }
+            mm->hold_page_release = false;
+            mm->tag_hold_from = mm->tag_hold_to = 0;
+            write_range_tags(mm, old_offset, old_offset + old_block_size);
+            return false;
+        }
+        
+        // Copiar datos (las regiones pueden solaparse si el bloque se fusionó)
+        size_t copy_size = old_size < new_size ? old_size : new_size;
+        copy_payload(mm, payload_address(mm, new_block), old_addr, copy_size);
+        
+        // Asignar nuevo bloque
+        mark_block_used(mm, new_block, name_id);
+        split_block(mm, new_block, block_size);
+        mm->hold_page_release = false;
+        mm->tag_hold_from = mm->tag_hold_to = 0;
+        write_range_tags(mm, old_offset, old_offset + old_block_size);
+        release_free_pages(mm, old_offset, old_offset + old_block_size);
+        
+        // Actualizar variable
+        var->address = payload_address(mm, new_block);
+        mm->requested_bytes = mm->requested_bytes - old_size + new_size;
+        var->size = new_size;
+        
+        // Llenar toda la nueva memoria con el nombre (repetido)
+        fill_payload(mm, var->address, copy_size, new_size, var_name);
+        
+        op_message(mm, "REALLOC: Variable '%s' reasignada de %zu a %zu bytes\n", var_name, old_size, new_size);
+        return true;
+    }
+}
+
+/**
+ * Libera la memoria asignada a una variable.
+ * 
+ * Busca la variable por nombre, marca su bloque como libre, fusiona bloques
+ * libres adyacentes para reducir fragmentación, y elimina la variable de
+ * la tabla reorganizando las entradas para mantener la tabla compacta.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param name_id ID del nombre de la variable a liberar
+ * @return true si la liberación fue exitosa, false si la variable no existe
+ */
+bool free_variable(MemoryManager* mm, uint32_t name_id) {
+    const char* var_name = symbol_name(mm, name_id);
+    Variable* var = find_variable(mm, name_id);
+    Region* region = NULL;
+    if (!var && (var = find_region_variable(mm, name_id, &region))) {
+        region_free(mm, region, var);
+        return true;
+    }
+    if (!var) {
+        op_error(mm, "Error: La variable '%s' no existe\n", var_name);
+        return false;
+    }
+    int mapping = mm->large.count > 0 ? large_table_find(&mm->large, var->address) : BLOCK_NONE;
+    if (mapping != BLOCK_NONE) {
+        // El mapeo se devuelve entero al sistema, sin fusionar bloques del pool
+        large_release(mm, mapping, var->size);
+        variable_table_remove(mm, var);
+        op_message(mm, "FREE: Variable '%s' liberada (mmap directo)\n", var_name);
+        return true;
+    }
+    
+    // Buscar el bloque asociado
+    int block = payload_block_at(mm, var->address);
+    
+    if (block == BLOCK_NONE || mm->blocks.is_free[block]) {
+        op_error(mm, "Error: No se encontró el bloque para '%s'\n", var_name);
+        return false;
+    }
+    
+    // Liberar el bloque
+    mark_block_free(mm, block);
+    mm->requested_bytes -= var->size;
+    
+    // Fusionar bloques libres adyacentes (inmediato o diferido según el modo)
+    request_merge(mm);
+    
+    // Eliminar de la tabla de variables
+    variable_table_remove(mm, var);
+    
+    op_message(mm, "FREE: Variable '%s' liberada\n", var_name);
+    return true;
+}
+
+/**
+ * Asigna memoria para una nueva variable identificada por su nombre.
+ * 
+ * Interna el nombre en la tabla de símbolos del gestor y delega en
+ * alloc_variable.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param var_name Nombre único de la variable a crear
+ * @param size Tamaño en bytes a asignar
+ * @return true si la asignación fue exitosa, false en caso de error
+ */
+bool alloc_memory(MemoryManager* mm, const char* var_name, size_t size) {
+    uint32_t name_id = name_table_intern(&mm->symbols, var_name);
+    if (name_id == NAME_ID_NONE) {
+        fprintf(stderr, "Error: No hay memoria para registrar '%s'\n", var_name);
+        return false;
+    }
+    return alloc_variable(mm, name_id, size, 1);
+}
+
+/**
+ * Redimensiona una variable identificada por su nombre (ver realloc_variable).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param var_name Nombre de la variable a redimensionar
+ * @param new_size Nuevo tamaño en bytes
+ * @return true si el redimensionamiento fue exitoso, false en caso de error
+ */
+bool realloc_memory(MemoryManager* mm, const char* var_name, size_t new_size) {
+    uint32_t name_id = name_table_find(&mm->symbols, var_name);
+    if (name_id == NAME_ID_NONE) {
+        fprintf(stderr, "Error: La variable '%s' no existe\n", var_name);
+        return false;
+    }
+    return realloc_variable(mm, name_id, new_size, 1);
+}
+
+/**
+ * Libera una variable identificada por su nombre (ver free_variable).
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param var_name Nombre de la variable a liberar
+ * @return true si la liberación fue exitosa, false si la variable no existe
+ */
+bool free_memory(MemoryManager* mm, const char* var_name) {
+    uint32_t name_id = name_table_find(&mm->symbols, var_name);
+    if (name_id == NAME_ID_NONE) {
+        fprintf(stderr, "Error: La variable '%s' no existe\n", var_name);
+        return false;
+    }
+    return free_variable(mm, name_id);
+}
+
+/**
+ * Índice de fragmentación externa: 1 - mayor bloque libre / memoria libre.
+ * 
+ * Vale 0 cuando toda la memoria libre está en un solo bloque y se acerca a 1
+ * cuando está repartida en muchos bloques pequeños, es decir, cuando una
+ * solicitud puede fallar aunque sobre memoria en total.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @return Índice entre 0 y 1 (0 si no hay memoria libre)
+ */
+double external_fragmentation(MemoryManager* mm) {
+    if (mm->free_bytes == 0) {
+        return 0.0;
+    }
+    return 1.0 - (double)largest_free_block(mm) / (double)mm->free_bytes;
+}
+
+/**
+ * Fragmentación interna: bytes ocupados que ninguna variable pidió.
+ * 
+ * Incluye los bloques que no se pudieron dividir y el espacio de las regiones
+ * que no llegó a entregarse o cuyas variables ya se liberaron.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @return Bytes ocupados por encima de lo solicitado
+ */
+size_t internal_fragmentation(MemoryManager* mm) {
+    size_t used = mm->pool_size - mm->free_bytes;
+    return used > mm->requested_bytes ? used - mm->requested_bytes : 0;
+}
+
+/**
+ * Bytes del pool que ocupan las etiquetas de bloque (--headers).
+ * 
+ * Cada bloque lleva una cabecera y cada bloque libre, además, un pie. Las
+ * cabeceras de los bloques ocupados ya cuentan en la fragmentación interna.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @return Bytes de etiquetas (0 sin --headers)
+ */
+size_t tag_bytes(MemoryManager* mm) {
+    if (mm->header_size == 0) {
+        return 0;
+    }
+    return (size_t)mm->blocks.count * mm->header_size + (size_t)mm->free_block_count * BLOCK_FOOTER_SIZE;
+}
+
+/**
+ * Bytes de memoria del proceso que ocupan las estructuras de control.
+ * 
+ * Cuenta la capacidad reservada (no solo la usada) de la tabla de bloques,
+ * el montículo de bloques libres, la tabla de variables y la de nombres, que
+ * es lo que el gestor paga por encima del pool para administrarlo.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @return Bytes de metadatos
+ */
+size_t metadata_bytes(MemoryManager* mm) {
+    size_t block_entry = sizeof(size_t) * 2 + sizeof(bool) + sizeof(uint32_t);
+    return (size_t)mm->blocks.capacity * block_entry +
+           (size_t)mm->largest_free.capacity * sizeof(FreeBlockEntry) +
+           (size_t)mm->variable_capacity * sizeof(Variable) +
+           (size_t)mm->variable_index_capacity * sizeof(uint32_t) +
+           (size_t)mm->region_index_capacity * sizeof(RegionSlot) +
+           (mm->resident_map_pages + 63) / 64 * sizeof(uint64_t) +
+           (size_t)mm->symbols.capacity * MAX_NAME_LENGTH +
+           mm->symbols.slot_count * sizeof(uint32_t);
+}
+
+/**
+ * Porcentaje de la memoria bajo la marca de agua que está ocupada.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @return Utilización entre 0 y 100 (100 si nunca se ocupó nada)
+ */
+double high_water_utilization(MemoryManager* mm) {
+    if (mm->high_water == 0) {
+        return 100.0;
+    }
+    return 100.0 * (double)(mm->pool_size - mm->free_bytes) / (double)mm->high_water;
+}
+
+/**
+ * Emite un registro "stats" con los contadores y métricas de fragmentación.
+ * 
+ * @param mm Puntero al gestor de memoria (con salida estructurada)
+ * @param source Origen del registro: "print", "stats", "interval" o "final"
+ */
+void emit_stats_record(MemoryManager* mm, const char* source) {
+    OutputBuffer* out = mm->output;
+    record_begin(out, RECORD_STATS);
+    record_string(out, "source", source);
+    record_size(out, "seq", mm->executed_ops);
+    record_size(out, "pool_bytes", mm->pool_size);
+    record_size(out, "free_bytes", mm->free_bytes);
+    record_size(out, "free_blocks", (size_t)mm->free_block_count);
+    record_size(out, "used_bytes", mm->pool_size - mm->free_bytes);
+    record_size(out, "used_blocks", (size_t)(mm->blocks.count - mm->free_block_count));
+    record_size(out, "largest_free", largest_free_block(mm));
+    record_double(out, "external_fragmentation", external_fragmentation(mm));
+    record_size(out, "internal_fragmentation", internal_fragmentation(mm));
+    record_size(out, "high_water", mm->high_water);
+    record_double(out, "high_water_utilization", high_water_utilization(mm));
+    record_size(out, "pending_frees", (size_t)mm->pending_frees);
+    bool walk = strcmp(source, "print") == 0 || strcmp(source, "final") == 0;
+    record_size(out, "resident_bytes", walk ? pool_resident_bytes(mm) : pool_resident_estimate(mm));
+    record_size(out, "alignment_padding", mm->padding_live);
+    record_size(out, "alignment_padding_total", mm->alignment_padding);
+    record_size(out, "tag_bytes", tag_bytes(mm));
+    record_size(out, "large_bytes", mm->large_bytes);
+    record_end(out);
+}
+
+/**
+ * Imprime las métricas de fragmentación en la sección de estadísticas de PRINT.
+ * 
+ * Todas se obtienen de contadores incrementales; solo el histograma recorre
+ * sus FREE_HISTOGRAM_BUCKETS clases.
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void print_fragmentation_metrics(MemoryManager* mm) {
+    printf("  Fragmentación externa: %.3f (mayor bloque libre: %zu bytes)\n",
+           external_fragmentation(mm), largest_free_block(mm));
+    printf("  Fragmentación interna: %zu bytes\n", internal_fragmentation(mm));
+    printf("  Marca de agua: %zu bytes (utilización %.1f%%)\n", mm->high_water, high_water_utilization(mm));
+    printf("  Memoria residente del pool: %zu bytes\n", pool_resident_bytes(mm));
+    if (mm->aligned_requests > 0) {
+        printf("  Relleno de alineación: %zu bytes sin usar (%zu bloques libres de relleno); "
+               "%zu bytes en %zu bloques separados en total (%zu solicitudes alineadas)\n",
+               mm->padding_live, mm->padding_live_blocks, mm->alignment_padding, mm->padding_blocks,
+               mm->aligned_requests);
+    }
+    if (mm->header_size > 0) {
+        printf("  Etiquetas en el pool: %zu bytes (cabecera de %zu bytes por bloque, pie de %d en los libres)\n",
+               tag_bytes(mm), mm->header_size, BLOCK_FOOTER_SIZE);
+    }
+    if (mm->large_threshold > 0) {
+        printf("  Asignaciones grandes: %d activas, %zu bytes pedidos en %zu bytes mapeados\n",
+               mm->large.count, mm->large_requested, mm->large_bytes);
+    }
+    printf("  Bloques libres por tamaño:\n");
+    for (int k = 0; k < FREE_HISTOGRAM_BUCKETS; k++) {
+        if (mm->free_histogram[k] > 0) {
+            printf("    [%zu, %zu): %d\n", (size_t)1 << k, k < 63 ? (size_t)1 << (k + 1) : SIZE_MAX,
+                   mm->free_histogram[k]);
+        }
+    }
+}
+
+/**
+ * Emite el estado de la memoria como registros: variables, bloques y estadísticas.
+ * 
+ * Las direcciones se expresan como desplazamientos desde el inicio del pool,
+ * que no cambian entre ejecuciones.
+ * 
+ * @param mm Puntero al gestor de memoria (con salida estructurada)
+ */
+void emit_memory_state_records(MemoryManager* mm) {
+    OutputBuffer* out = mm->output;
+    for (int i = 0; i < mm->variable_slots; i++) {
+        if (mm->variables[i].name_id == NAME_ID_NONE) {
+            continue;
+        }
+        record_begin(out, RECORD_VARIABLE);
+        record_size(out, "seq", mm->executed_ops);
+        record_string(out, "name", symbol_name(mm, mm->variables[i].name_id));
+        record_string(out, "region", "");
+        record_size(out, "offset", (size_t)((char*)mm->variables[i].address - (char*)mm->memory_pool));
+        record_size(out, "size", mm->variables[i].size);
+        record_end(out);
+    }
+    for (int r = 0; r < mm->region_depth; r++) {
+        Region* region = &mm->regions[r];
+        for (int i = 0; i < region->variable_count; i++) {
+            if (region->variables[i].name_id != NAME_ID_NONE) {
+                record_begin(out, RECORD_VARIABLE);
+                record_size(out, "seq", mm->executed_ops);
+                record_string(out, "name", symbol_name(mm, region->variables[i].name_id));
+                record_string(out, "region", symbol_name(mm, region->name_id));
+                record_size(out, "offset", (size_t)((char*)region->variables[i].address - (char*)mm->memory_pool));
+                record_size(out, "size", region->variables[i].size);
+                record_end(out);
+            }
+        }
+    }
+    const BlockTable* table = &mm->blocks;
+    for (int i = 0; i < table->count; i++) {
+        record_begin(out, RECORD_BLOCK);
+        record_size(out, "seq", mm->executed_ops);
+        record_size(out, "index", (size_t)i + 1);
+        record_string(out, "owner", table->is_free[i] ? "" : symbol_name(mm, table->name_ids[i]));
+        record_size(out, "offset", table->offsets[i]);
+        record_size(out, "size", table->sizes[i]);
+        record_bool(out, "free", table->is_free[i]);
+        record_end(out);
+    }
+    emit_stats_record(mm, "print");
+}
+
+/**
+ * Imprime las métricas de fragmentación en una línea (salida periódica).
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void print_fragmentation_line(MemoryManager* mm) {
+    if (mm->output) {
+        emit_stats_record(mm, "interval");
+        return;
+    }
+    printf("FRAG[op %zu]: externa %.3f (mayor libre %zu de %zu bytes), interna %zu bytes, "
+           "marca de agua %zu bytes (utilización %.1f%%), residente %zu bytes, libres por tamaño:",
+           mm->executed_ops, external_fragmentation(mm), largest_free_block(mm), mm->free_bytes,
+           internal_fragmentation(mm), mm->high_water, high_water_utilization(mm), pool_resident_estimate(mm));
+    for (int k = 0; k < FREE_HISTOGRAM_BUCKETS; k++) {
+        if (mm->free_histogram[k] > 0) {
+            printf(" 2^%d:%d", k, mm->free_histogram[k]);
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * Recorre el pool por adyacencia física siguiendo las etiquetas (--headers).
+ * 
+ * Parte del inicio del pool y avanza de cabecera en cabecera sumando el
+ * tamaño de cada bloque, sin usar la tabla para moverse. En cada paso
+ * verifica que la cabecera coincida con la entrada de la tabla y, si el
+ * bloque anterior está libre, que su pie lleve de vuelta a su cabecera.
+ * 
+ * @param mm Puntero al gestor de memoria (con etiquetas y pool no fantasma)
+ * @param walked Salida: bloques recorridos
+ * @return true si las etiquetas coinciden con la tabla de bloques
+ */
+bool check_block_tags(MemoryManager* mm, int* walked) {
+    const BlockTable* table = &mm->blocks;
+    const char* pool = (const char*)mm->memory_pool;
+    size_t offset = 0;
+    int i = 0;
+    *walked = 0;
+    while (offset < mm->pool_size) {
+        uint64_t header;
+        memcpy(&header, pool + offset, sizeof(header));
+        size_t size = (size_t)(header >> 1);
+        bool is_free = (header & BLOCK_TAG_USED) == 0;
+        if (i >= table->count || table->offsets[i] != offset || table->sizes[i] != size ||
+            table->is_free[i] != is_free) {
+            fprintf(stderr, "Error: La cabecera en el desplazamiento %zu no coincide con la tabla de bloques\n", offset);
+            return false;
+        }
+        if (is_free) {
+            uint64_t footer;
+            size_t end = offset + size;
+            memcpy(&footer, pool + end - BLOCK_FOOTER_SIZE, sizeof(footer));
+            if (footer > end || end - footer != offset) {
+                fprintf(stderr, "Error: El pie del bloque libre en %zu no lleva a su cabecera\n", offset);
+                return false;
+            }
+        }
+        offset += size;
+        i++;
+        (*walked)++;
+    }
+    return i == table->count;
+}
+
+/**
+ * Imprime el estado completo del gestor de memoria.
+ * 
+ * Muestra información detallada sobre todas las variables activas, todos los
+ * bloques (libres y ocupados) con sus direcciones y tamaños, y estadísticas
+ * generales como memoria total, libre, usada y nivel de fragmentación.
+ * Útil para depuración y monitoreo del estado del sistema.
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void print_memory_state(MemoryManager* mm) {
+    // En modo diferido, mostrar la memoria ya fusionada
+    flush_pending_merges(mm);
+    if (mm->output) {
+        emit_memory_state_records(mm);
+        return;
+    }
+
+    printf("\n=== Estado de la Memoria ===\n");
+    printf("Variables activas: %d\n", mm->variable_count);
+    printf("\nVariables asignadas:\n");
+    for (int i = 0; i < mm->variable_slots; i++) {
+        if (mm->variables[i].name_id == NAME_ID_NONE) {
+            continue;
+        }
+        printf("  - %s: %zu bytes en dirección %p\n", 
+               symbol_name(mm, mm->variables[i].name_id), 
+               mm->variables[i].size, 
+               mm->variables[i].address);
+    }
+    for (int r = 0; r < mm->region_depth; r++) {
+        Region* region = &mm->regions[r];
+        printf("\nRegión '%s' (%zu de %zu bytes usados):\n",
+               symbol_name(mm, region->name_id), region->used, region->reserved);
+        for (int i = 0; i < region->variable_count; i++) {
+            if (region->variables[i].name_id != NAME_ID_NONE) {
+                printf("  - %s: %zu bytes en dirección %p\n",
+                       symbol_name(mm, region->variables[i].name_id),
+                       region->variables[i].size,
+                       region->variables[i].address);
+            }
+        }
+    }
+    
+    printf("\nBloques de memoria:\n");
+    const BlockTable* table = &mm->blocks;
+    for (int i = 0; i < table->count; i++) {
+        printf("  Bloque %d: %s [%zu bytes] en %p - %s\n",
+               i + 1,
+               table->is_free[i] ? "LIBRE" : symbol_name(mm, table->name_ids[i]),
+               table->sizes[i],
+               block_address(mm, i),
+               table->is_free[i] ? "(libre)" : "(ocupado)");
+    }
+    if (mm->header_size > 0 && !mm->phantom) {
+        int walked;
+        bool consistent = check_block_tags(mm, &walked);
+        printf("\nRecorrido por etiquetas: %s (%d bloques)\n",
+               consistent ? "coincide con la tabla" : "INCONSISTENTE", walked);
+    }
+    if (mm->large.count > 0) {
+        printf("\nAsignaciones grandes (mmap directo):\n");
+        for (int i = 0; i < mm->large.count; i++) {
+            printf("  %s [%zu bytes mapeados] en %p\n", symbol_name(mm, mm->large.entries[i].name_id),
+                   mm->large.entries[i].length, mm->large.entries[i].address);
+        }
+    }
+    
+    // Estadísticas mantenidas de forma incremental
+    printf("\nEstadísticas:\n");
+    printf("  Memoria total: %zu bytes\n", mm->pool_size);
+    printf("  Memoria libre: %zu bytes (%d bloques)\n", mm->free_bytes, mm->free_block_count);
+    printf("  Memoria usada: %zu bytes (%d bloques)\n",
+           mm->pool_size - mm->free_bytes, table->count - mm->free_block_count);
+    printf("  Fragmentación: %d bloques libres\n", mm->free_block_count);
+    print_fragmentation_metrics(mm);
+    printf("===========================\n\n");
+}
+
+/**
+ * Imprime en una línea las estadísticas del heap, sin recorrer la tabla.
+ * 
+ * Usa los contadores que mantienen las operaciones sobre bloques, así que su
+ * costo no depende del número de bloques. A diferencia de PRINT no fusiona
+ * las liberaciones pendientes del modo diferido: las reporta aparte.
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void print_heap_stats(MemoryManager* mm) {
+    if (mm->output) {
+        emit_stats_record(mm, "stats");
+        return;
+    }
+    printf("STATS: libre %zu bytes (%d bloques), usada %zu bytes (%d bloques), mayor bloque libre %zu bytes, "
+           "residente %zu bytes",
+           mm->free_bytes, mm->free_block_count,
+           mm->pool_size - mm->free_bytes, mm->blocks.count - mm->free_block_count,
+           largest_free_block(mm), pool_resident_estimate(mm));
+    if (mm->pending_frees > 0) {
+        printf(", %d liberaciones sin fusionar", mm->pending_frees);
+    }
+    if (mm->aligned_requests > 0) {
+        printf(", relleno de alineación sin usar %zu bytes", mm->padding_live);
+    }
+    printf("\n");
+}
+
+/**
+ * Emite un registro "leak" por cada variable activa y cada región sin cerrar.
+ * 
+ * @param mm Puntero al gestor de memoria (con salida estructurada)
+ */
+void emit_leak_records(MemoryManager* mm) {
+    OutputBuffer* out = mm->output;
+    for (int i = 0; i < mm->variable_slots; i++) {
+        if (mm->variables[i].name_id == NAME_ID_NONE) {
+            continue;
+        }
+        record_begin(out, RECORD_LEAK);
+        record_string(out, "kind", "variable");
+        record_string(out, "name", symbol_name(mm, mm->variables[i].name_id));
+        record_size(out, "offset", (size_t)((char*)mm->variables[i].address - (char*)mm->memory_pool));
+        record_size(out, "bytes", mm->variables[i].size);
+        record_size(out, "variables", 1);
+        record_end(out);
+    }
+    for (int r = 0; r < mm->region_depth; r++) {
+        Region* region = &mm->regions[r];
+        record_begin(out, RECORD_LEAK);
+        record_string(out, "kind", "region");
+        record_string(out, "name", symbol_name(mm, region->name_id));
+        record_size(out, "offset", region->chunk_count > 0 ?
+                    (size_t)((char*)region->chunks[0] - (char*)mm->memory_pool) : 0);
+        record_size(out, "bytes", region->reserved);
+        record_size(out, "variables", (size_t)(region->variable_count - region->freed));
+        record_end(out);
+    }
+}
+
+/**
+ * Reporta variables que aún están activas al finalizar el programa.
+ * 
+ * Recorre la tabla de variables y muestra todas las que aún están asignadas.
+ * Si no hay variables activas, indica que no se detectaron fugas. Esta función
+ * ayuda a identificar variables que no fueron liberadas antes de terminar.
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void report_leaks(MemoryManager* mm) {
+        if (mm->output) {
+            emit_leak_records(mm);
+            return;
+        }
+        int leaks = 0;
+        for (int i = 0; i < mm->variable_slots; i++) {
+            if (mm->variables[i].name_id == NAME_ID_NONE) {
+                continue;
+            }
+            printf("[LEAK] %s: %zu bytes en %p\n",
+                   symbol_name(mm, mm->variables[i].name_id),
+                   mm->variables[i].size,
+                   mm->variables[i].address);
+            leaks++;
+        }
+        for (int r = 0; r < mm->region_depth; r++) {
+            Region* region = &mm->regions[r];
+            printf("[LEAK] Región '%s' sin cerrar: %d variables, %zu bytes reservados\n",
+                   symbol_name(mm, region->name_id), region->variable_count - region->freed, region->reserved);
+            leaks++;
+        }
+        if (leaks == 0) {
+            printf("No se detectaron fugas de memoria.\n");
+        }
+    }
+    
+
+/**
+ * Indica si un carácter separa tokens dentro de una línea de traza.
+ * 
+ * @param c Carácter a evaluar
+ * @return true para espacios, tabulaciones y fines de línea
+ */
+bool is_token_separator(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+/**
+ * Avanza sobre los separadores desde p sin pasar de end.
+ * 
+ * @param p Posición actual
+ * @param end Fin de la línea (exclusivo)
+ * @return Primera posición que no es separador (o end)
+ */
+const char* skip_separators(const char* p, const char* end) {
+    while (p < end && is_token_separator(*p)) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Copia el token que comienza en *p a out y avanza *p hasta su final.
+ * 
+ * @param p Posición actual (se actualiza)
+ * @param end Fin de la línea (exclusivo)
+ * @param out Destino del token (terminado en '\0')
+ * @param max Tamaño de out en bytes
+ * @return true si había un token y cabe en out, false en caso contrario
+ */
+bool read_name_token(const char** p, const char* end, char* out, size_t max) {
+    const char* start = skip_separators(*p, end);
+    const char* stop = start;
+    while (stop < end && !is_token_separator(*stop)) {
+        stop++;
+    }
+    size_t len = (size_t)(stop - start);
+    if (len == 0 || len >= max) {
+        return false;
+    }
+    memcpy(out, start, len);
+    out[len] = '\0';
+    *p = stop;
+    return true;
+}
+
+/**
+ * Lee un nombre desde *p y lo interna en la tabla de nombres.
+ * 
+ * @param p Posición actual (se actualiza)
+ * @param end Fin de la línea (exclusivo)
+ * @param names Tabla donde se internan los nombres
+ * @param id ID del nombre leído
+ * @return true si había un nombre válido y se pudo internar
+ */
+bool read_name_id(const char** p, const char* end, NameTable* names, uint32_t* id) {
+    char name[MAX_NAME_LENGTH];
+    if (!read_name_token(p, end, name, sizeof(name))) {
+        return false;
+    }
+    *id = name_table_intern(names, name);
+    return *id != NAME_ID_NONE;
+}
+
+/**
+ * Lee un tamaño decimal sin signo desde *p y avanza *p hasta su final.
+ * 
+ * @param p Posición actual (se actualiza)
+ * @param end Fin de la línea (exclusivo)
+ * @param out Valor leído
+ * @return true si había al menos un dígito y el valor cabe en size_t
+ */
+bool read_size_token(const char** p, const char* end, size_t* out) {
+    const char* q = skip_separators(*p, end);
+    if (q == end || *q < '0' || *q > '9') {
+        return false;
+    }
+    size_t value = 0;
+    while (q < end && *q >= '0' && *q <= '9') {
+        size_t digit = (size_t)(*q - '0');
+        if (value > (SIZE_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+        q++;
+    }
+    *out = value;
+    *p = q;
+    return true;
+}
+
+/**
+ * Lee la alineación opcional de ALLOC/REALLOC y la guarda como log2.
+ * 
+ * @param p Posición actual (se actualiza)
+ * @param end Fin de la línea (exclusivo)
+ * @param shift Salida: log2 de la alineación (0 si no hay o es 0 o 1)
+ * @return true si no hay alineación o es una potencia de 2 hasta 2^MAX_ALIGNMENT_SHIFT
+ */
+bool read_alignment_token(const char** p, const char* end, uint16_t* shift) {
+    size_t align = 0;
+    *shift = 0;
+    if (!read_size_token(p, end, &align) || align <= 1) {
+        return true;
+    }
+    if ((align & (align - 1)) != 0 || align > ((size_t)1 << MAX_ALIGNMENT_SHIFT)) {
+        return false;
+    }
+    while (((size_t)1 << *shift) < align) {
+        (*shift)++;
+    }
+    return true;
+}
+
+/**
+ * Comprueba si la línea comienza con la palabra clave indicada como token completo.
+ * 
+ * @param p Inicio del comando
+ * @param end Fin de la línea (exclusivo)
+ * @param keyword Palabra clave a comparar
+ * @param len Longitud de la palabra clave
+ * @return true si el token es exactamente la palabra clave
+ */
+bool match_keyword(const char* p, const char* end, const char* keyword, size_t len) {
+    return (size_t)(end - p) >= len && memcmp(p, keyword, len) == 0 &&
+           (p + len == end || is_token_separator(p[len]));
+}
+
+/**
+ * Interpreta una línea de traza delimitada por [line, end) sin copiarla.
+ * 
+ * El tokenizador decide el comando por su primer byte y solo compara la
+ * palabra clave completa del candidato; nombres y tamaños se leen en una
+ * sola pasada sin sscanf. La línea no necesita terminar en '\0', así que se
+ * puede usar directamente sobre un archivo mapeado en memoria. Los nombres se
+ * internan aquí: la operación resultante solo lleva su ID. Las líneas vacías
+ * y los comentarios (que comienzan con #) producen OP_NONE.
+ * 
+ * @param line Inicio de la línea
+ * @param end Fin de la línea (exclusivo, sin incluir el '\n')
+ * @param names Tabla donde se internan los nombres de variables y regiones
+ * @param op Operación donde se guardan el comando y sus parámetros
+ * @return true si la línea es válida, false si hubo un error de formato
+ */
+bool parse_span(const char* line, const char* end, NameTable* names, TraceOp* op) {
+    op->opcode = OP_NONE;
+    op->align_shift = 0;
+    op->name_id = NAME_ID_NONE;
+    op->size = 0;
+
+    const char* p = skip_separators(line, end);
+
+    // Ignorar líneas vacías y comentarios (incluye comentarios con espacios iniciales)
+    if (p == end || *p == '#') {
+        return true;
+    }
+
+    switch (*p) {
+        case 'A':
+            if (match_keyword(p, end, "ALLOC", 5)) {
+                p += 5;
+                // ALLOC <nombre> <tamaño> [alineación]
+                if (read_name_id(&p, end, names, &op->name_id) && read_size_token(&p, end, &op->size)) {
+                    if (!read_alignment_token(&p, end, &op->align_shift)) {
+                        fprintf(stderr, "Error: La alineación de ALLOC debe ser potencia de 2 (hasta 2^%d)\n",
+                                MAX_ALIGNMENT_SHIFT);
+                        return false;
+                    }
+                    op->opcode = OP_ALLOC;
+                    return true;
+                }
+                fprintf(stderr, "Error: Formato incorrecto para ALLOC\n");
+                return false;
+            }
+            break;
+        case 'R':
+            if (match_keyword(p, end, "REALLOC", 7)) {
+                p += 7;
+                // REALLOC <nombre> <tamaño> [alineación]
+                if (read_name_id(&p, end, names, &op->name_id) && read_size_token(&p, end, &op->size)) {
+                    if (!read_alignment_token(&p, end, &op->align_shift)) {
+                        fprintf(stderr, "Error: La alineación de REALLOC debe ser potencia de 2 (hasta 2^%d)\n",
+                                MAX_ALIGNMENT_SHIFT);
+                        return false;
+                    }
+                    op->opcode = OP_REALLOC;
+                    return true;
+                }
+                fprintf(stderr, "Error: Formato incorrecto para REALLOC\n");
+                return false;
+            }
+            break;
+        case 'F':
+            if (match_keyword(p, end, "FREE", 4)) {
+                p += 4;
+                if (read_name_id(&p, end, names, &op->name_id)) {
+                    op->opcode = OP_FREE;
+                    return true;
+                }
+                fprintf(stderr, "Error: Formato incorrecto para FREE\n");
+                return false;
+            }
+            break;
+        case 'P':
+            if (match_keyword(p, end, "PRINT", 5)) {
+                op->opcode = OP_PRINT;
+                return true;
+            }
+            break;
+        case 'L':
+            if (match_keyword(p, end, "LATENCY", 7)) {
+                op->opcode = OP_LATENCY;
+                return true;
+            }
+            break;
+        case 'S':
+            if (match_keyword(p, end, "STATS", 5)) {
+                op->opcode = OP_STATS;
+                return true;
+            }
+            break;
+        case 'B':
+            // BEGIN_REGION <nombre> [tamaño del bloque]
+            if (match_keyword(p, end, "BEGIN_REGION", 12)) {
+                p += 12;
+                if (read_name_id(&p, end, names, &op->name_id)) {
+                    read_size_token(&p, end, &op->size);
+                    op->opcode = OP_BEGIN_REGION;
+                    return true;
+                }
+                fprintf(stderr, "Error: Formato incorrecto para BEGIN_REGION\n");
+                return false;
+            }
+            break;
+        case 'E':
+            // END_REGION [nombre]: cierra la región más interna
+            if (match_keyword(p, end, "END_REGION", 10)) {
+                p += 10;
+                if (!read_name_id(&p, end, names, &op->name_id)) {
+                    op->name_id = NAME_ID_NONE;
+                }
+                op->opcode = OP_END_REGION;
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+
+    char command[20];
+    size_t len = 0;
+    while (p + len < end && !is_token_separator(p[len]) && len < sizeof(command) - 1) {
+        command[len] = p[len];
+        len++;
+    }
+    command[len] = '\0';
+    fprintf(stderr, "Error: Comando desconocido '%s'\n", command);
+    return false;
+}
+
+/**
+ * Índice de la clase del histograma de latencias que contiene un valor.
+ * 
+ * @param value Latencia en nanosegundos
+ * @return Índice en LatencyHistogram.counts
+ */
+int latency_bucket(uint64_t value) {
+    if (value < LATENCY_SUB_COUNT) {
+        return (int)value;
+    }
+    int magnitude = 63 - __builtin_clzll(value);            // value está en [2^magnitude, 2^(magnitude+1))
+    int shift = magnitude - LATENCY_SUB_BITS;
+    int sub = (int)(value >> shift) - LATENCY_SUB_COUNT;     // 0..LATENCY_SUB_COUNT-1
+    return LATENCY_SUB_COUNT * (shift + 1) + sub;
+}
+
+/**
+ * Mayor valor que cae en una clase del histograma de latencias.
+ * 
+ * @param bucket Índice de la clase
+ * @return Límite superior (inclusivo) de la clase en nanosegundos
+ */
+uint64_t latency_bucket_limit(int bucket) {
+    if (bucket < LATENCY_SUB_COUNT) {
+        return (uint64_t)bucket;
+    }
+    int shift = bucket / LATENCY_SUB_COUNT - 1;
+    uint64_t sub = (uint64_t)(bucket % LATENCY_SUB_COUNT + LATENCY_SUB_COUNT);
+    return ((sub + 1) << shift) - 1;
+}
+
+/**
+ * Registra una muestra en un histograma de latencias.
+ * 
+ * @param histogram Histograma destino
+ * @param value Latencia en nanosegundos
+ */
+void latency_record(LatencyHistogram* histogram, uint64_t value) {
+    histogram->counts[latency_bucket(value)]++;
+    histogram->total++;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+/**
+ * Calcula un percentil de un histograma de latencias.
+ * 
+ * @param histogram Histograma con al menos una muestra
+ * @param percentile Percentil entre 0 y 100
+ * @return Límite superior de la clase que contiene el percentil (acotado por el máximo)
+ */
+uint64_t latency_percentile(const LatencyHistogram* histogram, double percentile) {
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += histogram->counts[b];
+        if (seen >= rank) {
+            uint64_t limit = latency_bucket_limit(b);
+            return limit < histogram->max ? limit : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+/**
+ * Percentil de la latencia de todas las operaciones que modifican el heap.
+ * 
+ * Combina los histogramas de cada código de operación reportado, así que
+ * el resultado tiene la misma precisión que los percentiles por operación.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param percentile Percentil entre 0 y 100
+ * @return Latencia en nanosegundos (0 si no hay muestras)
+ */
+uint64_t latency_percentile_combined(MemoryManager* mm, double percentile) {
+    if (!mm->latency) {
+        return 0;
+    }
+    LatencyHistogram* combined = (LatencyHistogram*)calloc(1, sizeof(LatencyHistogram));
+    if (!combined) {
+        return 0;
+    }
+    for (int opcode = 0; opcode < OP_COUNT; opcode++) {
+        const LatencyHistogram* histogram = &mm->latency[opcode];
+        if (!latency_reported_ops[opcode]) {
+            continue;
+        }
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            combined->counts[b] += histogram->counts[b];
+        }
+        combined->total += histogram->total;
+        if (histogram->max > combined->max) {
+            combined->max = histogram->max;
+        }
+    }
+    uint64_t result = combined->total > 0 ? latency_percentile(combined, percentile) : 0;
+    free(combined);
+    return result;
+}
+
+/**
+ * Imprime p50/p90/p99/p99.9/máx de cada código de operación con muestras.
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void print_latency_report(MemoryManager* mm) {
+    const bool* reported = latency_reported_ops;
+    if (mm->output) {
+        for (int opcode = 0; mm->latency && opcode < OP_COUNT; opcode++) {
+            const LatencyHistogram* histogram = &mm->latency[opcode];
+            if (!reported[opcode] || histogram->total == 0) {
+                continue;
+            }
+            record_begin(mm->output, RECORD_LATENCY);
+            record_size(mm->output, "seq", mm->executed_ops);
+            record_string(mm->output, "op", opcode_names[opcode]);
+            record_size(mm->output, "count", (size_t)histogram->total);
+            record_size(mm->output, "p50_ns", (size_t)latency_percentile(histogram, 50.0));
+            record_size(mm->output, "p90_ns", (size_t)latency_percentile(histogram, 90.0));
+            record_size(mm->output, "p99_ns", (size_t)latency_percentile(histogram, 99.0));
+            record_size(mm->output, "p999_ns", (size_t)latency_percentile(histogram, 99.9));
+            record_size(mm->output, "max_ns", (size_t)histogram->max);
+            record_end(mm->output);
+        }
+        return;
+    }
+    printf("\n=== Latencia por operación (ns) ===\n");
+    printf("  %-13s %10s %9s %9s %9s %9s %9s\n", "Operación", "Cuenta", "p50", "p90", "p99", "p99.9", "máx");
+    for (int opcode = 0; mm->latency && opcode < OP_COUNT; opcode++) {
+        const LatencyHistogram* histogram = &mm->latency[opcode];
+        if (!reported[opcode] || histogram->total == 0) {
+            continue;
+        }
+        printf("  %-12s %10llu %9llu %9llu %9llu %9llu %9llu\n", opcode_names[opcode],
+               (unsigned long long)histogram->total,
+               (unsigned long long)latency_percentile(histogram, 50.0),
+               (unsigned long long)latency_percentile(histogram, 90.0),
+               (unsigned long long)latency_percentile(histogram, 99.0),
+               (unsigned long long)latency_percentile(histogram, 99.9),
+               (unsigned long long)histogram->max);
+    }
+    printf("===========================\n");
+}
+
+/**
+ * Imprime cuántas operaciones de cada tipo se ejecutaron y cuántas fallaron.
+ * 
+ * Es la salida de --quiet, que omite el mensaje individual de cada operación.
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void print_op_counters(MemoryManager* mm) {
+    printf("\n=== Operaciones ejecutadas ===\n");
+    for (int opcode = OP_ALLOC; opcode < OP_COUNT; opcode++) {
+        if (mm->op_counts[opcode] > 0) {
+            printf("  %-12s %10zu (%zu fallidas)\n", opcode_names[opcode],
+                   mm->op_counts[opcode], mm->op_failures[opcode]);
+        }
+    }
+    printf("  Total: %zu\n", mm->executed_ops);
+    printf("==============================\n");
+}
+
+/**
+ * Ejecuta una operación de traza sobre el gestor de memoria.
+ * 
+ * Los IDs de la operación deben venir de la tabla de símbolos del gestor.
+ * Después de cada operación que modifica el heap actualiza el pico de
+ * fragmentación externa (fuera del tiempo medido). Con metrics_interval > 0
+ * imprime las métricas de fragmentación cada metrics_interval operaciones.
+ * La duración de cada operación que modifica el heap se registra en el
+ * histograma de su código (ver LATENCY), sin el tiempo de imprimir su
+ * mensaje o su error.
+ * 
+ * @param mm Puntero al gestor de memoria
+ * @param op Operación ya interpretada por parse_span
+ * @return true si la operación fue exitosa, false en caso de error
+ */
+bool execute_op(MemoryManager* mm, const TraceOp* op) {
+    if (op->opcode == OP_NONE) {
+        return true;
+    }
+    mm->executed_ops++;
+    if (!mm->latency) {
+        mm->latency = (LatencyHistogram*)calloc(OP_COUNT, sizeof(LatencyHistogram));
+    }
+    mm->message_nanos = 0;
+    uint64_t start = monotonic_nanos();
+    bool ok;
+    switch (op->opcode) {
+        case OP_ALLOC: ok = alloc_variable(mm, op->name_id, op->size, (size_t)1 << op->align_shift); break;
+        case OP_REALLOC: ok = realloc_variable(mm, op->name_id, op->size, (size_t)1 << op->align_shift); break;
+        case OP_FREE: ok = free_variable(mm, op->name_id); break;
+        case OP_PRINT: print_memory_state(mm); ok = true; break;
+        case OP_STATS: print_heap_stats(mm); ok = true; break;
+        case OP_LATENCY: print_latency_report(mm); ok = true; break;
+        case OP_BEGIN_REGION: ok = begin_region(mm, op->name_id, op->size); break;
+        case OP_END_REGION: ok = end_region(mm, op->name_id); break;
+        default: ok = true; break;
+    }
+    uint64_t elapsed = monotonic_nanos() - start - mm->message_nanos;
+    mm->op_counts[op->opcode]++;
+    if (!ok) {
+        mm->op_failures[op->opcode]++;
+    }
+    if (mm->latency) {
+        latency_record(&mm->latency[op->opcode], elapsed);
+    }
+    if (latency_reported_ops[op->opcode]) {
+        double fragmentation = external_fragmentation(mm);
+        if (fragmentation > mm->peak_external_fragmentation) {
+            mm->peak_external_fragmentation = fragmentation;
+        }
+    }
+    if (mm->output && !mm->quiet) {
+        record_begin(mm->output, RECORD_OP);
+        record_size(mm->output, "seq", mm->executed_ops);
+        record_string(mm->output, "op", opcode_names[op->opcode]);
+        record_string(mm->output, "name", symbol_name(mm, op->name_id));
+        record_size(mm->output, "size", op->size);
+        record_bool(mm->output, "ok", ok);
+        record_size(mm->output, "ns", (size_t)elapsed);
+        record_end(mm->output);
+    }
+    // Métricas periódicas para comparar políticas a lo largo de la traza
+    if (mm->metrics_interval > 0 && mm->executed_ops % (size_t)mm->metrics_interval == 0) {
+        print_fragmentation_line(mm);
+    }
+    return ok;
+}
+
+/**
+ * Lector de trazas de texto sobre el archivo completo en memoria.
+ * 
+ * El archivo se mapea con mmap (o, si no se puede mapear, se lee de una vez)
+ * y las líneas se entregan como rangos [inicio, fin) dentro del mapeo, sin
+ * copiarlas a un buffer intermedio ni limitar su longitud.
+ */
+typedef struct TraceReader {
+    const char* data;              // Contenido del archivo
+    size_t size;                   // Tamaño del archivo en bytes
+    size_t pos;                    // Desplazamiento de la siguiente línea
+    bool mapped;                   // true si 'data' es un mapeo (munmap) y no un malloc (free)
+    size_t lines;                  // Líneas entregadas hasta ahora
+} TraceReader;
+
+/**
+ * Abre un archivo de traza para leerlo línea por línea sin copias.
+ * 
+ * @param reader Lector a inicializar
+ * @param path Ruta del archivo
+ * @return true si el archivo se pudo abrir, false en caso contrario
+ */
+bool trace_reader_open(TraceReader* reader, const char* path) {
+    reader->data = NULL;
+    reader->size = 0;
+    reader->pos = 0;
+    reader->mapped = false;
+    reader->lines = 0;
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: No se pudo abrir el archivo '%s'\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+            reader->data = (const char*)data;
+            reader->size = (size_t)st.st_size;
+            reader->mapped = true;
+            close(fd);
+            return true;
+        }
+    }
+
+    // Archivos que no se pueden mapear (tuberías, /dev/stdin): leer completo
+    size_t capacity = 0;
+    char* buffer = NULL;
+    for (;;) {
+        if (reader->size == capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            char* grown = (char*)realloc(buffer, capacity);
+            if (!grown) {
+                fprintf(stderr, "Error: No hay memoria para leer '%s'\n", path);
+                free(buffer);
+                close(fd);
+                return false;
+            }
+            buffer = grown;
+        }
+        ssize_t n = read(fd, buffer + reader->size, capacity - reader->size);
+        if (n <= 0) {
+            break;
+        }
+        reader->size += (size_t)n;
+    }
+    close(fd);
+    reader->data = buffer;
+    return true;
+}
+
+/**
+ * Entrega la siguiente línea del archivo como rango dentro del mapeo.
+ * 
+ * @param reader Lector abierto con trace_reader_open
+ * @param line Inicio de la línea
+ * @param end Fin de la línea (exclusivo, sin el '\n')
+ * @return true si había una línea, false al llegar al final del archivo
+ */
+bool trace_reader_next(TraceReader* reader, const char** line, const char** end) {
+    if (reader->pos >= reader->size) {
+        return false;
+    }
+    const char* start = reader->data + reader->pos;
+    const char* limit = reader->data + reader->size;
+    const char* newline = (const char*)memchr(start, '\n', (size_t)(limit - start));
+    *line = start;
+    *end = newline ? newline : limit;
+    reader->pos = (size_t)(*end - reader->data) + (newline ? 1 : 0);
+    reader->lines++;
+    return true;
+}
+
+/**
+ * Cierra el lector y libera el mapeo o el buffer del archivo.
+ * 
+ * @param reader Lector a cerrar
+ */
+void trace_reader_close(TraceReader* reader) {
+    if (reader->mapped) {
+        munmap((void*)reader->data, reader->size);
+    } else {
+        free((void*)reader->data);
+    }
+    reader->data = NULL;
+    reader->size = 0;
+}
+
+/**
+ * Cabecera de una traza binaria.
+ * 
+ * Formato del archivo (enteros en el orden de bytes de la máquina):
+ *   - Cabecera (24 bytes)
+ *   - Tabla de nombres: name_count entradas de MAX_NAME_LENGTH bytes terminadas
+ *     en '\0', rellenada con ceros hasta un múltiplo de 8 bytes
+ *   - record_count registros BinaryTraceRecord de 16 bytes
+ */
+typedef struct BinaryTraceHeader {
+    char magic[8];                 // BINARY_TRACE_MAGIC
+    uint32_t version;              // BINARY_TRACE_VERSION
+    uint32_t name_count;           // Entradas de la tabla de nombres
+    uint64_t record_count;         // Registros de operaciones
+} BinaryTraceHeader;
+
+/**
+ * Registro de una operación en una traza binaria.
+ */
+typedef struct BinaryTraceRecord {
+    uint16_t opcode;               // OP_ALLOC, OP_REALLOC, OP_FREE, OP_PRINT, OP_STATS, OP_LATENCY u OP_*_REGION
+    uint16_t align_shift;          // log2 de la alineación (en la versión 1 era la mitad alta del código, siempre 0)
+    uint32_t name_id;              // Índice en la tabla de nombres (NAME_ID_NONE si no aplica)
+    uint64_t size;                 // Tamaño solicitado (0 si no aplica)
+} BinaryTraceRecord;
+
+/**
+ * Traza binaria abierta sobre el archivo mapeado.
+ * 
+ * Los nombres y registros apuntan directamente al mapeo: abrir una traza no
+ * copia ni interpreta texto.
+ */
+typedef struct BinaryTrace {
+    TraceReader file;                        // Archivo mapeado
+    const BinaryTraceHeader* header;         // Cabecera validada
+    const char (*names)[MAX_NAME_LENGTH];    // Tabla de nombres
+    const BinaryTraceRecord* records;        // Registros de operaciones
+} BinaryTrace;
+
+/**
+ * Indica si un archivo abierto comienza con la firma de traza binaria.
+ * 
+ * @param reader Archivo abierto con trace_reader_open
+ * @return true si es una traza binaria
+ */
+bool is_binary_trace(const TraceReader* reader) {
+    return reader->size >= sizeof(BinaryTraceHeader) &&
+           memcmp(reader->data, BINARY_TRACE_MAGIC, 8) == 0;
+}
+
+/**
+ * Valida una traza binaria sobre un archivo ya abierto y toma su propiedad.
+ * 
+ * @param trace Traza a inicializar
+ * @param reader Archivo abierto (pasa a ser propiedad de la traza)
+ * @param path Ruta del archivo (para los mensajes de error)
+ * @return true si el formato es válido, false en caso contrario (el archivo se cierra)
+ */
+bool binary_trace_attach(BinaryTrace* trace, TraceReader* reader, const char* path) {
+    trace->file = *reader;
+    const BinaryTraceHeader* header = (const BinaryTraceHeader*)reader->data;
+    size_t names_bytes = ((size_t)header->name_count * MAX_NAME_LENGTH + 7) & ~(size_t)7;
+    size_t records_offset = sizeof(BinaryTraceHeader) + names_bytes;
+
+    bool valid = (header->version == 1 || header->version == BINARY_TRACE_VERSION) &&
+                 records_offset <= reader->size &&
+                 header->record_count <= (reader->size - records_offset) / sizeof(BinaryTraceRecord);
+    for (uint32_t i = 0; valid && i < header->name_count; i++) {
+        valid = reader->data[sizeof(BinaryTraceHeader) + (size_t)i * MAX_NAME_LENGTH + MAX_NAME_LENGTH - 1] == '\0';
+    }
+    if (!valid) {
+        fprintf(stderr, "Error: Traza binaria inválida o de otra versión '%s'\n", path);
+        trace_reader_close(&trace->file);
+        return false;
+    }
+
+    trace->header = header;
+    trace->names = (const char (*)[MAX_NAME_LENGTH])(reader->data + sizeof(BinaryTraceHeader));
+    trace->records = (const BinaryTraceRecord*)(reader->data + records_offset);
+    return true;
+}
+
+/**
+ * Interna la tabla de nombres de una traza binaria en una tabla de símbolos.
+ * 
+ * Se hace una sola vez al abrir la traza; después cada registro se traduce
+ * a la tabla destino con un acceso a arreglo.
+ * 
+ * @param trace Traza binaria abierta
+ * @param names Tabla de símbolos destino (la del gestor o la de una Trace)
+ * @return Arreglo ID del archivo -> ID en 'names' (liberar con free), o NULL si no hay memoria
+ */
+uint32_t* binary_trace_intern_names(const BinaryTrace* trace, NameTable* names) {
+    uint32_t count = trace->header->name_count;
+    uint32_t* ids = (uint32_t*)malloc((count ? count : 1) * sizeof(uint32_t));
+    if (!ids) {
+        fprintf(stderr, "Error: No hay memoria para la tabla de nombres\n");
+        return NULL;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        ids[i] = name_table_intern(names, trace->names[i]);
+        if (ids[i] == NAME_ID_NONE) {
+            fprintf(stderr, "Error: No hay memoria para la tabla de nombres\n");
+            free(ids);
+            return NULL;
+        }
+    }
+    return ids;
+}
+
+/**
+ * Traduce un registro binario a una operación con IDs de la tabla destino.
+ * 
+ * @param trace Traza binaria abierta
+ * @param ids Arreglo devuelto por binary_trace_intern_names
+ * @param record Registro a traducir
+ * @param op Operación resultante
+ * @return true si el registro es válido, false si su código o su ID están fuera de rango
+ */
+bool binary_record_to_op(const BinaryTrace* trace, const uint32_t* ids, const BinaryTraceRecord* record, TraceOp* op) {
+    if (record->opcode < OP_ALLOC || record->opcode > OP_LATENCY) {
+        fprintf(stderr, "Error: Código de operación desconocido (%u)\n", (unsigned)record->opcode);
+        return false;
+    }
+    bool needs_name = record->opcode != OP_PRINT && record->opcode != OP_STATS &&
+                      record->opcode != OP_LATENCY && record->opcode != OP_END_REGION;
+    if (record->name_id == NAME_ID_NONE ? needs_name : record->name_id >= trace->header->name_count) {
+        fprintf(stderr, "Error: ID de nombre fuera de rango (%u)\n", record->name_id);
+        return false;
+    }
+    if (record->align_shift > MAX_ALIGNMENT_SHIFT) {
+        fprintf(stderr, "Error: Alineación fuera de rango (2^%u)\n", (unsigned)record->align_shift);
+        return false;
+    }
+    op->opcode = record->opcode;
+    op->align_shift = record->align_shift;
+    op->name_id = record->name_id == NAME_ID_NONE ? NAME_ID_NONE : ids[record->name_id];
+    op->size = (size_t)record->size;
+    return true;
+}
+
+/**
+ * Libera el arreglo de operaciones y la tabla de nombres de una traza.
+ * 
+ * @param trace Traza cargada con load_trace
+ */
+void free_trace(Trace* trace) {
+    free(trace->ops);
+    name_table_free(&trace->names);
+    trace->ops = NULL;
+    trace->count = 0;
+    trace->capacity = 0;
+}
+
+/**
+ * Carga una traza binaria como arreglo de operaciones.
+ * 
+ * @param reader Archivo abierto que comienza con la firma binaria (se cierra aquí)
+ * @param path Ruta del archivo (para los mensajes de error)
+ * @param trace Traza donde se guardan las operaciones (ya inicializada vacía)
+ * @return true si el archivo es válido, false en caso contrario
+ */
+bool load_binary_trace(TraceReader* reader, const char* path, Trace* trace) {
+    BinaryTrace binary;
+    if (!binary_trace_attach(&binary, reader, path)) {
+        return false;
+    }
+    size_t count = (size_t)binary.header->record_count;
+    uint32_t* ids = binary_trace_intern_names(&binary, &trace->names);
+    trace->ops = (TraceOp*)malloc((count ? count : 1) * sizeof(TraceOp));
+    if (!ids || !trace->ops) {
+        fprintf(stderr, "Error: No hay memoria para cargar la traza\n");
+        free(ids);
+        free_trace(trace);
+        trace_reader_close(&binary.file);
+        return false;
+    }
+    trace->capacity = count;
+    for (size_t i = 0; i < count; i++) {
+        if (binary_record_to_op(&binary, ids, &binary.records[i], &trace->ops[trace->count])) {
+            trace->count++;
+        } else {
+            fprintf(stderr, "Error en el registro %zu\n", i + 1);
+        }
+    }
+    free(ids);
+    trace_reader_close(&binary.file);
+    return true;
+}
+
+/**
+ * Carga una traza completa en memoria como arreglo de operaciones.
+ * 
+ * Recorre el archivo mapeado línea por línea, interpreta cada comando con parse_span y
+ * guarda solo las operaciones efectivas (sin comentarios ni líneas vacías).
+ * Las líneas con formato incorrecto se reportan y se omiten, igual que en la
+ * ejecución directa. También acepta trazas binarias (ver BinaryTraceHeader).
+ * 
+ * @param path Ruta del archivo de traza
+ * @param trace Traza donde se guardan las operaciones (se inicializa aquí)
+ * @return true si el archivo se pudo leer, false si no se pudo abrir o no hubo memoria
+ */
+bool load_trace(const char* path, Trace* trace) {
+    trace->ops = NULL;
+    trace->count = 0;
+    trace->capacity = 0;
+    name_table_init(&trace->names);
+
+    TraceReader reader;
+    if (!trace_reader_open(&reader, path)) {
+        return false;
+    }
+    if (is_binary_trace(&reader)) {
+        return load_binary_trace(&reader, path, trace);
+    }
+
+    const char* line;
+    const char* end;
+    TraceOp op;
+    while (trace_reader_next(&reader, &line, &end)) {
+        if (!parse_span(line, end, &trace->names, &op)) {
+            fprintf(stderr, "Error en la línea %zu\n", reader.lines);
+            continue;
+        }
+        if (op.opcode == OP_NONE) {
+            continue;
+        }
+        if (trace->count == trace->capacity) {
+            size_t new_capacity = trace->capacity ? trace->capacity * 2 : 256;
+            TraceOp* ops = (TraceOp*)realloc(trace->ops, new_capacity * sizeof(TraceOp));
+            if (!ops) {
+                fprintf(stderr, "Error: No hay memoria para cargar la traza\n");
+                free_trace(trace);
+                trace_reader_close(&reader);
+                return false;
+            }
+            trace->ops = ops;
+            trace->capacity = new_capacity;
+        }
+        trace->ops[trace->count++] = op;
+    }
+
+    trace_reader_close(&reader);
+    return true;
+}
+
+
+/**
+ * Convierte una traza de texto al formato binario.
+ * 
+ * Interpreta el texto una sola vez (load_trace ya interna los nombres de
+ * variables y regiones) y escribe cabecera, tabla de nombres y registros de
+ * tamaño fijo con los mismos IDs.
+ * 
+ * @param input Ruta de la traza de texto
+ * @param output Ruta del archivo binario a crear
+ * @return true si la conversión fue exitosa, false en caso de error
+ */
+bool convert_trace_to_binary(const char* input, const char* output) {
+    Trace trace;
+    if (!load_trace(input, &trace)) {
+        return false;
+    }
+
+    const NameTable* names = &trace.names;
+    BinaryTraceRecord* records = (BinaryTraceRecord*)calloc(trace.count ? trace.count : 1, sizeof(BinaryTraceRecord));
+    bool ok = records != NULL;
+    for (size_t i = 0; ok && i < trace.count; i++) {
+        const TraceOp* op = &trace.ops[i];
+        records[i].opcode = op->opcode;
+        records[i].align_shift = op->align_shift;
+        records[i].size = op->size;
+        records[i].name_id = op->name_id;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: No hay memoria para convertir la traza\n");
+    }
+
+    FILE* file = ok ? fopen(output, "wb") : NULL;
+    if (ok && !file) {
+        fprintf(stderr, "Error: No se pudo crear el archivo '%s'\n", output);
+        ok = false;
+    }
+    if (ok) {
+        BinaryTraceHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, BINARY_TRACE_MAGIC, 8);
+        header.version = BINARY_TRACE_VERSION;
+        header.name_count = names->count;
+        header.record_count = trace.count;
+        size_t names_bytes = (size_t)names->count * MAX_NAME_LENGTH;
+        size_t padding_bytes = ((names_bytes + 7) & ~(size_t)7) - names_bytes;
+        static const char padding[8];
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(names->names, 1, names_bytes, file) == names_bytes &&
+             fwrite(padding, 1, padding_bytes, file) == padding_bytes &&
+             fwrite(records, sizeof(BinaryTraceRecord), trace.count, file) == trace.count;
+        ok = fclose(file) == 0 && ok;
+        if (!ok) {
+            fprintf(stderr, "Error: No se pudo escribir el archivo '%s'\n", output);
+        } else {
+            printf("Traza convertida: %zu operaciones, %u nombres -> '%s' (%zu bytes)\n",
+                   trace.count, names->count, output,
+                   sizeof(header) + names_bytes + padding_bytes + trace.count * sizeof(BinaryTraceRecord));
+        }
+    }
+
+    free(records);
+    free_trace(&trace);
+    return ok;
+}
+
+/**
+ * Clases de tamaño de las cachés por hilo.
+ * 
+ * Las solicitudes pequeñas se redondean a la clase inmediatamente superior para
+ * que un bloque liberado pueda reutilizarse en cualquier solicitud de la misma
+ * clase sin volver a buscar en la tabla de bloques. Granularidad de 16 bytes
+ * hasta 128 y luego pasos de 1.5x/2x hasta CACHE_MAX_SIZE.
+ */
+static const size_t size_classes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+};
+#define SIZE_CLASS_COUNT ((int)(sizeof(size_classes) / sizeof(size_classes[0])))
+
+/**
+ * Nodo de las colas de liberaciones entre hilos.
+ * 
+ * Se escribe dentro del propio bloque liberado (todos los bloques de las
+ * cachés miden al menos 16 bytes), así encolar una liberación no necesita
+ * reservar memoria adicional.
+ */
+typedef struct RemoteFree {
+    struct RemoteFree* next;       // Siguiente bloque pendiente en la cola
+    size_t block_size;             // Tamaño real del bloque (para entregas entre hilos)
+} RemoteFree;
+
+/**
+ * Inserta un nodo en una pila sin locks de múltiples productores.
+ * 
+ * Cualquier hilo puede insertar concurrentemente: el nodo se enlaza con la
+ * cabeza leída y se publica con compare-and-swap, reintentando si otro
+ * productor cambió la cabeza entretanto.
+ * 
+ * @param head Cabeza atómica de la pila
+ * @param node Nodo a insertar (pasa a ser propiedad de la pila)
+ */
+void lockfree_push(_Atomic(RemoteFree*)* head, RemoteFree* node) {
+    RemoteFree* old_head = atomic_load_explicit(head, memory_order_relaxed);
+    do {
+        node->next = old_head;
+    } while (!atomic_compare_exchange_weak_explicit(head, &old_head, node,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+/**
+ * Extrae de una vez todos los nodos de una pila sin locks.
+ * 
+ * El único consumidor intercambia la cabeza por NULL; al no extraer nodos
+ * individuales no existe el problema ABA de las pilas de Treiber.
+ * 
+ * @param head Cabeza atómica de la pila
+ * @return Lista de nodos extraídos (en orden inverso de inserción), o NULL
+ */
+RemoteFree* lockfree_take_all(_Atomic(RemoteFree*)* head) {
+    if (atomic_load_explicit(head, memory_order_relaxed) == NULL) {
+        return NULL;
+    }
+    return atomic_exchange_explicit(head, NULL, memory_order_acquire);
+}
+
+/**
+ * Conjunto de arenas en que se divide el pool en modo multihilo.
+ * 
+ * Un único pool se reparte en porciones iguales; cada porción es un
+ * MemoryManager completo (tabla de bloques, tabla de variables, algoritmo y
+ * lock propios), de modo que hilos asociados a arenas distintas no compiten
+ * por el mismo lock. Con una sola arena equivale a un heap central.
+ */
+typedef struct ArenaSet {
+    MemoryManager* arenas[MAX_ARENAS]; // Arenas independientes
+    int count;                         // Número de arenas
+    void* pool;                        // Pool compartido del que salen todas las arenas
+    size_t pool_size;                  // Tamaño total del pool
+    size_t arena_size;                 // Tamaño de cada arena (la última absorbe el resto)
+    int binding;                       // ARENA_BIND_ROUND_ROBIN o ARENA_BIND_CPU
+} ArenaSet;
+
+/**
+ * Lista de bloques libres de una clase de tamaño dentro de una caché de hilo.
+ */
+typedef struct CacheBin {
+    void* blocks[CACHE_BIN_CAPACITY];  // Direcciones de bloques listos para reutilizar
+    int count;                         // Número de bloques en la lista
+} CacheBin;
+
+/**
+ * Variable registrada en la tabla propia de un hilo.
+ * 
+ * Además del tamaño solicitado guarda el tamaño real del bloque (su clase),
+ * necesario para devolverlo a la lista correcta al liberarlo.
+ */
+typedef struct ThreadVariable {
+    uint32_t name_id;              // ID del nombre en la tabla de la traza (único dentro del hilo)
+    void* address;                 // Dirección del bloque en el pool
+    size_t size;                   // Tamaño solicitado en bytes
+    size_t block_size;             // Tamaño real del bloque reservado
+} ThreadVariable;
+
+/**
+ * Caché de asignación de un hilo (front-end al estilo tcmalloc/mimalloc).
+ * 
+ * Cada hilo tiene su propia tabla de variables y una lista de bloques libres
+ * por clase de tamaño. ALLOC y FREE se resuelven contra la caché sin tomar
+ * ningún lock; solo cuando una lista se vacía (recarga) o se llena (devolución)
+ * se accede a la arena del hilo, en lotes y bajo su lock.
+ */
+typedef struct ThreadCache {
+    ArenaSet* arenas;                  // Arenas compartidas por todos los hilos
+    int arena_index;                   // Arena a la que está asociado el hilo
+    int thread_id;                     // Identificador del hilo (para etiquetar bloques)
+    const NameTable* names;            // Nombres de la traza que reproduce el hilo (solo lectura)
+    CacheBin bins[SIZE_CLASS_COUNT];   // Bloques libres por clase de tamaño
+    ThreadVariable* variables;         // Tabla de variables propia del hilo (NAME_ID_NONE = liberada)
+    int variable_count;                // Número de variables activas del hilo
+    int variable_slots;                // Entradas usadas en 'variables' (incluye liberadas)
+    int variable_capacity;             // Capacidad de 'variables'
+    uint32_t* variable_index;          // Por ID de nombre: posición + 1 en 'variables' (0 = no asignada)
+    int max_variables;                 // Máximo de variables activas del hilo (0 = sin límite)
+    size_t ops;                        // Operaciones ejecutadas
+    size_t cache_hits;                 // Asignaciones servidas desde la caché
+    size_t refills;                    // Recargas desde la arena
+    size_t flushes;                    // Devoluciones de bloques a la arena
+    size_t remote_frees;               // Bloques devueltos a la cola de otra arena
+    size_t handoffs;                   // Bloques entregados a otro hilo para que los libere
+    size_t failed_ops;                 // Operaciones que no se pudieron completar
+    struct ThreadCache* consumer;      // Hilo que libera las variables de este (modo pipeline)
+    _Atomic(RemoteFree*) inbox;        // Bloques entregados por otros hilos para liberar
+} ThreadCache;
+
+/**
+ * Toma el lock del heap central si el gestor está en modo multihilo.
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void heap_lock(MemoryManager* mm) {
+    if (mm->thread_safe) {
+        pthread_mutex_lock(&mm->lock);
+    }
+}
+
+/**
+ * Libera el lock del heap central si el gestor está en modo multihilo.
+ * 
+ * @param mm Puntero al gestor de memoria
+ */
+void heap_unlock(MemoryManager* mm) {
+    if (mm->thread_safe) {
+        pthread_mutex_unlock(&mm->lock);
+    }
+}
+
+/**
+ * Encola un bloque para que su arena dueña lo libere más adelante.
+ * 
+ * Lo usan los hilos que liberan un bloque de una arena distinta a la suya: en
+ * lugar de tomar el lock de la otra arena (y formar un convoy detrás de su
+ * dueño), insertan el bloque en su cola MPSC sin locks.
+ * 
+ * @param mm Puntero a la arena dueña del bloque
+ * @param address Dirección del bloque liberado
+ */
+void remote_free_push(MemoryManager* mm, void* address) {
+    lockfree_push(&mm->remote_head, (RemoteFree*)address);
+    atomic_fetch_add_explicit(&mm->remote_received, 1, memory_order_relaxed);
+}
+
+/**
+ * Libera en la arena todos los bloques encolados por otros hilos.
+ * 
+ * Debe llamarse con el lock de la arena tomado (la arena es la única
+ * consumidora de su cola). Se ejecuta al comienzo de cada operación de la
+ * arena, de modo que las liberaciones remotas se aplican en la siguiente
+ * asignación o devolución del hilo dueño. Marca todos los bloques y fusiona
+ * una sola vez, así que el lock no se alarga con una pasada por bloque.
+ * 
+ * @param mm Puntero a la arena
+ */
+void drain_remote_frees(MemoryManager* mm) {
+    RemoteFree* node = lockfree_take_all(&mm->remote_head);
+    int released = 0;
+    while (node) {
+        RemoteFree* next = node->next;
+        if (mark_block_free_at(mm, node)) {
+            released++;
+        }
+        node = next;
+    }
+    request_merge_batch(mm, released);
+}
+
+/**
+ * Reserva varios bloques del mismo tamaño en una arena.
+ * 
+ * Bajo el lock de la arena, aplica primero las liberaciones remotas pendientes
+ * y luego selecciona bloques con el algoritmo configurado, los divide al
+ * tamaño pedido y los marca como ocupados con la etiqueta del hilo. Reservar
+ * en lotes amortiza el costo del lock entre varias asignaciones.
+ * 
+ * @param mm Puntero a la arena
+ * @param size Tamaño de cada bloque en bytes
+ * @param out Arreglo donde se guardan las direcciones reservadas
+ * @param count Número de bloques a reservar
+ * @param thread_id Hilo que recibe los bloques
+ * @return Número de bloques reservados (puede ser menor que count si no hay espacio)
+ */
+int central_alloc_batch(MemoryManager* mm, size_t size, void** out, int count, int thread_id) {
+    int reserved = 0;
+    heap_lock(mm);
+    drain_remote_frees(mm);
+    char label[MAX_NAME_LENGTH];
+    snprintf(label, sizeof(label), "hilo %d", thread_id);
+    uint32_t label_id = name_table_intern(&mm->symbols, label);
+    while (reserved < count) {
+        void* address = take_block(mm, size, label_id);
+        if (!address) {
+            break;
+        }
+        out[reserved++] = address;
+    }
+    heap_unlock(mm);
+    return reserved;
+}
+
+/**
+ * Devuelve varios bloques a su arena.
+ * 
+ * Bajo el lock de la arena, aplica las liberaciones remotas pendientes,
+ * marca cada bloque como libre y fusiona una sola vez para todo el lote.
+ * 
+ * @param mm Puntero a la arena dueña de los bloques
+ * @param addresses Direcciones de los bloques a devolver
+ * @param count Número de bloques
+ */
+void central_free_batch(MemoryManager* mm, void** addresses, int count) {
+    heap_lock(mm);
+    drain_remote_frees(mm);
+    int released = 0;
+    for (int i = 0; i < count; i++) {
+        if (mark_block_free_at(mm, addresses[i])) {
+            released++;
+        }
+    }
+    request_merge_batch(mm, released);
+    heap_unlock(mm);
+}
+
+/**
+ * Crea el conjunto de arenas repartiendo un único pool en partes iguales.
+ * 
+ * @param pool_size Tamaño total del pool en bytes
+ * @param count Número de arenas (1 a MAX_ARENAS)
+ * @param algorithm Algoritmo de asignación de todas las arenas
+ * @param coalesce_mode Modo de fusión de todas las arenas
+ * @param coalesce_interval Intervalo de fusión en modo diferido
+ * @param binding ARENA_BIND_ROUND_ROBIN o ARENA_BIND_CPU
+ * @return Puntero al conjunto creado, o NULL si hubo error
+ */
+ArenaSet* arena_set_create(size_t pool_size, int count, int algorithm, int coalesce_mode,
+                           int coalesce_interval, int binding) {
+    ArenaSet* set = (ArenaSet*)calloc(1, sizeof(ArenaSet));
+    if (!set) {
+        return NULL;
+    }
+    set->pool = malloc(pool_size);
+    if (!set->pool) {
+        fprintf(stderr, "Error: No se pudo asignar el bloque de memoria principal\n");
+        free(set);
+        return NULL;
+    }
+    set->pool_size = pool_size;
+    set->arena_size = pool_size / (size_t)count;
+    set->binding = binding;
+
+    for (int i = 0; i < count; i++) {
+        size_t size = (i == count - 1) ? pool_size - set->arena_size * (size_t)i : set->arena_size;
+        MemoryManager* arena = init_memory_manager_with_pool((char*)set->pool + set->arena_size * (size_t)i,
+                                                             size, algorithm);
+        if (!arena) {
+            break;
+        }
+        arena->thread_safe = true;
+        arena->coalesce_mode = coalesce_mode;
+        arena->coalesce_interval = coalesce_interval;
+        set->arenas[set->count++] = arena;
+    }
+    if (set->count != count) {
+        for (int i = 0; i < set->count; i++) {
+            destroy_memory_manager(set->arenas[i]);
+        }
+        free(set->pool);
+        free(set);
+        return NULL;
+    }
+    return set;
+}
+
+/**
+ * Destruye el conjunto de arenas y el pool compartido.
+ * 
+ * @param set Conjunto de arenas (puede ser NULL)
+ */
+void arena_set_destroy(ArenaSet* set) {
+    if (!set) return;
+    for (int i = 0; i < set->count; i++) {
+        destroy_memory_manager(set->arenas[i]);
+    }
+    free(set->pool);
+    free(set);
+}
+
+/**
+ * Obtiene la arena dueña de una dirección del pool compartido.
+ * 
+ * Como las arenas son porciones contiguas de igual tamaño, basta una división.
+ * 
+ * @param set Conjunto de arenas
+ * @param address Dirección de un bloque
+ * @return Índice de la arena dueña
+ */
+int arena_index_of(const ArenaSet* set, const void* address) {
+    size_t offset = (size_t)((const char*)address - (const char*)set->pool);
+    size_t index = offset / set->arena_size;
+    return index >= (size_t)set->count ? set->count - 1 : (int)index;
+}
+
+/**
+ * Obtiene la clase de tamaño que corresponde a una solicitud.
+ * 
+ * @param size Tamaño solicitado en bytes
+ * @return Índice en size_classes, o -1 si la solicitud es mayor que CACHE_MAX_SIZE
+ */
+int size_class_index(size_t size) {
+    if (size > CACHE_MAX_SIZE) {
+        return -1;
+    }
+    if (size <= 128) {
+        return size == 0 ? 0 : (int)((size + 15) / 16) - 1;
+    }
+    int index = 8;
+    while (size_classes[index] < size) {
+        index++;
+    }
+    return index;
+}
+
+/**
+ * Crea la caché de un hilo y la asocia a una arena.
+ * 
+ * Con ARENA_BIND_ROUND_ROBIN el hilo queda fijo en la arena thread_id % N;
+ * con ARENA_BIND_CPU la arena se recalcula en cada acceso según el núcleo.
+ * 
+ * @param arenas Conjunto de arenas compartido
+ * @param thread_id Identificador del hilo
+ * @param names Tabla de nombres de la traza a reproducir
+ * @param max_variables Máximo de variables activas del hilo (0 = sin límite)
+ * @return Puntero a la caché creada, o NULL si no hubo memoria
+ */
+ThreadCache* thread_cache_create(ArenaSet* arenas, int thread_id, const NameTable* names, int max_variables) {
+    ThreadCache* tc = (ThreadCache*)calloc(1, sizeof(ThreadCache));
+    if (!tc) {
+        return NULL;
+    }
+    // La traza ya está cargada: el índice cubre todos sus nombres
+    tc->variables = (ThreadVariable*)malloc(VARIABLE_TABLE_INITIAL * sizeof(ThreadVariable));
+    tc->variable_index = (uint32_t*)calloc(names->count > 0 ? names->count : 1, sizeof(uint32_t));
+    if (!tc->variables || !tc->variable_index) {
+        free(tc->variables);
+        free(tc->variable_index);
+        free(tc);
+        return NULL;
+    }
+    tc->variable_capacity = VARIABLE_TABLE_INITIAL;
+    tc->max_variables = max_variables;
+    tc->arenas = arenas;
+    tc->arena_index = thread_id % arenas->count;
+    tc->thread_id = thread_id;
+    tc->names = names;
+    tc->consumer = NULL;
+    atomic_init(&tc->inbox, NULL);
+    return tc;
+}
+
+/**
+ * Devuelve la arena con la que debe trabajar el hilo en este momento.
+ * 
+ * @param tc Caché del hilo
+ * @return Índice de la arena actual del hilo
+ */
+int thread_cache_arena(ThreadCache* tc) {
+    if (tc->arenas->binding == ARENA_BIND_CPU) {
+        int cpu = sched_getcpu();
+        if (cpu >= 0) {
+            tc->arena_index = cpu % tc->arenas->count;
+        }
+    }
+    return tc->arena_index;
+}
+
+/**
+ * Devuelve bloques a sus arenas dueñas.
+ * 
+ * Los bloques de la arena actual del hilo se liberan en un solo lote bajo su
+ * lock; los de otras arenas (el hilo cambió de núcleo) se encolan como
+ * liberaciones remotas para que su arena dueña los procese.
+ * 
+ * @param tc Caché del hilo
+ * @param addresses Direcciones de los bloques
+ * @param count Número de bloques
+ */
+void thread_cache_release(ThreadCache* tc, void** addresses, int count) {
+    int current = thread_cache_arena(tc);
+    void* local[CACHE_BIN_CAPACITY];
+    int local_count = 0;
+    for (int i = 0; i < count; i++) {
+        int owner = arena_index_of(tc->arenas, addresses[i]);
+        if (owner == current) {
+            local[local_count++] = addresses[i];
+            if (local_count == CACHE_BIN_CAPACITY) {
+                central_free_batch(tc->arenas->arenas[current], local, local_count);
+                local_count = 0;
+            }
+        } else {
+            remote_free_push(tc->arenas->arenas[owner], addresses[i]);
+            tc->remote_frees++;
+        }
+    }
+    if (local_count > 0) {
+        central_free_batch(tc->arenas->arenas[current], local, local_count);
+    }
+}
+
+/**
+ * Devuelve a las arenas todos los bloques libres guardados en la caché.
+ * 
+ * @param tc Caché del hilo
+ */
+void thread_cache_flush(ThreadCache* tc) {
+    for (int i = 0; i < SIZE_CLASS_COUNT; i++) {
+        CacheBin* bin = &tc->bins[i];
+        if (bin->count > 0) {
+            thread_cache_release(tc, bin->blocks, bin->count);
+            bin->count = 0;
+            tc->flushes++;
+        }
+    }
+}
+
+/**
+ * Destruye la caché de un hilo devolviendo sus bloques libres a las arenas.
+ * 
+ * Las variables que sigan activas conservan su bloque ocupado en su arena (se
+ * reportan como fugas con thread_cache_report_leaks antes de destruir).
+ * 
+ * @param tc Caché del hilo (puede ser NULL)
+ */
+void thread_cache_destroy(ThreadCache* tc) {
+    if (!tc) return;
+    thread_cache_flush(tc);
+    free(tc->variables);
+    free(tc->variable_index);
+    free(tc);
+}
+
+/**
+ * Busca una variable en la tabla del hilo por su nombre.
+ * 
+ * Como en el gestor, el ID del nombre indexa directamente variable_index.
+ * 
+ * @param tc Caché del hilo
+ * @param name_id ID del nombre de la variable
+ * @return Puntero a la variable, NULL si no existe
+ */
+ThreadVariable* thread_find_variable(ThreadCache* tc, uint32_t name_id) {
+    if (name_id >= tc->names->count || tc->variable_index[name_id] == 0) {
+        return NULL;
+    }
+    return &tc->variables[tc->variable_index[name_id] - 1];
+}
+
+/**
+ * Reserva bloques en la arena del hilo y, si no hay espacio, en las demás.
+ * 
+ * Primero intenta en la arena actual; si falla devuelve a las arenas los
+ * bloques libres de la caché y reintenta; como último recurso recorre las
+ * demás arenas en orden.
+ * 
+ * @param tc Caché del hilo
+ * @param size Tamaño de cada bloque en bytes
+ * @param out Arreglo donde se guardan las direcciones reservadas
+ * @param count Número de bloques deseados
+ * @return Número de bloques reservados (0 si ninguna arena tiene espacio)
+ */
+int thread_cache_reserve(ThreadCache* tc, size_t size, void** out, int count) {
+    ArenaSet* set = tc->arenas;
+    int current = thread_cache_arena(tc);
+    int reserved = central_alloc_batch(set->arenas[current], size, out, count, tc->thread_id);
+    if (reserved > 0) {
+        return reserved;
+    }
+    thread_cache_flush(tc);
+    for (int i = 0; i < set->count; i++) {
+        int index = (current + i) % set->count;
+        reserved = central_alloc_batch(set->arenas[index], size, out, count, tc->thread_id);
+        if (reserved > 0) {
+            return reserved;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Obtiene un bloque para una solicitud, desde la caché o desde una arena.
+ * 
+ * Las solicitudes pequeñas se sirven de la lista de su clase de tamaño sin
+ * tomar locks; si la lista está vacía se recarga con un lote de la arena del
+ * hilo. Las solicitudes grandes van directo a la arena con su tamaño exacto.
+ * 
+ * @param tc Caché del hilo
+ * @param size Tamaño solicitado en bytes
+ * @param block_size Salida: tamaño real del bloque obtenido
+ * @return Dirección del bloque, NULL si no hay memoria suficiente
+ */
+void* thread_cache_take(ThreadCache* tc, size_t size, size_t* block_size) {
+    int cls = size_class_index(size);
+    if (cls < 0) {
+        void* address = NULL;
+        if (thread_cache_reserve(tc, size, &address, 1) == 0) {
+            return NULL;
+        }
+        *block_size = size;
+        return address;
+    }
+
+    CacheBin* bin = &tc->bins[cls];
+    if (bin->count > 0) {
+        tc->cache_hits++;
+    } else {
+        tc->refills++;
+        bin->count = thread_cache_reserve(tc, size_classes[cls], bin->blocks, CACHE_REFILL_BATCH);
+        if (bin->count == 0) {
+            return NULL;
+        }
+    }
+    *block_size = size_classes[cls];
+    return bin->blocks[--bin->count];
+}
+
+/**
+ * Devuelve un bloque a la caché del hilo o a su arena dueña.
+ * 
+ * Los bloques de la arena actual del hilo vuelven a la lista de su clase sin
+ * locks; si la lista está llena, la mitad más antigua se devuelve en un lote.
+ * Los bloques grandes se devuelven directamente y los de otra arena se
+ * encolan en la cola de liberaciones remotas de su dueña.
+ * 
+ * @param tc Caché del hilo
+ * @param address Dirección del bloque
+ * @param block_size Tamaño real del bloque
+ */
+void thread_cache_give(ThreadCache* tc, void* address, size_t block_size) {
+    int cls = size_class_index(block_size);
+    if (cls < 0 || arena_index_of(tc->arenas, address) != thread_cache_arena(tc)) {
+        thread_cache_release(tc, &address, 1);
+        return;
+    }
+
+    CacheBin* bin = &tc->bins[cls];
+    if (bin->count == CACHE_BIN_CAPACITY) {
+        int half = CACHE_BIN_CAPACITY / 2;
+        thread_cache_release(tc, bin->blocks, half);
+        memmove(bin->blocks, bin->blocks + half, (size_t)(bin->count - half) * sizeof(void*));
+        bin->count -= half;
+        tc->flushes++;
+    }
+    bin->blocks[bin->count++] = address;
+}
+
+/**
+ * ALLOC desde la caché del hilo. No toma locks si la clase tiene bloques.
+ * 
+ * @param tc Caché del hilo
+ * @param name_id ID del nombre de la variable (único dentro del hilo)
+ * @param size Tamaño solicitado en bytes
+ * @return true si la asignación fue exitosa, false en caso de error
+ */
+bool thread_alloc(ThreadCache* tc, uint32_t name_id, size_t size) {
+    if (name_id >= tc->names->count || thread_find_variable(tc, name_id) ||
+        (tc->max_variables > 0 && tc->variable_count >= tc->max_variables)) {
+        return false;
+    }
+    if (tc->variable_slots == tc->variable_capacity) {
+        int capacity = tc->variable_capacity * 2;
+        ThreadVariable* variables = (ThreadVariable*)realloc(tc->variables, (size_t)capacity * sizeof(ThreadVariable));
+        if (!variables) {
+            return false;
+        }
+        tc->variables = variables;
+        tc->variable_capacity = capacity;
+    }
+    size_t block_size;
+    void* address = thread_cache_take(tc, size, &block_size);
+    if (!address) {
+        return false;
+    }
+    ThreadVariable* var = &tc->variables[tc->variable_slots++];
+    tc->variable_index[name_id] = (uint32_t)tc->variable_slots;
+    tc->variable_count++;
+    var->name_id = name_id;
+    var->address = address;
+    var->size = size;
+    var->block_size = block_size;
+    fill_with_name(address, 0, size, name_table_get(tc->names, name_id));
+    return true;
+}
+
+/**
+ * REALLOC desde la caché del hilo.
+ * 
+ * Si el nuevo tamaño cabe en el bloque actual (misma clase de tamaño) se
+ * redimensiona en el lugar; si no, se obtiene un bloque nuevo, se copian los
+ * datos y el bloque anterior vuelve a la caché.
+ * 
+ * @param tc Caché del hilo
+ * @param name_id ID del nombre de la variable
+ * @param new_size Nuevo tamaño en bytes
+ * @return true si el redimensionamiento fue exitoso, false en caso de error
+ */
+bool thread_realloc(ThreadCache* tc, uint32_t name_id, size_t new_size) {
+    ThreadVariable* var = thread_find_variable(tc, name_id);
+    if (!var) {
+        return false;
+    }
+    const char* var_name = name_table_get(tc->names, name_id);
+    if (new_size <= var->block_size) {
+        if (new_size > var->size) {
+            fill_with_name(var->address, var->size, new_size, var_name);
+        }
+        var->size = new_size;
+        return true;
+    }
+
+    size_t block_size;
+    void* address = thread_cache_take(tc, new_size, &block_size);
+    if (!address) {
+        return false;
+    }
+    memcpy(address, var->address, var->size);
+    fill_with_name(address, var->size, new_size, var_name);
+    thread_cache_give(tc, var->address, var->block_size);
+    var->address = address;
+    var->size = new_size;
+    var->block_size = block_size;
+    return true;
+}
+
+/**
+ * Quita una variable de la tabla del hilo.
+ * 
+ * Igual que variable_table_remove: marca la entrada como liberada y compacta
+ * la tabla cuando las liberadas superan a las activas, conservando el orden
+ * de asignación.
+ * 
+ * @param tc Caché del hilo
+ * @param var Variable de la tabla a quitar (deja de ser válida)
+ */
+void thread_remove_variable(ThreadCache* tc, ThreadVariable* var) {
+    tc->variable_index[var->name_id] = 0;
+    var->name_id = NAME_ID_NONE;
+    tc->variable_count--;
+    if (tc->variable_slots - tc->variable_count <= tc->variable_count + VARIABLE_TABLE_INITIAL) {
+        return;
+    }
+    int write = 0;
+    for (int read = 0; read < tc->variable_slots; read++) {
+        if (tc->variables[read].name_id != NAME_ID_NONE) {
+            tc->variables[write] = tc->variables[read];
+            tc->variable_index[tc->variables[write].name_id] = (uint32_t)(write + 1);
+            write++;
+        }
+    }
+    tc->variable_slots = write;
+}
+
+/**
+ * FREE hacia la caché del hilo. No toma locks salvo al devolver un lote.
+ * 
+ * @param tc Caché del hilo
+ * @param name_id ID del nombre de la variable a liberar
+ * @return true si la liberación fue exitosa, false si la variable no existe
+ */
+bool thread_free(ThreadCache* tc, uint32_t name_id) {
+    ThreadVariable* var = thread_find_variable(tc, name_id);
+    if (!var) {
+        return false;
+    }
+    thread_cache_give(tc, var->address, var->block_size);
+    thread_remove_variable(tc, var);
+    return true;
+}
+
+/**
+ * FREE entregado a otro hilo (modo productor/consumidor).
+ * 
+ * El hilo productor quita la variable de su tabla y entrega el bloque al hilo
+ * consumidor insertándolo en su buzón sin locks; es el consumidor quien lo
+ * libera (a su caché o, si es de otra arena, a la cola remota de la dueña).
+ * 
+ * @param tc Caché del hilo productor
+ * @param name_id ID del nombre de la variable a liberar
+ * @return true si la entrega fue exitosa, false si la variable no existe
+ */
+bool thread_handoff_free(ThreadCache* tc, uint32_t name_id) {
+    ThreadVariable* var = thread_find_variable(tc, name_id);
+    if (!var) {
+        return false;
+    }
+    RemoteFree* node = (RemoteFree*)var->address;
+    node->block_size = var->block_size;
+    lockfree_push(&tc->consumer->inbox, node);
+    tc->handoffs++;
+    thread_remove_variable(tc, var);
+    return true;
+}
+
+/**
+ * Libera los bloques que otros hilos entregaron a este hilo.
+ * 
+ * @param tc Caché del hilo consumidor
+ */
+void thread_cache_drain_inbox(ThreadCache* tc) {
+    RemoteFree* node = lockfree_take_all(&tc->inbox);
+    while (node) {
+        RemoteFree* next = node->next;
+        thread_cache_give(tc, node, node->block_size);
+        node = next;
+    }
+}
+
+/**
+ * Libera todas las variables activas del hilo (fin de una repetición de traza).
+ * 
+ * @param tc Caché del hilo
+ */
+void thread_free_all(ThreadCache* tc) {
+    for (int i = 0; i < tc->variable_slots; i++) {
+        if (tc->variables[i].name_id != NAME_ID_NONE) {
+            thread_cache_give(tc, tc->variables[i].address, tc->variables[i].block_size);
+            tc->variable_index[tc->variables[i].name_id] = 0;
+        }
+    }
+    tc->variable_count = 0;
+    tc->variable_slots = 0;
+}
+
+/**
+ * Ejecuta una operación de traza contra la caché del hilo.
+ * 
+ * PRINT se ignora en los hilos de trabajo: el estado del heap compartido se
+ * muestra al final desde el hilo principal. En modo pipeline, antes de cada
+ * operación se liberan los bloques entregados por el productor y los FREE se
+ * entregan al hilo consumidor. La alineación de ALLOC/REALLOC se ignora: las
+ * cachés reparten bloques por clase de tamaño.
+ * 
+ * @param tc Caché del hilo
+ * @param op Operación a ejecutar
+ */
+void thread_execute_op(ThreadCache* tc, const TraceOp* op) {
+    bool ok = true;
+    thread_cache_drain_inbox(tc);
+    switch (op->opcode) {
+        case OP_ALLOC: ok = thread_alloc(tc, op->name_id, op->size); break;
+        case OP_REALLOC: ok = thread_realloc(tc, op->name_id, op->size); break;
+        case OP_FREE:
+            ok = tc->consumer ? thread_handoff_free(tc, op->name_id) : thread_free(tc, op->name_id);
+            break;
+        default: return;
+    }
+    tc->ops++;
+    if (!ok) {
+        tc->failed_ops++;
+    }
+}
+
+/**
+ * Reporta las variables que siguen activas en la tabla de un hilo.
+ * 
+ * @param tc Caché del hilo
+ * @return Número de fugas reportadas
+ */
+int thread_cache_report_leaks(ThreadCache* tc) {
+    for (int i = 0; i < tc->variable_slots; i++) {
+        if (tc->variables[i].name_id == NAME_ID_NONE) {
+            continue;
+        }
+        printf("[LEAK] hilo %d: %s: %zu bytes en %p\n",
+               tc->thread_id,
+               name_table_get(tc->names, tc->variables[i].name_id),
+               tc->variables[i].size,
+               tc->variables[i].address);
+    }
+    return tc->variable_count;
+}
+
+/**
+ * Argumentos y resultado de un hilo de reproducción.
+ */
+typedef struct ReplayWorker {
+    pthread_t thread;              // Hilo de POSIX que ejecuta la reproducción
+    ThreadCache* cache;            // Caché propia del hilo
+    const Trace* trace;            // Traza compartida (solo lectura)
+    int repeat;                    // Veces que el hilo reproduce la traza completa
+} ReplayWorker;
+
+/**
+ * Cuerpo de un hilo de reproducción: ejecuta la traza 'repeat' veces.
+ * 
+ * Entre repeticiones libera las variables que quedaron activas para que la
+ * siguiente pasada pueda volver a asignar los mismos nombres; las de la última
+ * pasada se conservan para el reporte de fugas.
+ * 
+ * @param arg Puntero a ReplayWorker
+ * @return NULL
+ */
+void* replay_worker_main(void* arg) {
+    ReplayWorker* worker = (ReplayWorker*)arg;
+    for (int r = 0; r < worker->repeat; r++) {
+        if (r > 0) {
+            thread_free_all(worker->cache);
+        }
+        for (size_t i = 0; i < worker->trace->count; i++) {
+            thread_execute_op(worker->cache, &worker->trace->ops[i]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Configuración de una reproducción multihilo.
+ */
+typedef struct ReplayConfig {
+    int algorithm;                 // Algoritmo de asignación de las arenas
+    int coalesce_mode;             // Modo de fusión de las arenas
+    int coalesce_interval;         // Intervalo de fusión en modo diferido
+    size_t pool_size;              // Tamaño total del pool compartido en bytes
+    size_t thread_pool_size;       // Bytes de pool por hilo (o por arena) para calcular pool_size
+    int threads;                   // Número de hilos (1 a MAX_THREADS)
+    int repeat;                    // Repeticiones de la traza por hilo
+    int arenas;                    // Número de arenas (1 = heap central único)
+    int binding;                   // ARENA_BIND_ROUND_ROBIN o ARENA_BIND_CPU
+    bool pipeline;                 // Los FREE de cada hilo los ejecuta el hilo siguiente
+    int max_variables;             // Máximo de variables activas por hilo (0 = sin límite)
+} ReplayConfig;
+
+/**
+ * Estado final de una arena tras una reproducción multihilo.
+ */
+typedef struct ArenaReport {
+    size_t size;                   // Tamaño de la arena en bytes
+    size_t used;                   // Bytes ocupados al finalizar
+    size_t free_bytes;             // Bytes libres al finalizar
+    size_t largest_free;           // Mayor bloque libre al finalizar
+    int free_blocks;               // Bloques libres al finalizar
+    int peak_free_blocks;          // Pico de bloques libres durante la reproducción
+    size_t remote_received;        // Liberaciones remotas recibidas de otras arenas
+} ArenaReport;
+
+/**
+ * Resultado agregado de una reproducción multihilo.
+ */
+typedef struct ThreadedResult {
+    int threads;                   // Hilos utilizados
+    size_t ops;                    // Operaciones ejecutadas entre todos los hilos
+    size_t cache_hits;             // Asignaciones servidas sin lock
+    size_t refills;                // Recargas desde las arenas
+    size_t flushes;                // Devoluciones a las arenas
+    size_t remote_frees;           // Liberaciones encoladas hacia otra arena
+    size_t handoffs;               // FREE entregados a otro hilo (pipeline)
+    size_t failed_ops;             // Operaciones fallidas
+    double elapsed;                // Tiempo de pared de la reproducción en segundos
+    int arena_count;               // Número de arenas
+    ArenaReport arenas[MAX_ARENAS]; // Estado final de cada arena
+} ThreadedResult;
+
+/**
+ * Calcula el estado final de una arena recorriendo su tabla de bloques.
+ * 
+ * @param arena Arena a inspeccionar (sin hilos trabajando sobre ella)
+ * @param report Salida con los contadores de la arena
+ */
+void collect_arena_report(MemoryManager* arena, ArenaReport* report) {
+    memset(report, 0, sizeof(*report));
+    report->size = arena->pool_size;
+    report->peak_free_blocks = arena->peak_free_blocks;
+    report->remote_received = atomic_load(&arena->remote_received);
+    report->free_bytes = arena->free_bytes;
+    report->free_blocks = arena->free_block_count;
+    report->largest_free = largest_free_block(arena);
+    report->used = arena->pool_size - arena->free_bytes;
+}
+
+/**
+ * Reproduce una traza desde varios hilos sobre un pool repartido en arenas.
+ * 
+ * Crea las arenas y una caché por hilo; cada hilo reproduce la traza completa
+ * con su propio espacio de nombres de variables, de modo que sus operaciones
+ * se intercalan sobre el mismo pool. Al terminar aplica las liberaciones
+ * remotas pendientes y recoge el estado de cada arena.
+ * 
+ * @param trace Traza cargada con load_trace
+ * @param config Configuración de la reproducción
+ * @param report Si es true, reporta fugas y el estado final de cada arena
+ * @param result Salida con los contadores agregados
+ * @return true si la reproducción se ejecutó, false si no se pudieron crear las arenas o los hilos
+ */
+bool run_threaded_replay(const Trace* trace, const ReplayConfig* config, bool report, ThreadedResult* result) {
+    ArenaSet* set = arena_set_create(config->pool_size, config->arenas, config->algorithm,
+                                     config->coalesce_mode, config->coalesce_interval, config->binding);
+    if (!set) {
+        return false;
+    }
+
+    int threads = config->threads;
+    ReplayWorker workers[MAX_THREADS];
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        workers[t].cache = thread_cache_create(set, t, &trace->names, config->max_variables);
+        workers[t].trace = trace;
+        workers[t].repeat = config->repeat;
+        if (!workers[t].cache) {
+            fprintf(stderr, "Error: No se pudo crear la caché del hilo %d\n", t);
+            break;
+        }
+        started++;
+    }
+
+    if (config->pipeline && started == threads && threads > 1) {
+        for (int t = 0; t < threads; t++) {
+            workers[t].cache->consumer = workers[(t + 1) % threads].cache;
+        }
+    }
+
+    double start = monotonic_seconds();
+    int running = 0;
+    if (started == threads) {
+        for (; running < threads; running++) {
+            if (pthread_create(&workers[running].thread, NULL, replay_worker_main, &workers[running]) != 0) {
+                fprintf(stderr, "Error: No se pudo crear el hilo %d\n", running);
+                break;
+            }
+        }
+    }
+    for (int t = 0; t < running; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+    double elapsed = monotonic_seconds() - start;
+
+    memset(result, 0, sizeof(*result));
+    result->threads = threads;
+    result->elapsed = elapsed;
+    int leaks = 0;
+    for (int t = 0; t < started; t++) {
+        // Entregas que llegaron cuando el consumidor ya había terminado
+        thread_cache_drain_inbox(workers[t].cache);
+    }
+    for (int t = 0; t < started; t++) {
+        ThreadCache* tc = workers[t].cache;
+        if (report) {
+            leaks += thread_cache_report_leaks(tc);
+        }
+        result->ops += tc->ops;
+        result->cache_hits += tc->cache_hits;
+        result->refills += tc->refills;
+        result->flushes += tc->flushes;
+        result->remote_frees += tc->remote_frees;
+        result->handoffs += tc->handoffs;
+        result->failed_ops += tc->failed_ops;
+        thread_cache_destroy(tc);
+    }
+    if (report && leaks == 0) {
+        printf("No se detectaron fugas de memoria.\n");
+    }
+
+    result->arena_count = set->count;
+    for (int i = 0; i < set->count; i++) {
+        MemoryManager* arena = set->arenas[i];
+        drain_remote_frees(arena);
+        flush_pending_merges(arena);
+        collect_arena_report(arena, &result->arenas[i]);
+        if (report && set->count == 1) {
+            print_memory_state(arena);
+        }
+    }
+
+    arena_set_destroy(set);
+    return started == threads && running == threads;
+}
+
+/**
+ * Imprime los contadores de una reproducción multihilo y el estado por arena.
+ * 
+ * @param result Resultado de run_threaded_replay
+ * @param repeat Repeticiones de la traza por hilo
+ */
+void print_threaded_result(const ThreadedResult* result, int repeat) {
+    size_t allocs = result->cache_hits + result->refills;
+    printf("\n=== Reproducción multihilo ===\n");
+    printf("  Hilos: %d\n", result->threads);
+    printf("  Arenas: %d\n", result->arena_count);
+    printf("  Repeticiones por hilo: %d\n", repeat);
+    printf("  Operaciones: %zu (%zu fallidas)\n", result->ops, result->failed_ops);
+    printf("  Tiempo: %.6f s\n", result->elapsed);
+    printf("  Ops/s: %.0f\n", result->elapsed > 0 ? (double)result->ops / result->elapsed : 0.0);
+    printf("  Aciertos de caché: %zu (%.1f%%)\n", result->cache_hits,
+           allocs > 0 ? 100.0 * (double)result->cache_hits / (double)allocs : 0.0);
+    printf("  Recargas desde las arenas: %zu\n", result->refills);
+    printf("  Devoluciones a las arenas: %zu\n", result->flushes);
+    printf("  Liberaciones remotas: %zu\n", result->remote_frees);
+    printf("  FREE entregados a otro hilo: %zu\n", result->handoffs);
+    printf("\n%6s %10s %10s %10s %12s %12s %12s %10s\n", "Arena", "Bytes", "Usada", "Libre",
+           "Bloq. libres", "Pico libres", "Mayor libre", "Remotas");
+    for (int i = 0; i < result->arena_count; i++) {
+        const ArenaReport* arena = &result->arenas[i];
+        printf("%6d %10zu %10zu %10zu %12d %12d %12zu %10zu\n", i, arena->size, arena->used,
+               arena->free_bytes, arena->free_blocks, arena->peak_free_blocks,
+               arena->largest_free, arena->remote_received);
+    }
+    printf("===========================\n");
+}
+
+/**
+ * Benchmark de escalabilidad: reproduce la traza con 1, 2, 4, ..., 64 hilos.
+ * 
+ * Cada punto usa arenas nuevas cuyo pool crece con el número de hilos
+ * (thread_pool_size bytes por hilo) para que todos tengan el mismo presupuesto de
+ * memoria. Si se pidió más de una arena, se usa una arena por hilo (hasta el
+ * máximo pedido). Imprime el rendimiento en operaciones por segundo, la
+ * aceleración respecto a un hilo y la fragmentación media por arena.
+ * 
+ * @param trace Traza cargada con load_trace
+ * @param base Configuración base (algoritmo, fusión, repeticiones, arenas)
+ */
+void run_scaling_benchmark(const Trace* trace, const ReplayConfig* base) {
+    printf("=== Escalabilidad multihilo (%d repeticiones por hilo) ===\n", base->repeat);
+    printf("%6s %7s %14s %12s %14s %9s %10s %14s\n", "Hilos", "Arenas", "Operaciones", "Tiempo (s)",
+           "Ops/s", "Acel.", "Fallidas", "Libres/arena");
+    double base_rate = 0.0;
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        ReplayConfig config = *base;
+        config.threads = threads;
+        config.pool_size = base->thread_pool_size * (size_t)threads;
+        if (config.arenas > threads) {
+            config.arenas = threads;
+        }
+        ThreadedResult result;
+        if (!run_threaded_replay(trace, &config, false, &result)) {
+            return;
+        }
+        double rate = result.elapsed > 0 ? (double)result.ops / result.elapsed : 0.0;
+        if (threads == 1) {
+            base_rate = rate;
+        }
+        double free_blocks = 0.0;
+        for (int i = 0; i < result.arena_count; i++) {
+            free_blocks += result.arenas[i].free_blocks;
+        }
+        printf("%6d %7d %14zu %12.6f %14.0f %8.2fx %10zu %14.1f\n", threads, result.arena_count,
+               result.ops, result.elapsed, rate, base_rate > 0 ? rate / base_rate : 0.0,
+               result.failed_ops, free_blocks / result.arena_count);
+    }
+}
+
+/**
+ * Reproducción de una traza con un algoritmo, dentro de --compare.
+ */
+typedef struct PolicyReplay {
+    const Trace* trace;            // Traza compartida (solo lectura)
+    MemoryManager* mm;             // Gestor propio de este algoritmo
+    pthread_t thread;              // Hilo que reproduce la traza
+    double cpu_time;               // Tiempo de CPU del hilo en la reproducción (segundos)
+    int leaks;                     // Variables vivas al terminar
+} PolicyReplay;
+
+/**
+ * Hilo de --compare: ejecuta todas las operaciones de la traza sobre su gestor.
+ * 
+ * PRINT, STATS y LATENCY se omiten porque su salida se intercalaría con la de
+ * los otros hilos; las métricas se reportan al final, lado a lado.
+ * 
+ * @param arg PolicyReplay del hilo
+ * @return NULL
+ */
+void* policy_replay_main(void* arg) {
+    PolicyReplay* replay = (PolicyReplay*)arg;
+    const Trace* trace = replay->trace;
+    double start = thread_cpu_seconds();
+    for (size_t i = 0; i < trace->count; i++) {
+        if (latency_reported_ops[trace->ops[i].opcode]) {
+            execute_op(replay->mm, &trace->ops[i]);
+        }
+    }
+    replay->cpu_time = thread_cpu_seconds() - start;
+    replay->leaks = replay->mm->variable_count;
+    for (int d = 0; d < replay->mm->region_depth; d++) {
+        replay->leaks += replay->mm->regions[d].variable_count - replay->mm->regions[d].freed;
+    }
+    return NULL;
+}
+
+/**
+ * Compara First-fit, Best-fit y Worst-fit sobre la misma traza en paralelo.
+ * 
+ * La traza se interpreta una sola vez (load_trace) y cada algoritmo la
+ * reproduce en su propio hilo sobre su propio gestor, así que el tiempo total
+ * es el del algoritmo más lento y no la suma de los tres. Cada gestor interna
+ * los nombres de la traza en el mismo orden, de modo que los IDs de las
+ * operaciones valen sin traducirlos. Imprime una tabla con una columna por
+ * algoritmo.
+ * 
+ * @param path Ruta de la traza
+ * @param config Configuración de los tres gestores
+ * @return true si la comparación se completó, false en caso de error
+ */
+bool run_policy_comparison(const char* path, const ManagerConfig* config) {
+    static const char* names[] = {"First-fit", "Best-fit", "Worst-fit"};
+    const int policies = (int)(sizeof(names) / sizeof(names[0]));
+
+    double load_start = monotonic_seconds();
+    Trace trace;
+    if (!load_trace(path, &trace)) {
+        return false;
+    }
+    double load_elapsed = monotonic_seconds() - load_start;
+
+    PolicyReplay replays[3];
+    bool ok = true;
+    int created = 0;
+    for (; created < policies; created++) {
+        PolicyReplay* replay = &replays[created];
+        replay->trace = &trace;
+        replay->mm = create_configured_manager(config, created);
+        if (!replay->mm) {
+            ok = false;
+            break;
+        }
+        replay->mm->quiet = true;
+        replay->mm->mute_errors = true;
+        for (uint32_t id = 0; id < trace.names.count; id++) {
+            name_table_intern(&replay->mm->symbols, name_table_get(&trace.names, id));
+        }
+    }
+
+    double start = monotonic_seconds();
+    int started = 0;
+    for (; ok && started < policies; started++) {
+        if (pthread_create(&replays[started].thread, NULL, policy_replay_main, &replays[started]) != 0) {
+            fprintf(stderr, "Error: No se pudo crear el hilo de %s\n", names[started]);
+            ok = false;
+            break;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(replays[i].thread, NULL);
+    }
+    double elapsed = monotonic_seconds() - start;
+
+    if (ok) {
+        double serial = 0.0;
+        printf("=== Comparación de algoritmos (%zu operaciones) ===\n", trace.count);
+        printf("  %-32s", "");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14s", names[i]);
+        }
+        printf("\n  %-32s", "Tiempo de CPU (s)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14.6f", replays[i].cpu_time);
+            serial += replays[i].cpu_time;
+        }
+        printf("\n  %-32s", "Ops/s (por segundo de CPU)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14.0f", replays[i].cpu_time > 0 ? (double)replays[i].mm->executed_ops / replays[i].cpu_time : 0.0);
+        }
+        printf("\n  %-32s", "Latencia p99 (ns)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14llu", (unsigned long long)latency_percentile_combined(replays[i].mm, 99.0));
+        }
+        printf("\n  %-32s", "Asignaciones fallidas");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14zu", replays[i].mm->op_failures[OP_ALLOC] + replays[i].mm->op_failures[OP_REALLOC]);
+        }
+        printf("\n  %-32s", "Operaciones fallidas");
+        for (int i = 0; i < policies; i++) {
+            size_t failed = 0;
+            for (int opcode = 0; opcode < OP_COUNT; opcode++) {
+                failed += replays[i].mm->op_failures[opcode];
+            }
+            printf(" %14zu", failed);
+        }
+        printf("\n  %-32s", "Pico de bloques libres");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14d", replays[i].mm->peak_free_blocks);
+        }
+        printf("\n  %-32s", "Pico de fragmentación externa");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14.3f", replays[i].mm->peak_external_fragmentation);
+        }
+        printf("\n  %-32s", "Fragmentación externa final");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14.3f", external_fragmentation(replays[i].mm));
+        }
+        printf("\n  %-32s", "Fragmentación interna (bytes)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14zu", internal_fragmentation(replays[i].mm));
+        }
+        printf("\n  %-32s", "Marca de agua (bytes)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14zu", replays[i].mm->high_water);
+        }
+        printf("\n  %-32s", "Tamaño final del pool (bytes)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14zu", replays[i].mm->pool_size);
+        }
+        printf("\n  %-32s", "Relleno sin usar (bytes)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14zu", replays[i].mm->padding_live);
+        }
+        printf("\n  %-32s", "Bloques de relleno libres");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14zu", replays[i].mm->padding_live_blocks);
+        }
+        printf("\n  %-32s", "Relleno separado total (bytes)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14zu", replays[i].mm->alignment_padding);
+        }
+        printf("\n  %-32s", "Asignaciones grandes (mmap)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14zu", replays[i].mm->large_allocs);
+        }
+        printf("\n  %-32s", "Memoria residente (bytes)");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14zu", pool_resident_bytes(replays[i].mm));
+        }
+        printf("\n  %-32s", "Variables sin liberar");
+        for (int i = 0; i < policies; i++) {
+            printf(" %14d", replays[i].leaks);
+        }
+        printf("\n\n  Carga de la traza: %.6f s (una sola vez)\n", load_elapsed);
+        printf("  Tiempo de pared: %.6f s (CPU de los algoritmos: %.6f s, %.2fx)\n",
+               elapsed, serial, elapsed > 0 ? serial / elapsed : 0.0);
+        printf("===========================\n");
+    }
+
+    for (int i = 0; i < created; i++) {
+        destroy_memory_manager(replays[i].mm);
+    }
+    free_trace(&trace);
+    return ok;
+}
+
+/**
+ * Traza de una reproducción por lotes (--batch-replay) y su resultado.
+ */
+typedef struct BatchJob {
+    char* path;                    // Ruta de la traza
+    bool ok;                       // La traza se pudo cargar y reproducir
+    int worker;                    // Hilo que la reprodujo
+    size_t ops;                    // Operaciones ejecutadas
+    size_t failed_allocs;          // ALLOC y REALLOC fallidos
+    double cpu_time;               // Tiempo de CPU de la carga y la reproducción (segundos)
+    double peak_fragmentation;     // Pico de fragmentación externa
+    uint64_t p99_ns;               // Latencia p99 de las operaciones del heap
+    int leaks;                     // Variables sin liberar al terminar
+} BatchJob;
+
+/**
+ * Cola de trabajos de un hilo del lote, con robo de trabajo.
+ * 
+ * Los trabajos de un hilo son un rango [inicio, fin) del arreglo de trazas,
+ * empaquetado en una sola palabra de 64 bits (inicio en la mitad alta). El
+ * dueño toma del final y los demás hilos roban del inicio; ambos cambian la
+ * palabra completa con compare-and-swap, así que nunca se entrega el mismo
+ * trabajo dos veces. Como no se agregan trabajos, una cola vacía sigue vacía.
+ * Cada cola ocupa su propia línea de caché.
+ */
+typedef struct JobDeque {
+    _Alignas(64) _Atomic(uint64_t) range; // (inicio << 32) | fin
+    size_t executed;               // Trabajos ejecutados por el dueño (propios o robados)
+    size_t stolen;                 // Trabajos que el dueño robó de otras colas
+} JobDeque;
+
+/**
+ * Estado compartido de una reproducción por lotes.
+ */
+typedef struct BatchPool {
+    BatchJob* jobs;                // Trazas a reproducir
+    size_t job_count;
+    JobDeque* deques;              // Una cola por hilo
+    int workers;                   // Hilos del lote
+    int algorithm;                 // Algoritmo de cada gestor
+    const ManagerConfig* config;   // Configuración de cada gestor
+} BatchPool;
+
+/**
+ * Argumento de cada hilo del lote.
+ */
+typedef struct BatchWorker {
+    BatchPool* pool;
+    int id;                        // Índice del hilo y de su cola
+    pthread_t thread;
+} BatchWorker;
+
+/**
+ * Toma el último trabajo de la cola propia.
+ * 
+ * @param deque Cola del hilo
+ * @param job Salida con el índice del trabajo
+ * @return true si había un trabajo, false si la cola está vacía
+ */
+bool job_deque_pop(JobDeque* deque, size_t* job) {
+    uint64_t range = atomic_load(&deque->range);
+    for (;;) {
+        uint32_t head = (uint32_t)(range >> 32);
+        uint32_t tail = (uint32_t)range;
+        if (head >= tail) {
+            return false;
+        }
+        uint64_t next = ((uint64_t)head << 32) | (tail - 1);
+        if (atomic_compare_exchange_weak(&deque->range, &range, next)) {
+            *job = tail - 1;
+            return true;
+        }
+    }
+}
+
+/**
+ * Roba el primer trabajo de la cola de otro hilo.
+ * 
+ * @param deque Cola víctima
+ * @param job Salida con el índice del trabajo
+ * @return true si se robó un trabajo, false si la cola está vacía
+ */
+bool job_deque_steal(JobDeque* deque, size_t* job) {
+    uint64_t range = atomic_load(&deque->range);
+    for (;;) {
+        uint32_t head = (uint32_t)(range >> 32);
+        uint32_t tail = (uint32_t)range;
+        if (head >= tail) {
+            return false;
+        }
+        uint64_t next = ((uint64_t)(head + 1) << 32) | tail;
+        if (atomic_compare_exchange_weak(&deque->range, &range, next)) {
+            *job = head;
+            return true;
+        }
+    }
+}
+
+/**
+ * Carga y reproduce una traza del lote sobre un gestor propio.
+ * 
+ * El gestor es exclusivo del trabajo y se destruye al terminar, así que las
+ * trazas no comparten estado. Como en --compare, se ejecutan solo las
+ * operaciones que modifican el heap y los errores solo se cuentan.
+ * 
+ * @param pool Estado del lote
+ * @param job Trabajo a ejecutar
+ */
+void run_batch_job(const BatchPool* pool, BatchJob* job) {
+    double start = thread_cpu_seconds();
+    Trace trace;
+    if (!load_trace(job->path, &trace)) {
+        return;
+    }
+    MemoryManager* mm = create_configured_manager(pool->config, pool->algorithm);
+    if (!mm) {
+        free_trace(&trace);
+        return;
+    }
+    mm->quiet = true;
+    mm->mute_errors = true;
+    for (uint32_t id = 0; id < trace.names.count; id++) {
+        name_table_intern(&mm->symbols, name_table_get(&trace.names, id));
+    }
+    for (size_t i = 0; i < trace.count; i++) {
+        if (latency_reported_ops[trace.ops[i].opcode]) {
+            execute_op(mm, &trace.ops[i]);
+        }
+    }
+
+    job->ok = true;
+    job->ops = mm->executed_ops;
+    job->failed_allocs = mm->op_failures[OP_ALLOC] + mm->op_failures[OP_REALLOC];
+    job->peak_fragmentation = mm->peak_external_fragmentation;
+    job->p99_ns = latency_percentile_combined(mm, 99.0);
+    job->leaks = mm->variable_count;
+    for (int d = 0; d < mm->region_depth; d++) {
+        job->leaks += mm->regions[d].variable_count - mm->regions[d].freed;
+    }
+    destroy_memory_manager(mm);
+    free_trace(&trace);
+    job->cpu_time = thread_cpu_seconds() - start;
+}
+
+/**
+ * Hilo del lote: vacía su cola y después roba de las demás hasta que todas
+ * están vacías.
+ * 
+ * @param arg BatchWorker del hilo
+ * @return NULL
+ */
+void* batch_worker_main(void* arg) {
+    BatchWorker* worker = (BatchWorker*)arg;
+    BatchPool* pool = worker->pool;
+    JobDeque* own = &pool->deques[worker->id];
+    size_t job;
+    for (;;) {
+        bool found = job_deque_pop(own, &job);
+        for (int k = 1; !found && k < pool->workers; k++) {
+            if (job_deque_steal(&pool->deques[(worker->id + k) % pool->workers], &job)) {
+                found = true;
+                own->stolen++;
+            }
+        }
+        if (!found) {
+            return NULL;
+        }
+        pool->jobs[job].worker = worker->id;
+        run_batch_job(pool, &pool->jobs[job]);
+        own->executed++;
+    }
+}
+
+/**
+ * Compara dos rutas para ordenarlas con qsort.
+ */
+int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * Agrega una ruta (copiada) al arreglo dinámico de rutas.
+ * 
+ * @return true si se agregó, false si no hubo memoria
+ */
+bool append_path(char*** paths, size_t* count, size_t* capacity, const char* path) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        char** grown = (char**)realloc(*paths, new_capacity * sizeof(char*));
+        if (!grown) {
+            return false;
+        }
+        *paths = grown;
+        *capacity = new_capacity;
+    }
+    char* copy = strdup(path);
+    if (!copy) {
+        return false;
+    }
+    (*paths)[(*count)++] = copy;
+    return true;
+}
+
+/**
+ * Reúne las trazas de un lote.
+ * 
+ * Si source es un directorio, toma sus archivos regulares (sin los ocultos)
+ * en orden alfabético. Si no, lo lee como lista con una ruta por línea; las
+ * líneas vacías y las que empiezan con # se ignoran.
+ * 
+ * @param source Directorio o archivo de lista
+ * @param paths Salida con las rutas (se liberan con free una por una)
+ * @param count Salida con el número de rutas
+ * @return true si se pudo leer el origen, false en caso de error
+ */
+bool collect_batch_paths(const char* source, char*** paths, size_t* count) {
+    *paths = NULL;
+    *count = 0;
+    size_t capacity = 0;
+    struct stat info;
+    if (stat(source, &info) != 0) {
+        fprintf(stderr, "Error: No se pudo abrir '%s'\n", source);
+        return false;
+    }
+
+    bool ok = true;
+    if (S_ISDIR(info.st_mode)) {
+        DIR* dir = opendir(source);
+        if (!dir) {
+            fprintf(stderr, "Error: No se pudo leer el directorio '%s'\n", source);
+            return false;
+        }
+        struct dirent* entry;
+        while (ok && (entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            size_t length = strlen(source) + strlen(entry->d_name) + 2;
+            char* path = (char*)malloc(length);
+            if (!path) {
+                ok = false;
+                break;
+            }
+            snprintf(path, length, "%s/%s", source, entry->d_name);
+            struct stat file_info;
+            if (stat(path, &file_info) == 0 && S_ISREG(file_info.st_mode)) {
+                ok = append_path(paths, count, &capacity, path);
+            }
+            free(path);
+        }
+        closedir(dir);
+        if (ok) {
+            qsort(*paths, *count, sizeof(char*), compare_paths);
+        }
+    } else {
+        FILE* list = fopen(source, "r");
+        if (!list) {
+            fprintf(stderr, "Error: No se pudo abrir '%s'\n", source);
+            return false;
+        }
+        char* line = NULL;
+        size_t line_capacity = 0;
+        while (ok && getline(&line, &line_capacity, list) != -1) {
+            char* start = line;
+            while (isspace((unsigned char)*start)) {
+                start++;
+            }
+            char* end = start + strlen(start);
+            while (end > start && isspace((unsigned char)end[-1])) {
+                *--end = '\0';
+            }
+            if (*start != '\0' && *start != '#') {
+                ok = append_path(paths, count, &capacity, start);
+            }
+        }
+        free(line);
+        fclose(list);
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: No hay memoria para la lista de trazas\n");
+    }
+    return ok;
+}
+
+/**
+ * Reproduce muchas trazas en un conjunto fijo de hilos con robo de trabajo.
+ * 
+ * Las trazas se reparten en rangos contiguos, uno por hilo; cuando un hilo
+ * termina los suyos roba de los demás, así que todos siguen ocupados aunque
+ * unas trazas sean mucho más largas que otras. Cada traza se reproduce sobre
+ * un gestor propio. Al final imprime una línea por traza, en el orden de la
+ * lista, y los totales del lote.
+ * 
+ * @param source Directorio o archivo con la lista de trazas
+ * @param workers Hilos del lote
+ * @param algorithm Algoritmo de asignación de cada gestor
+ * @param config Configuración de cada gestor
+ * @return true si todas las trazas se reprodujeron, false en caso contrario
+ */
+bool run_batch_replay(const char* source, int workers, int algorithm, const ManagerConfig* config) {
+    char** paths;
+    size_t count;
+    if (!collect_batch_paths(source, &paths, &count)) {
+        return false;
+    }
+    if (count == 0 || count > UINT32_MAX) {
+        fprintf(stderr, "Error: '%s' no contiene trazas\n", source);
+        free(paths);
+        return false;
+    }
+    if ((size_t)workers > count) {
+        workers = (int)count;
+    }
+
+    BatchPool pool;
+    pool.jobs = (BatchJob*)calloc(count, sizeof(BatchJob));
+    pool.deques = (JobDeque*)aligned_alloc(64, (size_t)workers * sizeof(JobDeque));
+    BatchWorker* threads = (BatchWorker*)calloc((size_t)workers, sizeof(BatchWorker));
+    bool ok = pool.jobs && pool.deques && threads;
+    if (!ok) {
+        fprintf(stderr, "Error: No hay memoria para el lote\n");
+    }
+    pool.job_count = count;
+    pool.workers = workers;
+    pool.algorithm = algorithm;
+    pool.config = config;
+
+    double start = monotonic_seconds();
+    int started = 0;
+    if (ok) {
+        for (size_t i = 0; i < count; i++) {
+            pool.jobs[i].path = paths[i];
+        }
+        for (int w = 0; w < workers; w++) {
+            uint64_t head = count * (size_t)w / (size_t)workers;
+            uint64_t tail = count * (size_t)(w + 1) / (size_t)workers;
+            atomic_init(&pool.deques[w].range, (head << 32) | tail);
+            pool.deques[w].executed = 0;
+            pool.deques[w].stolen = 0;
+        }
+        for (; started < workers; started++) {
+            threads[started].pool = &pool;
+            threads[started].id = started;
+            if (pthread_create(&threads[started].thread, NULL, batch_worker_main, &threads[started]) != 0) {
+                fprintf(stderr, "Error: No se pudo crear el hilo %d del lote\n", started);
+                break;
             }
         }
-        
-        // No se puede expandir en el lugar, intentar reasignar
-        // Liberar el bloque actual
-        block->is_free = true;
-        strcpy(block->variable_name, "");
-        merge_free_blocks(mm);
-        
-        // Intentar asignar uno nuevo
-        MemoryBlock* new_block = select_block(mm, new_size);
-        if (!new_block) {
-            fprintf(stderr, "Error: No hay suficiente memoria para expandir '%s'\n", var_name);
-            // Intentar restaurar
-            block->is_free = false;
-            strcpy(block->variable_name, var_name);
-            return false;
+        // Si no arrancaron todos los hilos, los demás roban los trabajos de sus colas
+        if (started == 0) {
+            ok = false;
         }
-        
-        // Copiar datos
-        void* old_addr = var->address;
-        size_t copy_size = old_size < new_size ? old_size : new_size;
-        memcpy(new_block->address, old_addr, copy_size);
-        
-        // Asignar nuevo bloque
-        new_block->is_free = false;
-        strcpy(new_block->variable_name, var_name);
-        split_block(new_block, new_size);
-        
-        // Actualizar variable
-        var->address = new_block->address;
-        var->size = new_size;
-        
-        // Llenar toda la nueva memoria con el nombre (repetido)
-        size_t name_len2 = strlen(var_name);
-        if (name_len2 > 0) {
-            for (size_t i = copy_size; i < new_size; i++) {
-                ((char*)new_block->address)[i] = var_name[i % name_len2];
+    }
+    for (int w = 0; w < started; w++) {
+        pthread_join(threads[w].thread, NULL);
+    }
+    double elapsed = monotonic_seconds() - start;
+
+    if (ok) {
+        size_t total_ops = 0;
+        size_t failed_traces = 0;
+        double cpu_time = 0.0;
+        printf("=== Reproducción por lotes: %zu trazas, %d hilos, %s ===\n", count, started,
+               algorithm == 0 ? "First-fit" : algorithm == 1 ? "Best-fit" : "Worst-fit");
+        printf("  %-36s %12s %10s %10s %12s %9s %9s %8s %5s\n", "Traza", "Ops", "Fallidas", "CPU (s)",
+               "Ops/s", "p99 (ns)", "Frag máx", "Fugas", "Hilo");
+        for (size_t i = 0; i < count; i++) {
+            const BatchJob* job = &pool.jobs[i];
+            if (!job->ok) {
+                printf("  %-36s %12s\n", job->path, "(error)");
+                failed_traces++;
+                continue;
             }
-        } else {
-            memset((char*)new_block->address + copy_size, 0, new_size - copy_size);
+            printf("  %-36s %12zu %10zu %10.6f %12.0f %9llu %9.3f %8d %5d\n", job->path, job->ops,
+                   job->failed_allocs, job->cpu_time,
+                   job->cpu_time > 0 ? (double)job->ops / job->cpu_time : 0.0,
+                   (unsigned long long)job->p99_ns, job->peak_fragmentation, job->leaks, job->worker);
+            total_ops += job->ops;
+            cpu_time += job->cpu_time;
         }
-        
-        printf("REALLOC: Variable '%s' reasignada de %zu a %zu bytes\n", var_name, old_size, new_size);
-        return true;
+        printf("\n  Trazas reproducidas: %zu de %zu\n", count - failed_traces, count);
+        printf("  Operaciones: %zu\n", total_ops);
+        printf("  Tiempo de pared: %.6f s (%.0f ops/s)\n", elapsed, elapsed > 0 ? (double)total_ops / elapsed : 0.0);
+        printf("  Tiempo de CPU: %.6f s (%.2fx el tiempo de pared)\n", cpu_time,
+               elapsed > 0 ? cpu_time / elapsed : 0.0);
+        printf("  %5s %10s %10s\n", "Hilo", "Trazas", "Robadas");
+        for (int w = 0; w < started; w++) {
+            printf("  %5d %10zu %10zu\n", w, pool.deques[w].executed, pool.deques[w].stolen);
+        }
+        printf("===========================\n");
+        ok = failed_traces == 0;
     }
+
+    for (size_t i = 0; i < count; i++) {
+        free(paths[i]);
+    }
+    free(paths);
+    free(pool.jobs);
+    free(pool.deques);
+    free(threads);
+    return ok;
 }
 
 /**
- * Libera la memoria asignada a una variable.
- * 
- * Busca la variable por nombre, marca su bloque como libre, fusiona bloques
- * libres adyacentes para reducir fragmentación, y elimina la variable de
- * la tabla reorganizando las entradas para mantener la tabla compacta.
- * 
- * @param mm Puntero al gestor de memoria
- * @param var_name Nombre de la variable a liberar
- * @return true si la liberación fue exitosa, false si la variable no existe
+ * Opciones de línea de comandos del programa.
+ *
+ * Agrupa los parámetros posicionales (archivo y algoritmo) y las opciones con
+ * formato --nombre[=valor] que configuran el gestor y la salida.
  */
-bool free_memory(MemoryManager* mm, const char* var_name) {
-    Variable* var = find_variable(mm, var_name);
-    if (!var) {
-        fprintf(stderr, "Error: La variable '%s' no existe\n", var_name);
+typedef struct Options {
+    const char* input_path;       // Archivo con los comandos a ejecutar
+    int algorithm;                // 0=First-fit, 1=Best-fit, 2=Worst-fit
+    int coalesce_mode;            // COALESCE_EAGER o COALESCE_DEFERRED
+    int coalesce_interval;        // Fusionar cada N liberaciones en modo diferido (0 = bajo demanda)
+    bool summary;                 // Imprimir resumen de ejecución al finalizar
+    int threads;                  // Hilos de reproducción (0 = modo secuencial original)
+    int repeat;                   // Repeticiones de la traza por hilo en modo multihilo
+    bool scaling;                 // Ejecutar el benchmark de escalabilidad de 1 a MAX_THREADS hilos
+    int arenas;                   // Arenas en que se divide el pool en modo multihilo
+    int arena_binding;            // ARENA_BIND_ROUND_ROBIN o ARENA_BIND_CPU
+    bool pipeline;                // Modo productor/consumidor entre hilos
+    bool parse_only;              // Solo medir el parsing de la traza, sin ejecutarla
+    const char* convert_path;     // Convertir la traza a formato binario en este archivo
+    int scan_blocks;              // Bloques del benchmark de recorrido (0 = no ejecutarlo)
+    const char* fit_kernel;       // Forzar un núcleo de búsqueda (NULL = elegir según la CPU)
+    int metrics_interval;         // Imprimir métricas de fragmentación cada N operaciones (0 = nunca)
+    bool latency;                 // Imprimir los percentiles de latencia al terminar
+    int output_format;            // OUTPUT_TEXT, OUTPUT_JSON u OUTPUT_CSV
+    bool quiet;                   // Omitir los mensajes por operación y mostrar solo contadores
+    int batch_kb;                 // Búfer de salida de N KB (0 = el de stdio por defecto)
+    bool compare;                 // Reproducir la traza con los tres algoritmos en paralelo
+    bool batch_replay;            // El archivo de entrada es un directorio o lista de trazas
+    int workers;                  // Hilos de --batch-replay (0 = uno por núcleo)
+    size_t pool_size;             // Tamaño inicial del pool (por hilo en modo multihilo)
+    size_t grow_chunk;            // Crecer el pool de a este tamaño (0 = pool fijo)
+    size_t pool_limit;            // Tamaño máximo del pool si crece
+    int max_variables;            // Máximo de variables activas (0 = sin límite)
+    bool phantom;                 // Pool fantasma: solo metadatos, sin contenido
+    bool headers;                 // Etiquetas de bloque dentro del pool
+    size_t large_threshold;       // Umbral de las asignaciones con mmap directo (0 = desactivado)
+    int page_mode;                // PAGES_MALLOC, PAGES_MMAP, PAGES_THP o PAGES_HUGETLB
+} Options;
+
+/**
+ * Interpreta un tamaño en bytes con sufijo opcional K, M, G o T (potencias de 1024).
+ *
+ * @param text Texto a interpretar (por ejemplo "64M")
+ * @param out Salida con el tamaño en bytes
+ * @return true si el tamaño es válido y mayor que 0
+ */
+bool parse_byte_size(const char* text, size_t* out) {
+    char* end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text || text[0] == '-' || value == 0) {
         return false;
     }
-    
-    // Buscar el bloque asociado
-    MemoryBlock* block = mm->blocks;
-    while (block) {
-        if (block->address == var->address && !block->is_free) {
-            break;
-        }
-        block = block->next;
+    int shift = 0;
+    switch (*end) {
+        case 'K': case 'k': shift = 10; end++; break;
+        case 'M': case 'm': shift = 20; end++; break;
+        case 'G': case 'g': shift = 30; end++; break;
+        case 'T': case 't': shift = 40; end++; break;
+        default: break;
     }
-    
-    if (!block) {
-        fprintf(stderr, "Error: No se encontró el bloque para '%s'\n", var_name);
+    if (*end != '\0' || value > (SIZE_MAX >> shift)) {
         return false;
     }
-    
-    // Liberar el bloque
-    block->is_free = true;
-    strcpy(block->variable_name, "");
-    
-    // Fusionar bloques libres adyacentes
-    merge_free_blocks(mm);
-    
-    // Eliminar de la tabla de variables
-    for (int i = 0; i < mm->variable_count; i++) {
-        if (strcmp(mm->variables[i].name, var_name) == 0) {
-            // Mover las variables restantes
-            for (int j = i; j < mm->variable_count - 1; j++) {
-                mm->variables[j] = mm->variables[j + 1];
+    *out = (size_t)value << shift;
+    return true;
+}
+
+/**
+ * Muestra la ayuda de uso del programa por la salida de error.
+ *
+ * @param program Nombre del ejecutable (argv[0])
+ */
+void print_usage(const char* program) {
+    fprintf(stderr, "Uso: %s <archivo_entrada> [algoritmo] [opciones]\n", program);
+    fprintf(stderr, "Algoritmos: 0=First-fit, 1=Best-fit, 2=Worst-fit\n");
+    fprintf(stderr, "Por defecto se usa First-fit\n");
+    fprintf(stderr, "Opciones:\n");
+    fprintf(stderr, "  --coalesce=eager|deferred[:N]  Fusión inmediata (por defecto) o diferida,\n");
+    fprintf(stderr, "                                 con una pasada cada N liberaciones\n");
+    fprintf(stderr, "  --summary                      Mostrar tiempo total y pico de fragmentación\n");
+    fprintf(stderr, "  --threads=N                    Reproducir la traza desde N hilos (1-%d) con cachés por hilo\n", MAX_THREADS);
+    fprintf(stderr, "  --repeat=K                     Repeticiones de la traza por hilo (por defecto 1)\n");
+    fprintf(stderr, "  --scaling                      Benchmark de escalabilidad con 1, 2, 4, ..., %d hilos\n", MAX_THREADS);
+    fprintf(stderr, "  --arenas=N                     Dividir el pool en N arenas independientes (1-%d)\n", MAX_ARENAS);
+    fprintf(stderr, "  --arena-bind=rr|cpu            Asociar hilos a arenas por turno (por defecto) o por núcleo\n");
+    fprintf(stderr, "  --pipeline                     Los FREE de cada hilo los ejecuta el hilo siguiente\n");
+    fprintf(stderr, "  --parse-only                   Solo interpretar la traza y reportar líneas/s\n");
+    fprintf(stderr, "  --convert=<salida>             Convertir la traza de texto a formato binario\n");
+    fprintf(stderr, "  --scan-bench[=N]               Comparar el recorrido de la tabla de bloques contra\n");
+    fprintf(stderr, "                                 la lista enlazada con N bloques (por defecto 100000)\n");
+    fprintf(stderr, "  --fit-kernel=escalar|sse4|avx2 Forzar el núcleo de Best-fit/Worst-fit (por defecto\n");
+    fprintf(stderr, "                                 el más ancho que soporte la CPU)\n");
+    fprintf(stderr, "  --frag-interval=N              Imprimir métricas de fragmentación cada N operaciones\n");
+    fprintf(stderr, "  --latency                      Al terminar, imprimir p50/p90/p99/p99.9/máx por operación\n");
+    fprintf(stderr, "  --format=text|json|csv         Formato de la salida (json/csv: un registro por línea)\n");
+    fprintf(stderr, "  --pool-size=N[K|M|G|T]         Tamaño del pool (por defecto %d bytes; por hilo en modo multihilo)\n",
+            MEMORY_SIZE);
+    fprintf(stderr, "  --grow=N[K|M|G][:MAX]          Si no hay bloque, agregar al pool tramos de N bytes hasta MAX\n");
+    fprintf(stderr, "                                 (por defecto 64G de espacio virtual)\n");
+    fprintf(stderr, "  --max-variables=N              Limitar las variables activas a N (por defecto sin límite)\n");
+    fprintf(stderr, "  --mmap[=thp|huge]              Pool con mmap (páginas normales, THP o MAP_HUGETLB) que\n");
+    fprintf(stderr, "                                 devuelve al sistema las páginas libres\n");
+    fprintf(stderr, "  --phantom                      Pool de solo metadatos: no llenar ni copiar el contenido,\n");
+    fprintf(stderr, "                                 para simular pools de terabytes\n");
+    fprintf(stderr, "  --headers                      Cabecera en cada bloque y pie en los libres dentro del pool\n");
+    fprintf(stderr, "                                 (el costo de las etiquetas cuenta como fragmentación)\n");
+    fprintf(stderr, "  --large-threshold=N[K|M|G]     Servir los ALLOC/REALLOC de N bytes o más con su propio mmap,\n");
+    fprintf(stderr, "                                 fuera del pool, y devolverlo al sistema en FREE\n");
+    fprintf(stderr, "  --compare                      Reproducir la traza con los tres algoritmos en paralelo\n");
+    fprintf(stderr, "  --batch-replay                 La entrada es un directorio o una lista de trazas que se\n");
+    fprintf(stderr, "                                 reproducen en paralelo con robo de trabajo\n");
+    fprintf(stderr, "  --workers=N                    Hilos de --batch-replay (por defecto, uno por núcleo)\n");
+    fprintf(stderr, "  --quiet                        Omitir el mensaje de cada operación; al final, contadores\n");
+    fprintf(stderr, "  --batch[=KB]                   Acumular la salida y escribirla de a KB kilobytes (por defecto %d)\n",
+            BATCH_DEFAULT_KB);
+}
+
+/**
+ * Interpreta los argumentos de la línea de comandos.
+ *
+ * Los argumentos que empiezan con "--" son opciones; el resto son, en orden,
+ * el archivo de entrada (obligatorio salvo con --scan-bench) y el algoritmo (opcional).
+ *
+ * @param argc Número de argumentos
+ * @param argv Arreglo de argumentos
+ * @param opts Estructura donde se guardan las opciones interpretadas
+ * @return true si los argumentos son válidos, false en caso contrario
+ */
+bool parse_options(int argc, char* argv[], Options* opts) {
+    opts->input_path = NULL;
+    opts->algorithm = 0; // Por defecto First-fit
+    opts->coalesce_mode = COALESCE_EAGER;
+    opts->coalesce_interval = 0;
+    opts->summary = false;
+    opts->threads = 0;
+    opts->repeat = 1;
+    opts->scaling = false;
+    opts->arenas = 1;
+    opts->arena_binding = ARENA_BIND_ROUND_ROBIN;
+    opts->pipeline = false;
+    opts->parse_only = false;
+    opts->convert_path = NULL;
+    opts->scan_blocks = 0;
+    opts->fit_kernel = NULL;
+    opts->metrics_interval = 0;
+    opts->latency = false;
+    opts->output_format = OUTPUT_TEXT;
+    opts->quiet = false;
+    opts->batch_kb = 0;
+    opts->compare = false;
+    opts->batch_replay = false;
+    opts->workers = 0;
+    opts->pool_size = MEMORY_SIZE;
+    opts->grow_chunk = 0;
+    opts->pool_limit = POOL_RESERVE_DEFAULT;
+    opts->max_variables = 0;
+    opts->phantom = false;
+    opts->headers = false;
+    opts->large_threshold = 0;
+    opts->page_mode = PAGES_MALLOC;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            if (positional == 0) {
+                opts->input_path = arg;
+            } else if (positional == 1) {
+                char* end;
+                long algorithm = strtol(arg, &end, 10);
+                if (*end != '\0' || algorithm < 0 || algorithm > 2) {
+                    fprintf(stderr, "Error: Algoritmo inválido. Use 0, 1 o 2\n");
+                    return false;
+                }
+                opts->algorithm = (int)algorithm;
+            } else {
+                return false;
             }
-            mm->variable_count--;
-            break;
+            positional++;
+        } else if (strcmp(arg, "--coalesce=eager") == 0) {
+            opts->coalesce_mode = COALESCE_EAGER;
+        } else if (strncmp(arg, "--coalesce=deferred", 19) == 0) {
+            opts->coalesce_mode = COALESCE_DEFERRED;
+            if (arg[19] == ':') {
+                char* end;
+                long interval = strtol(arg + 20, &end, 10);
+                if (*end != '\0' || interval < 0) {
+                    fprintf(stderr, "Error: Intervalo de fusión inválido '%s'\n", arg + 20);
+                    return false;
+                }
+                opts->coalesce_interval = (int)interval;
+            } else if (arg[19] != '\0') {
+                fprintf(stderr, "Error: Opción desconocida '%s'\n", arg);
+                return false;
+            }
+        } else if (strcmp(arg, "--summary") == 0) {
+            opts->summary = true;
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            char* end;
+            long threads = strtol(arg + 10, &end, 10);
+            if (*end != '\0' || threads < 1 || threads > MAX_THREADS) {
+                fprintf(stderr, "Error: Número de hilos inválido '%s'\n", arg + 10);
+                return false;
+            }
+            opts->threads = (int)threads;
+        } else if (strncmp(arg, "--repeat=", 9) == 0) {
+            char* end;
+            long repeat = strtol(arg + 9, &end, 10);
+            if (*end != '\0' || repeat < 1) {
+                fprintf(stderr, "Error: Número de repeticiones inválido '%s'\n", arg + 9);
+                return false;
+            }
+            opts->repeat = (int)repeat;
+        } else if (strcmp(arg, "--scaling") == 0) {
+            opts->scaling = true;
+        } else if (strncmp(arg, "--arenas=", 9) == 0) {
+            char* end;
+            long arenas = strtol(arg + 9, &end, 10);
+            if (*end != '\0' || arenas < 1 || arenas > MAX_ARENAS) {
+                fprintf(stderr, "Error: Número de arenas inválido '%s'\n", arg + 9);
+                return false;
+            }
+            opts->arenas = (int)arenas;
+        } else if (strcmp(arg, "--arena-bind=rr") == 0) {
+            opts->arena_binding = ARENA_BIND_ROUND_ROBIN;
+        } else if (strcmp(arg, "--arena-bind=cpu") == 0) {
+            opts->arena_binding = ARENA_BIND_CPU;
+        } else if (strcmp(arg, "--pipeline") == 0) {
+            opts->pipeline = true;
+        } else if (strcmp(arg, "--parse-only") == 0) {
+            opts->parse_only = true;
+        } else if (strncmp(arg, "--convert=", 10) == 0 && arg[10] != '\0') {
+            opts->convert_path = arg + 10;
+        } else if (strcmp(arg, "--scan-bench") == 0) {
+            opts->scan_blocks = 100000;
+        } else if (strncmp(arg, "--scan-bench=", 13) == 0) {
+            char* end;
+            long blocks = strtol(arg + 13, &end, 10);
+            if (*end != '\0' || blocks < 1 || blocks > 100000000) {
+                fprintf(stderr, "Error: Número de bloques inválido '%s'\n", arg + 13);
+                return false;
+            }
+            opts->scan_blocks = (int)blocks;
+        } else if (strcmp(arg, "--format=text") == 0) {
+            opts->output_format = OUTPUT_TEXT;
+        } else if (strcmp(arg, "--format=json") == 0) {
+            opts->output_format = OUTPUT_JSON;
+        } else if (strcmp(arg, "--format=csv") == 0) {
+            opts->output_format = OUTPUT_CSV;
+        } else if (strncmp(arg, "--pool-size=", 12) == 0) {
+            if (!parse_byte_size(arg + 12, &opts->pool_size)) {
+                fprintf(stderr, "Error: Tamaño de pool inválido '%s'\n", arg + 12);
+                return false;
+            }
+        } else if (strncmp(arg, "--grow=", 7) == 0) {
+            char chunk[32];
+            const char* colon = strchr(arg + 7, ':');
+            size_t length = colon ? (size_t)(colon - (arg + 7)) : strlen(arg + 7);
+            if (length >= sizeof(chunk)) {
+                length = sizeof(chunk) - 1;
+            }
+            memcpy(chunk, arg + 7, length);
+            chunk[length] = '\0';
+            if (!parse_byte_size(chunk, &opts->grow_chunk) ||
+                (colon && !parse_byte_size(colon + 1, &opts->pool_limit))) {
+                fprintf(stderr, "Error: Crecimiento inválido '%s' (use N o N:MAX)\n", arg + 7);
+                return false;
+            }
+        } else if (strncmp(arg, "--max-variables=", 16) == 0) {
+            char* end;
+            long limit = strtol(arg + 16, &end, 10);
+            if (*end != '\0' || limit < 1 || limit > INT32_MAX) {
+                fprintf(stderr, "Error: Límite de variables inválido '%s'\n", arg + 16);
+                return false;
+            }
+            opts->max_variables = (int)limit;
+        } else if (strcmp(arg, "--mmap") == 0) {
+            opts->page_mode = PAGES_MMAP;
+        } else if (strcmp(arg, "--mmap=thp") == 0) {
+            opts->page_mode = PAGES_THP;
+        } else if (strcmp(arg, "--mmap=huge") == 0) {
+            opts->page_mode = PAGES_HUGETLB;
+        } else if (strcmp(arg, "--phantom") == 0) {
+            opts->phantom = true;
+        } else if (strcmp(arg, "--headers") == 0) {
+            opts->headers = true;
+        } else if (strncmp(arg, "--large-threshold=", 18) == 0) {
+            if (!parse_byte_size(arg + 18, &opts->large_threshold) || opts->large_threshold == 0) {
+                fprintf(stderr, "Error: Umbral de asignaciones grandes inválido '%s'\n", arg + 18);
+                return false;
+            }
+        } else if (strcmp(arg, "--batch-replay") == 0) {
+            opts->batch_replay = true;
+        } else if (strncmp(arg, "--workers=", 10) == 0) {
+            char* end;
+            long workers = strtol(arg + 10, &end, 10);
+            if (*end != '\0' || workers < 1 || workers > MAX_THREADS) {
+                fprintf(stderr, "Error: Número de hilos inválido '%s' (1-%d)\n", arg + 10, MAX_THREADS);
+                return false;
+            }
+            opts->workers = (int)workers;
+        } else if (strcmp(arg, "--compare") == 0) {
+            opts->compare = true;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            opts->quiet = true;
+        } else if (strcmp(arg, "--batch") == 0) {
+            opts->batch_kb = BATCH_DEFAULT_KB;
+        } else if (strncmp(arg, "--batch=", 8) == 0) {
+            char* end;
+            long kb = strtol(arg + 8, &end, 10);
+            if (*end != '\0' || kb < 1 || kb > 1024 * 1024) {
+                fprintf(stderr, "Error: Tamaño de lote inválido '%s'\n", arg + 8);
+                return false;
+            }
+            opts->batch_kb = (int)kb;
+        } else if (strcmp(arg, "--latency") == 0) {
+            opts->latency = true;
+        } else if (strncmp(arg, "--frag-interval=", 16) == 0) {
+            char* end;
+            long interval = strtol(arg + 16, &end, 10);
+            if (*end != '\0' || interval < 1 || interval > INT32_MAX) {
+                fprintf(stderr, "Error: Intervalo de métricas inválido '%s'\n", arg + 16);
+                return false;
+            }
+            opts->metrics_interval = (int)interval;
+        } else if (strncmp(arg, "--fit-kernel=", 13) == 0) {
+            opts->fit_kernel = arg + 13;
+        } else {
+            fprintf(stderr, "Error: Opción desconocida '%s'\n", arg);
+            return false;
         }
     }
-    
-    printf("FREE: Variable '%s' liberada\n", var_name);
-    return true;
+
+    // El benchmark de recorrido no necesita archivo de entrada
+    return opts->input_path != NULL || opts->scan_blocks > 0;
 }
 
 /**
- * Imprime el estado completo del gestor de memoria.
- * 
- * Muestra información detallada sobre todas las variables activas, todos los
- * bloques (libres y ocupados) con sus direcciones y tamaños, y estadísticas
- * generales como memoria total, libre, usada y nivel de fragmentación.
- * Útil para depuración y monitoreo del estado del sistema.
- * 
- * @param mm Puntero al gestor de memoria
+ * Mide el rendimiento del parser sobre una traza sin ejecutar las operaciones.
+ *
+ * Recorre el archivo mapeado con el tokenizador y reporta líneas por segundo
+ * y MB/s, para separar el costo del parsing del de la asignación.
+ *
+ * @param path Ruta del archivo de traza
+ * @return true si el archivo se pudo leer, false en caso contrario
  */
-void print_memory_state(MemoryManager* mm) {
-    printf("\n=== Estado de la Memoria ===\n");
-    printf("Variables activas: %d\n", mm->variable_count);
-    printf("\nVariables asignadas:\n");
-    for (int i = 0; i < mm->variable_count; i++) {
-        printf("  - %s: %zu bytes en dirección %p\n", 
-               mm->variables[i].name, 
-               mm->variables[i].size, 
-               mm->variables[i].address);
+bool run_parse_benchmark(const char* path) {
+    TraceReader reader;
+    if (!trace_reader_open(&reader, path)) {
+        return false;
     }
-    
-    printf("\nBloques de memoria:\n");
-    MemoryBlock* current = mm->blocks;
-    int block_num = 1;
-    while (current) {
-        printf("  Bloque %d: %s [%zu bytes] en %p - %s\n",
-               block_num++,
-               current->is_free ? "LIBRE" : current->variable_name,
-               current->size,
-               current->address,
-               current->is_free ? "(libre)" : "(ocupado)");
-        current = current->next;
+    if (is_binary_trace(&reader)) {
+        printf("La traza es binaria: sus registros no requieren parsing\n");
+        trace_reader_close(&reader);
+        return true;
     }
-    
-    // Calcular estadísticas
-    size_t total_free = 0;
-    size_t total_used = 0;
-    int free_blocks = 0;
-    int used_blocks = 0;
-    
-    current = mm->blocks;
-    while (current) {
-        if (current->is_free) {
-            total_free += current->size;
-            free_blocks++;
-        } else {
-            total_used += current->size;
-            used_blocks++;
+
+    double start = monotonic_seconds();
+    const char* line;
+    const char* end;
+    TraceOp op;
+    NameTable names;
+    name_table_init(&names);
+    size_t ops = 0;
+    size_t errors = 0;
+    while (trace_reader_next(&reader, &line, &end)) {
+        if (!parse_span(line, end, &names, &op)) {
+            errors++;
+        } else if (op.opcode != OP_NONE) {
+            ops++;
         }
-        current = current->next;
     }
-    
-    printf("\nEstadísticas:\n");
-    printf("  Memoria total: %zu bytes\n", mm->pool_size);
-    printf("  Memoria libre: %zu bytes (%d bloques)\n", total_free, free_blocks);
-    printf("  Memoria usada: %zu bytes (%d bloques)\n", total_used, used_blocks);
-    printf("  Fragmentación: %d bloques libres\n", free_blocks);
-    printf("===========================\n\n");
+    double elapsed = monotonic_seconds() - start;
+
+    printf("=== Parsing de la traza ===\n");
+    printf("  Líneas: %zu (%zu operaciones, %zu con error, %u nombres distintos)\n",
+           reader.lines, ops, errors, names.count);
+    printf("  Tamaño: %zu bytes (%s)\n", reader.size, reader.mapped ? "mmap" : "leído completo");
+    printf("  Tiempo: %.6f s\n", elapsed);
+    if (elapsed > 0) {
+        printf("  Rendimiento: %.0f líneas/s, %.1f MB/s\n",
+               (double)reader.lines / elapsed, (double)reader.size / elapsed / 1e6);
+    }
+    printf("===========================\n");
+    name_table_free(&names);
+    trace_reader_close(&reader);
+    return true;
 }
 
 /**
- * Reporta variables que aún están activas al finalizar el programa.
+ * Nodo de bloque con el formato de la antigua lista enlazada.
  * 
- * Recorre la tabla de variables y muestra todas las que aún están asignadas.
- * Si no hay variables activas, indica que no se detectaron fugas. Esta función
- * ayuda a identificar variables que no fueron liberadas antes de terminar.
+ * Solo lo usa run_scan_benchmark para comparar el recorrido de la tabla de
+ * bloques contra el de la lista original (un malloc por nodo y el nombre
+ * completo dentro de cada nodo).
+ */
+typedef struct LegacyBlock {
+    char variable_name[MAX_NAME_LENGTH];  // Nombre de la variable que ocupa el bloque
+    void* address;                        // Dirección de inicio del bloque en el pool
+    size_t size;                          // Tamaño del bloque en bytes
+    bool is_free;                         // Indica si el bloque está libre
+    struct LegacyBlock* next;             // Siguiente bloque en la lista
+} LegacyBlock;
+
+/**
+ * Best-fit sobre la lista enlazada antigua (referencia del benchmark).
  * 
- * @param mm Puntero al gestor de memoria
+ * @param head Primer nodo de la lista
+ * @param size Tamaño requerido en bytes
+ * @return Nodo seleccionado, NULL si no hay espacio suficiente
  */
-void report_leaks(MemoryManager* mm) {
-        int leaks = 0;
-        for (int i = 0; i < mm->variable_count; i++) {
-            printf("[LEAK] %s: %zu bytes en %p\n",
-                   mm->variables[i].name,
-                   mm->variables[i].size,
-                   mm->variables[i].address);
-            leaks++;
-        }
-        if (leaks == 0) {
-            printf("No se detectaron fugas de memoria.\n");
+LegacyBlock* legacy_best_fit(LegacyBlock* head, size_t size) {
+    LegacyBlock* best = NULL;
+    for (LegacyBlock* current = head; current; current = current->next) {
+        if (current->is_free && current->size >= size && (!best || current->size < best->size)) {
+            best = current;
         }
     }
-    
+    return best;
+}
+
+/**
+ * Generador pseudoaleatorio determinista (LCG de 64 bits) para los benchmarks.
+ * 
+ * @param state Estado del generador (se actualiza)
+ * @return Siguiente valor pseudoaleatorio de 32 bits
+ */
+uint32_t bench_random(uint64_t* state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(*state >> 33);
+}
 
 /**
- * Procesa una línea de comando del archivo de entrada.
+ * Mide el tiempo por bloque de una búsqueda Best-fit (recorre todos los bloques).
  * 
- * Parsea la línea, identifica el comando (ALLOC, REALLOC, FREE, PRINT),
- * extrae los parámetros necesarios y ejecuta la operación correspondiente.
- * Ignora líneas vacías y comentarios (que comienzan con #). Valida el formato
- * de cada comando antes de ejecutarlo.
+ * Construye una tabla de 'blocks' bloques que alternan ocupados y libres con
+ * tamaños pseudoaleatorios y la misma secuencia como lista enlazada de nodos
+ * individuales, una vez enlazada en el orden en que se reservaron los nodos y
+ * otra en orden aleatorio (como queda el heap tras mucho uso). Sobre la
+ * tabla mide cada núcleo de búsqueda que soporta la CPU (escalar, SSE4.2,
+ * AVX2) después de verificar que elige los mismos bloques que el escalar.
+ * Reporta nanosegundos por bloque visitado en cada caso.
  * 
- * @param mm Puntero al gestor de memoria
- * @param line Línea de texto con el comando a procesar (se modifica durante el parsing)
- * @return true si el comando se procesó exitosamente, false si hubo un error
+ * @param blocks Número de bloques de la tabla
+ * @return true si el benchmark se ejecutó y los núcleos coinciden, false en caso contrario
  */
-bool process_line(MemoryManager* mm, char* line) {
-    // Eliminar salto de línea
-    line[strcspn(line, "\r\n")] = 0;
-    
-    // Ignorar líneas vacías y comentarios
-    if (line[0] == '\0' || line[0] == '#') {
-        return true;
-    }
-    
-    // Eliminar espacios al inicio
-    while (*line == ' ' || *line == '\t') {
-        line++;
-    }
-    // Trim left (espacios/tabs)
-    char* p = line;
-    while (*p == ' ' || *p == '\t') {
-        p++;
-    }
+bool run_scan_benchmark(int blocks) {
+    MemoryManager* mm = init_memory_manager_with_pool(NULL, 0, 1);
+    LegacyBlock** nodes = (LegacyBlock**)calloc((size_t)blocks, sizeof(LegacyBlock*));
+    bool ok = mm && nodes && block_table_reserve(&mm->blocks, blocks);
 
-    // Ignorar líneas vacías y comentarios (incluye comentarios con espacios iniciales)
-    if (*p == '\0' || *p == '#') {
-        return true;
+    // Bloques alternados ocupado/libre con tamaños entre 16 y 1039 bytes
+    uint64_t state = 42;
+    size_t offset = 0;
+    for (int i = 0; ok && i < blocks; i++) {
+        size_t size = 16 + bench_random(&state) % 1024;
+        bool is_free = (i % 2) == 1;
+        mm->blocks.offsets[i] = offset;
+        mm->blocks.sizes[i] = size;
+        mm->blocks.is_free[i] = is_free;
+        mm->blocks.name_ids[i] = is_free ? NAME_ID_NONE : 0;
+        nodes[i] = (LegacyBlock*)calloc(1, sizeof(LegacyBlock));
+        if (!nodes[i]) {
+            ok = false;
+            break;
+        }
+        nodes[i]->address = (void*)(uintptr_t)offset;
+        nodes[i]->size = size;
+        nodes[i]->is_free = is_free;
+        offset += size;
     }
+    if (!ok) {
+        fprintf(stderr, "Error: No hay memoria para el benchmark de recorrido\n");
+    } else {
+        mm->blocks.count = blocks;
+        mm->pool_size = offset;
 
-    
-    char command[20];
-    char var_name[MAX_NAME_LENGTH];
-    size_t size;
-    
-    if (sscanf(p, "%s", command) != 1) {
-        return true;
-    }
-    
-    if (strcmp(command, "ALLOC") == 0) {
-        if (sscanf(p, "%s %s %zu", command, var_name, &size) == 3) {
-            return alloc_memory(mm, var_name, size);
-        } else {
-            fprintf(stderr, "Error: Formato incorrecto para ALLOC\n");
-            return false;
+        // Cantidad de búsquedas para visitar ~5e7 bloques en cada variante
+        int rounds = (int)(50000000 / blocks);
+        if (rounds < 1) {
+            rounds = 1;
         }
-    } else if (strcmp(command, "REALLOC") == 0) {
-        if (sscanf(p, "%s %s %zu", command, var_name, &size) == 3) {
-            return realloc_memory(mm, var_name, size);
-        } else {
-            fprintf(stderr, "Error: Formato incorrecto para REALLOC\n");
-            return false;
+        double list_ns[2];
+        double kernel_ns[FIT_KERNEL_COUNT];
+        volatile size_t sink = 0;
+        double start;
+
+        for (int variant = 0; variant < 2; variant++) {
+            if (variant == 1) {
+                // Enlazar los nodos en orden aleatorio (Fisher-Yates)
+                for (int i = blocks - 1; i > 0; i--) {
+                    int j = (int)(bench_random(&state) % (uint32_t)(i + 1));
+                    LegacyBlock* tmp = nodes[i];
+                    nodes[i] = nodes[j];
+                    nodes[j] = tmp;
+                }
+            }
+            for (int i = 0; i < blocks; i++) {
+                nodes[i]->next = i + 1 < blocks ? nodes[i + 1] : NULL;
+            }
+            start = monotonic_seconds();
+            for (int r = 0; r < rounds; r++) {
+                sink += (size_t)legacy_best_fit(nodes[0], 512 + (size_t)(r & 7));
+            }
+            list_ns[variant] = (monotonic_seconds() - start) * 1e9 / ((double)rounds * blocks);
         }
-    } else if (strcmp(command, "FREE") == 0) {
-        if (sscanf(p, "%s %s", command, var_name) == 2) {
-            return free_memory(mm, var_name);
-        } else {
-            fprintf(stderr, "Error: Formato incorrecto para FREE\n");
-            return false;
+
+        const BlockTable* table = &mm->blocks;
+        for (int k = 0; k < FIT_KERNEL_COUNT; k++) {
+            const FitKernels* kernels = &fit_kernel_table[k];
+            kernel_ns[k] = 0;
+            if (!fit_kernels_supported(kernels)) {
+                continue;
+            }
+            // Verificar contra la versión escalar, incluyendo restos que no llenan un vector
+            for (int tail = 0; tail < 4 && tail < blocks; tail++) {
+                for (size_t request = 0; request <= 1100; request += 37) {
+                    int count = blocks - tail;
+                    if (kernels->best(table->sizes, table->is_free, count, request) !=
+                            best_fit_scalar(table->sizes, table->is_free, count, request) ||
+                        kernels->worst(table->sizes, table->is_free, count, request) !=
+                            worst_fit_scalar(table->sizes, table->is_free, count, request)) {
+                        fprintf(stderr, "Error: El núcleo %s no coincide con la versión escalar\n",
+                                kernels->name);
+                        ok = false;
+                    }
+                }
+            }
+            start = monotonic_seconds();
+            for (int r = 0; r < rounds; r++) {
+                sink += (size_t)kernels->best(table->sizes, table->is_free, table->count,
+                                              512 + (size_t)(r & 7));
+            }
+            kernel_ns[k] = (monotonic_seconds() - start) * 1e9 / ((double)rounds * blocks);
         }
-    } else if (strcmp(command, "PRINT") == 0) {
-        print_memory_state(mm);
-        return true;
+        (void)sink;
+
+        double used_ns = kernel_ns[fit_kernels - fit_kernel_table];
+        printf("=== Recorrido Best-fit: %d bloques, %d búsquedas ===\n", blocks, rounds);
+        for (int k = 0; k < FIT_KERNEL_COUNT; k++) {
+            if (kernel_ns[k] > 0) {
+                printf("  Tabla, núcleo %-8s%s %9.3f ns/bloque (%.2fx)\n", fit_kernel_table[k].name,
+                       &fit_kernel_table[k] == fit_kernels ? "*" : " ",
+                       kernel_ns[k], kernel_ns[k] / used_ns);
+            }
+        }
+        printf("  Lista enlazada (orden de reserva): %9.3f ns/bloque (%.2fx)\n",
+               list_ns[0], list_ns[0] / used_ns);
+        printf("  Lista enlazada (nodos dispersos):  %9.3f ns/bloque (%.2fx)\n",
+               list_ns[1], list_ns[1] / used_ns);
+        printf("  (* núcleo en uso; entre paréntesis, tiempo relativo a ese núcleo)\n");
+        printf("===========================\n");
+    }
+
+    for (int i = 0; nodes && i < blocks; i++) {
+        free(nodes[i]);
+    }
+    free(nodes);
+    destroy_memory_manager(mm);
+    return ok;
+}
+
+/**
+ * Imprime el resumen de ejecución: tiempo total y comportamiento de la fusión.
+ *
+ * Permite comparar el modo de fusión inmediato contra el diferido, o un
+ * algoritmo contra otro, sobre la misma traza: tiempo de procesamiento,
+ * operaciones por segundo, latencia p99, asignaciones fallidas, pasadas de
+ * fusión, picos de fragmentación y memoria de metadatos.
+ *
+ * @param mm Puntero al gestor de memoria
+ * @param elapsed Tiempo de procesamiento de la traza en segundos
+ * @param lines Líneas leídas de la traza
+ */
+void print_run_summary(MemoryManager* mm, double elapsed, size_t lines) {
+    size_t failed_allocs = mm->op_failures[OP_ALLOC] + mm->op_failures[OP_REALLOC];
+    if (mm->output) {
+        record_begin(mm->output, RECORD_SUMMARY);
+        record_string(mm->output, "coalesce", mm->coalesce_mode == COALESCE_EAGER ? "eager" : "deferred");
+        record_size(mm->output, "coalesce_interval", (size_t)mm->coalesce_interval);
+        record_double(mm->output, "elapsed_s", elapsed);
+        record_size(mm->output, "lines", lines);
+        record_double(mm->output, "lines_per_s", elapsed > 0 ? (double)lines / elapsed : 0.0);
+        record_size(mm->output, "ops", mm->executed_ops);
+        record_double(mm->output, "ops_per_s", elapsed > 0 ? (double)mm->executed_ops / elapsed : 0.0);
+        record_size(mm->output, "failed_allocs", failed_allocs);
+        record_size(mm->output, "p99_ns", (size_t)latency_percentile_combined(mm, 99.0));
+        record_size(mm->output, "merge_passes", mm->merge_passes);
+        record_size(mm->output, "peak_free_blocks", (size_t)mm->peak_free_blocks);
+        record_double(mm->output, "peak_external_fragmentation", mm->peak_external_fragmentation);
+        record_size(mm->output, "metadata_bytes", metadata_bytes(mm));
+        record_size(mm->output, "pool_bytes", mm->pool_size);
+        record_size(mm->output, "pool_grows", mm->pool_grows);
+        record_size(mm->output, "resident_bytes", pool_resident_bytes(mm));
+        record_size(mm->output, "released_bytes", mm->released_bytes);
+        record_size(mm->output, "aligned_requests", mm->aligned_requests);
+        record_size(mm->output, "alignment_padding", mm->padding_live);
+        record_size(mm->output, "padding_blocks", mm->padding_live_blocks);
+        record_size(mm->output, "alignment_padding_total", mm->alignment_padding);
+        record_size(mm->output, "padding_blocks_total", mm->padding_blocks);
+        record_size(mm->output, "tag_bytes", tag_bytes(mm));
+        record_size(mm->output, "large_allocs", mm->large_allocs);
+        record_size(mm->output, "large_bytes", mm->large_bytes);
+        record_end(mm->output);
+        emit_stats_record(mm, "final");
+        return;
+    }
+    printf("\n=== Resumen de ejecución ===\n");
+    if (mm->coalesce_mode == COALESCE_EAGER) {
+        printf("  Modo de fusión: inmediata\n");
+    } else if (mm->coalesce_interval > 0) {
+        printf("  Modo de fusión: diferida (cada %d liberaciones)\n", mm->coalesce_interval);
     } else {
-        fprintf(stderr, "Error: Comando desconocido '%s'\n", command);
-        return false;
+        printf("  Modo de fusión: diferida (bajo demanda)\n");
+    }
+    printf("  Tiempo total: %.6f s\n", elapsed);
+    if (elapsed > 0) {
+        printf("  Líneas: %zu (%.0f líneas/s)\n", lines, (double)lines / elapsed);
+        printf("  Operaciones: %zu (%.0f ops/s)\n", mm->executed_ops, (double)mm->executed_ops / elapsed);
+    }
+    printf("  Asignaciones fallidas (ALLOC/REALLOC): %zu\n", failed_allocs);
+    printf("  Latencia p99: %llu ns\n", (unsigned long long)latency_percentile_combined(mm, 99.0));
+    printf("  Pasadas de fusión: %zu\n", mm->merge_passes);
+    printf("  Pico de fragmentación: %d bloques libres, %.3f externa\n",
+           mm->peak_free_blocks, mm->peak_external_fragmentation);
+    if (mm->grow_chunk > 0) {
+        printf("  Pool: %zu bytes (creció %zu veces en tramos de %zu bytes)\n",
+               mm->pool_size, mm->pool_grows, mm->grow_chunk);
+    }
+    printf("  Memoria residente del pool: %zu bytes\n", pool_resident_bytes(mm));
+    if (mm->aligned_requests > 0) {
+        printf("  Relleno de alineación: %zu bytes sin usar (%zu bloques libres de relleno); "
+               "%zu bytes en %zu bloques separados en total (%zu solicitudes alineadas)\n",
+               mm->padding_live, mm->padding_live_blocks, mm->alignment_padding, mm->padding_blocks,
+               mm->aligned_requests);
     }
+    if (mm->header_size > 0) {
+        printf("  Etiquetas en el pool: %zu bytes (cabecera de %zu bytes por bloque, pie de %d en los libres)\n",
+               tag_bytes(mm), mm->header_size, BLOCK_FOOTER_SIZE);
+    }
+    if (mm->large_threshold > 0) {
+        printf("  Asignaciones grandes (desde %zu bytes): %zu con mmap directo, %zu bytes aún mapeados\n",
+               mm->large_threshold, mm->large_allocs, mm->large_bytes);
+    }
+    if (mm->page_granule > 0) {
+        printf("  Páginas devueltas: %zu bytes en %zu llamadas a madvise\n", mm->released_bytes, mm->page_releases);
+    }
+    printf("  Metadatos: %zu bytes (%.1f%% del pool)\n", metadata_bytes(mm),
+           100.0 * (double)metadata_bytes(mm) / (double)mm->pool_size);
+    printf("  Fragmentación externa final: %.3f\n", external_fragmentation(mm));
+    printf("  Fragmentación interna final: %zu bytes\n", internal_fragmentation(mm));
+    printf("  Marca de agua: %zu bytes (utilización final %.1f%%)\n", mm->high_water, high_water_utilization(mm));
+    printf("===========================\n");
 }
 
 /**
  * Función principal del programa gestor de memoria.
  * 
- * Inicializa el gestor de memoria con el algoritmo especificado, lee comandos
- * desde un archivo de entrada línea por línea, los procesa, y al finalizar
+ * Inicializa el gestor de memoria con el algoritmo especificado, mapea el
+ * archivo de entrada y procesa sus comandos línea por línea, y al finalizar
  * reporta posibles fugas de memoria antes de liberar todos los recursos.
  * 
- * Uso: memory_manager <archivo_entrada> [algoritmo]
+ * Uso: memory_manager <archivo_entrada> [algoritmo] [opciones]
  *   - archivo_entrada: archivo con los comandos a ejecutar (obligatorio)
  *   - algoritmo: 0=First-fit, 1=Best-fit, 2=Worst-fit (opcional, por defecto First-fit)
+ *   - opciones: --coalesce=eager|deferred[:N], --summary (ver print_usage)
  * 
  * @param argc Número de argumentos de la línea de comandos
  * @param argv Arreglo de argumentos (argv[0] es el nombre del programa)
  * @return 0 si todo fue correcto, 1 en caso de error
  */
 int main(int argc, char* argv[]) {
-    if (argc < 2 || argc > 3) {
-        fprintf(stderr, "Uso: %s <archivo_entrada> [algoritmo]\n", argv[0]);
-        fprintf(stderr, "Algoritmos: 0=First-fit, 1=Best-fit, 2=Worst-fit\n");
-        fprintf(stderr, "Por defecto se usa First-fit\n");
+    Options opts;
+    if (!parse_options(argc, argv, &opts)) {
+        print_usage(argv[0]);
         return 1;
     }
-    
-    int algorithm = 0; // Por defecto First-fit
-    if (argc == 3) {
-        algorithm = atoi(argv[2]);
-        if (algorithm < 0 || algorithm > 2) {
-            fprintf(stderr, "Error: Algoritmo inválido. Use 0, 1 o 2\n");
+    int algorithm = opts.algorithm;
+
+    if (opts.batch_kb > 0) {
+        // Toda la salida estándar pasa por un búfer propio que se escribe
+        // completo al llenarse. No se libera: stdout lo usa hasta el final.
+        size_t batch_size = (size_t)opts.batch_kb * 1024;
+        char* batch = (char*)malloc(batch_size);
+        if (!batch || setvbuf(stdout, batch, _IOFBF, batch_size) != 0) {
+            fprintf(stderr, "Error: No se pudo crear el búfer de salida de %d KB\n", opts.batch_kb);
+            free(batch);
+            return 1;
+        }
+    }
+
+    select_fit_kernels();
+    if (opts.fit_kernel) {
+        const FitKernels* kernels = find_fit_kernels(opts.fit_kernel);
+        if (!kernels || !fit_kernels_supported(kernels)) {
+            fprintf(stderr, "Error: Núcleo de búsqueda '%s' no disponible en esta CPU\n", opts.fit_kernel);
             return 1;
         }
+        fit_kernels = kernels;
+    }
+
+    if (opts.scan_blocks > 0) {
+        return run_scan_benchmark(opts.scan_blocks) ? 0 : 1;
+    }
+    if (opts.parse_only) {
+        return run_parse_benchmark(opts.input_path) ? 0 : 1;
+    }
+    if (opts.convert_path) {
+        return convert_trace_to_binary(opts.input_path, opts.convert_path) ? 0 : 1;
     }
     
     const char* algorithm_names[] = {"First-fit", "Best-fit", "Worst-fit"};
-    printf("Algoritmo seleccionado: %s\n\n", algorithm_names[algorithm]);
+    ManagerConfig manager_config;
+    manager_config.pool_size = opts.pool_size;
+    manager_config.grow_chunk = opts.grow_chunk;
+    manager_config.pool_limit = opts.pool_limit;
+    manager_config.max_variables = opts.max_variables;
+    manager_config.phantom = opts.phantom;
+    manager_config.headers = opts.headers;
+    manager_config.large_threshold = opts.large_threshold;
+    manager_config.page_mode = opts.page_mode;
+    manager_config.coalesce_mode = opts.coalesce_mode;
+    manager_config.coalesce_interval = opts.coalesce_interval;
+    if (opts.grow_chunk > 0 && (opts.threads > 0 || opts.scaling)) {
+        fprintf(stderr, "Error: --grow no está disponible en modo multihilo (las arenas comparten un pool fijo)\n");
+        return 1;
+    }
+    if ((opts.phantom || opts.page_mode != PAGES_MALLOC) && (opts.threads > 0 || opts.scaling)) {
+        fprintf(stderr, "Error: %s no está disponible en modo multihilo\n", opts.phantom ? "--phantom" : "--mmap");
+        return 1;
+    }
+    if ((opts.headers || opts.large_threshold > 0) && (opts.threads > 0 || opts.scaling)) {
+        fprintf(stderr, "Error: %s no está disponible en modo multihilo\n",
+                opts.headers ? "--headers" : "--large-threshold");
+        return 1;
+    }
+    if (opts.headers && opts.pool_size < BLOCK_MIN_SIZE) {
+        fprintf(stderr, "Error: Con --headers el pool debe tener al menos %d bytes\n", BLOCK_MIN_SIZE);
+        return 1;
+    }
+    if (opts.phantom && opts.page_mode != PAGES_MALLOC) {
+        fprintf(stderr, "Error: --mmap no se puede combinar con --phantom (el pool fantasma no tiene páginas)\n");
+        return 1;
+    }
+    if (opts.output_format != OUTPUT_TEXT && (opts.threads > 0 || opts.scaling || opts.compare || opts.batch_replay)) {
+        fprintf(stderr, "Error: --format=json|csv solo está disponible en modo secuencial\n");
+        return 1;
+    }
+    if (opts.batch_replay) {
+        if (opts.threads > 0 || opts.scaling || opts.compare) {
+            fprintf(stderr, "Error: --batch-replay no se puede combinar con --threads, --scaling ni --compare\n");
+            return 1;
+        }
+        int workers = opts.workers;
+        if (workers == 0) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            workers = cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : (int)cpus;
+        }
+        return run_batch_replay(opts.input_path, workers, algorithm, &manager_config) ? 0 : 1;
+    }
+    if (opts.compare) {
+        if (opts.threads > 0 || opts.scaling) {
+            fprintf(stderr, "Error: --compare no se puede combinar con --threads ni --scaling\n");
+            return 1;
+        }
+        return run_policy_comparison(opts.input_path, &manager_config) ? 0 : 1;
+    }
+    if (opts.output_format == OUTPUT_TEXT) {
+        printf("Algoritmo seleccionado: %s\n\n", algorithm_names[algorithm]);
+    }
+
+    // Modo multihilo: la traza se carga una vez y la reproducen varios hilos
+    if (opts.threads > 0 || opts.scaling) {
+        Trace trace;
+        if (!load_trace(opts.input_path, &trace)) {
+            return 1;
+        }
+        ReplayConfig config;
+        config.algorithm = algorithm;
+        config.coalesce_mode = opts.coalesce_mode;
+        config.coalesce_interval = opts.coalesce_interval;
+        config.threads = opts.threads;
+        config.thread_pool_size = opts.pool_size;
+        config.pool_size = opts.pool_size * (size_t)opts.threads;
+        config.repeat = opts.repeat;
+        config.arenas = opts.arenas;
+        config.binding = opts.arena_binding;
+        config.pipeline = opts.pipeline;
+        config.max_variables = opts.max_variables;
+
+        bool ok = true;
+        if (opts.scaling) {
+            run_scaling_benchmark(&trace, &config);
+        } else {
+            ThreadedResult result;
+            if (config.arenas > config.threads) {
+                config.pool_size = opts.pool_size * (size_t)config.arenas;
+            }
+            ok = run_threaded_replay(&trace, &config, true, &result);
+            if (ok) {
+                print_threaded_result(&result, opts.repeat);
+            }
+        }
+        free_trace(&trace);
+        return ok ? 0 : 1;
+    }
     
     // Inicializar el gestor de memoria
-    MemoryManager* mm = init_memory_manager(MEMORY_SIZE, algorithm);
+    MemoryManager* mm = create_configured_manager(&manager_config, algorithm);
     if (!mm) {
         return 1;
     }
+    mm->metrics_interval = opts.metrics_interval;
+    mm->quiet = opts.quiet;
+    if (opts.output_format != OUTPUT_TEXT) {
+        mm->output = output_create(stdout, opts.output_format);
+        if (!mm->output) {
+            destroy_memory_manager(mm);
+            return 1;
+        }
+        record_begin(mm->output, RECORD_RUN);
+        record_string(mm->output, "algorithm", algorithm_names[algorithm]);
+        record_string(mm->output, "coalesce", opts.coalesce_mode == COALESCE_EAGER ? "eager" : "deferred");
+        record_size(mm->output, "pool_bytes", mm->pool_size);
+        record_bool(mm->output, "phantom", mm->phantom);
+        record_size(mm->output, "header_size", mm->header_size);
+        record_size(mm->output, "large_threshold", mm->large_threshold);
+        record_string(mm->output, "fit_kernel", fit_kernels->name);
+        record_end(mm->output);
+    }
     
-    // Abrir el archivo de entrada
-    FILE* file = fopen(argv[1], "r");
-    if (!file) {
-        fprintf(stderr, "Error: No se pudo abrir el archivo '%s'\n", argv[1]);
+    // Mapear el archivo de entrada
+    TraceReader reader;
+    if (!trace_reader_open(&reader, opts.input_path)) {
         destroy_memory_manager(mm);
         return 1;
     }
     
-    // Procesar el archivo línea por línea
-    char line[256];
-    int line_num = 0;
-    while (fgets(line, sizeof(line), file)) {
-        line_num++;
-        if (!process_line(mm, line)) {
-            fprintf(stderr, "Error en la línea %d\n", line_num);
+    double start = monotonic_seconds();
+    size_t lines = 0;
+    if (is_binary_trace(&reader)) {
+        // Traza binaria: los registros van directo al gestor, sin parsing
+        BinaryTrace binary;
+        if (!binary_trace_attach(&binary, &reader, opts.input_path)) {
+            destroy_memory_manager(mm);
+            return 1;
+        }
+        uint32_t* ids = binary_trace_intern_names(&binary, &mm->symbols);
+        size_t count = ids ? (size_t)binary.header->record_count : 0;
+        TraceOp op;
+        for (size_t i = 0; i < count; i++) {
+            if (!binary_record_to_op(&binary, ids, &binary.records[i], &op) || !execute_op(mm, &op)) {
+                fprintf(stderr, "Error en el registro %zu\n", i + 1);
+            }
         }
+        lines = count;
+        free(ids);
+        trace_reader_close(&binary.file);
+    } else {
+        // Procesar el archivo línea por línea, directamente sobre el mapeo
+        const char* line;
+        const char* end;
+        TraceOp op;
+        while (trace_reader_next(&reader, &line, &end)) {
+            if (!parse_span(line, end, &mm->symbols, &op) || !execute_op(mm, &op)) {
+                fprintf(stderr, "Error en la línea %zu\n", reader.lines);
+            }
+        }
+        lines = reader.lines;
+        trace_reader_close(&reader);
     }
-    
-    fclose(file);
+    double elapsed = monotonic_seconds() - start;
 
 // --- NUEVO: reporte de fugas antes de destruir el gestor ---
     report_leaks(mm);
 
+    if (opts.summary) {
+        print_run_summary(mm, elapsed, lines);
+    }
+    if (opts.latency) {
+        print_latency_report(mm);
+    }
+    if (opts.quiet && !mm->output) {
+        print_op_counters(mm);
+    }
+
     destroy_memory_manager(mm);
     
     return 0;
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <stdarg.h>
 
 // Constantes de configuración del sistema de archivos
 #define MAX_FILES 100                    // Número máximo de archivos que se pueden crear
@@ -11,6 +12,28 @@
 #define TOTAL_BLOCKS 2048                // Total de bloques disponibles (2048 * 512 = 1 MB simulado)
 #define STORAGE_SIZE (BLOCK_SIZE * TOTAL_BLOCKS)  // Tamaño total del almacenamiento simulado
 #define MAX_BLOCKS_PER_FILE TOTAL_BLOCKS // Máximo de bloques que puede usar un archivo
+#define BATCH_DEFAULT_KB 64              // Tamaño por defecto del búfer de --batch
+
+// Índices de los contadores por comando que se muestran con --quiet
+#define CMD_CREATE 0
+#define CMD_WRITE 1
+#define CMD_READ 2
+#define CMD_DELETE 3
+#define CMD_LIST 4
+#define CMD_COUNT 5
+
+static const char *command_names[CMD_COUNT] = {"CREATE", "WRITE", "READ", "DELETE", "LIST"};
+
+/**
+ * Opciones de salida y contadores de comandos ejecutados.
+ * 
+ * Con quiet activo no se imprime el mensaje de cada CREATE/WRITE/DELETE y al
+ * final se muestran solo los contadores. READ y LIST siguen imprimiendo su
+ * resultado, que es el dato pedido y no un aviso.
+ */
+static bool quiet = false;
+static size_t command_ok[CMD_COUNT];
+static size_t command_failed[CMD_COUNT];
 
 /**
  * Estructura que representa una entrada de archivo en el sistema.
@@ -62,6 +85,23 @@ static void fs_init(FileSystem *fs) {
     memset(fs->block_used, 0, sizeof(fs->block_used));
 }
 
+/**
+ * Imprime el aviso de un comando que modificó el sistema de archivos.
+ * 
+ * En modo silencioso el aviso se omite sin formatearlo.
+ * 
+ * @param format Formato de printf
+ */
+static void op_message(const char *format, ...) {
+    if (quiet) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
 /**
  * Busca un archivo en el sistema por su nombre.
  * 
@@ -220,7 +260,7 @@ static bool cmd_create(FileSystem *fs, const char *name, size_t size) {
     }
 
     fs->file_count++;
-    printf("CREATE: archivo '%s' creado (%zu bytes)\n", name, size);
+    op_message("CREATE: archivo '%s' creado (%zu bytes)\n", name, size);
     return true;
 }
 
@@ -293,7 +333,7 @@ static bool cmd_write(FileSystem *fs, const char *name, size_t offset, const cha
         return false;
     }
 
-    printf("WRITE: se escribieron %zu bytes en '%s'\n", len, name);
+    op_message("WRITE: se escribieron %zu bytes en '%s'\n", len, name);
     return true;
 }
 
@@ -406,7 +446,7 @@ static bool cmd_delete(FileSystem *fs, const char *name) {
     memset(&fs->files[fs->file_count - 1], 0, sizeof(FileEntry));
     fs->file_count--;
 
-    printf("DELETE: archivo '%s' eliminado\n", name);
+    op_message("DELETE: archivo '%s' eliminado\n", name);
     return true;
 }
 
@@ -484,6 +524,36 @@ static void strip_quotes(char *s) {
     }
 }
 
+/**
+ * Registra el resultado de un comando en los contadores.
+ * 
+ * @param command Índice del comando (CMD_CREATE, CMD_WRITE, ...)
+ * @param ok Resultado del comando
+ * @return El mismo resultado, para poder devolverlo directamente
+ */
+static bool count_command(int command, bool ok) {
+    if (ok) {
+        command_ok[command]++;
+    } else {
+        command_failed[command]++;
+    }
+    return ok;
+}
+
+/**
+ * Imprime cuántos comandos de cada tipo terminaron bien y cuántos fallaron.
+ */
+static void print_command_counters(void) {
+    printf("=== Comandos ejecutados ===\n");
+    for (int i = 0; i < CMD_COUNT; ++i) {
+        if (command_ok[i] + command_failed[i] > 0) {
+            printf("  %-8s %10zu (%zu fallidos)\n", command_names[i],
+                   command_ok[i] + command_failed[i], command_failed[i]);
+        }
+    }
+    printf("===========================\n");
+}
+
 /**
  * Procesa una línea de comando y ejecuta la operación correspondiente.
  * 
@@ -518,7 +588,7 @@ static bool process_command(FileSystem *fs, char *line) {
             return false;
         }
         size_t size = (size_t)strtoull(size_str, NULL, 10);
-        return cmd_create(fs, name, size);
+        return count_command(CMD_CREATE, cmd_create(fs, name, size));
     }
 
     if (strcmp(command, "WRITE") == 0) {
@@ -535,7 +605,7 @@ static bool process_command(FileSystem *fs, char *line) {
         strip_quotes(payload);
 
         size_t offset = (size_t)strtoull(offset_str, NULL, 10);
-        return cmd_write(fs, name, offset, payload);
+        return count_command(CMD_WRITE, cmd_write(fs, name, offset, payload));
     }
 
     if (strcmp(command, "READ") == 0) {
@@ -548,7 +618,7 @@ static bool process_command(FileSystem *fs, char *line) {
         }
         size_t offset = (size_t)strtoull(offset_str, NULL, 10);
         size_t size = (size_t)strtoull(size_str, NULL, 10);
-        return cmd_read(fs, name, offset, size);
+        return count_command(CMD_READ, cmd_read(fs, name, offset, size));
     }
 
     if (strcmp(command, "DELETE") == 0) {
@@ -557,12 +627,12 @@ static bool process_command(FileSystem *fs, char *line) {
             fprintf(stderr, "Error: formato de DELETE inválido\n");
             return false;
         }
-        return cmd_delete(fs, name);
+        return count_command(CMD_DELETE, cmd_delete(fs, name));
     }
 
     if (strcmp(command, "LIST") == 0) {
         cmd_list(fs);
-        return true;
+        return count_command(CMD_LIST, true);
     }
 
     fprintf(stderr, "Error: comando desconocido '%s'\n", command);
@@ -577,9 +647,13 @@ static bool process_command(FileSystem *fs, char *line) {
  * Lee línea por línea hasta el final del archivo o entrada, procesando cada
  * comando. Al finalizar, cierra el archivo si fue abierto.
  * 
- * Uso: simple_fs [archivo_comandos]
- *   - Sin argumentos: lee comandos desde stdin
- *   - Con un argumento: lee comandos desde el archivo especificado
+ * Uso: simple_fs [--quiet] [--batch[=KB]] [archivo_comandos]
+ *   - Sin archivo: lee comandos desde stdin
+ *   - Con un archivo: lee comandos desde el archivo especificado
+ *   - --quiet: omite los avisos de CREATE/WRITE/DELETE y al final muestra
+ *     los contadores de comandos
+ *   - --batch[=KB]: acumula la salida en un búfer de KB kilobytes (64 por
+ *     defecto) que se escribe de una vez al llenarse
  * 
  * @param argc Número de argumentos de la línea de comandos
  * @param argv Arreglo de argumentos (argv[0] es el nombre del programa)
@@ -589,16 +663,46 @@ int main(int argc, char *argv[]) {
     FileSystem fs;
     fs_init(&fs);
 
+    const char *path = NULL;
+    long batch_kb = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch_kb = BATCH_DEFAULT_KB;
+        } else if (strncmp(argv[i], "--batch=", 8) == 0) {
+            char *end;
+            batch_kb = strtol(argv[i] + 8, &end, 10);
+            if (*end != '\0' || batch_kb < 1 || batch_kb > 1024 * 1024) {
+                fprintf(stderr, "Error: tamaño de lote inválido '%s'\n", argv[i] + 8);
+                return EXIT_FAILURE;
+            }
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Uso: %s [--quiet] [--batch[=KB]] [archivo_comandos]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (batch_kb > 0) {
+        // El búfer no se libera: stdout lo usa hasta que termina el programa.
+        size_t batch_size = (size_t)batch_kb * 1024;
+        char *batch = malloc(batch_size);
+        if (!batch || setvbuf(stdout, batch, _IOFBF, batch_size) != 0) {
+            fprintf(stderr, "Error: no se pudo crear el búfer de salida\n");
+            free(batch);
+            return EXIT_FAILURE;
+        }
+    }
+
     FILE *input = stdin;
-    if (argc == 2) {
-        input = fopen(argv[1], "r");
+    if (path) {
+        input = fopen(path, "r");
         if (!input) {
-            fprintf(stderr, "Error: no se pudo abrir el archivo '%s'\n", argv[1]);
+            fprintf(stderr, "Error: no se pudo abrir el archivo '%s'\n", path);
             return EXIT_FAILURE;
         }
-    } else if (argc > 2) {
-        fprintf(stderr, "Uso: %s [archivo_comandos]\n", argv[0]);
-        return EXIT_FAILURE;
     }
 
     char line[1024];
@@ -610,6 +714,10 @@ int main(int argc, char *argv[]) {
         fclose(input);
     }
 
+    if (quiet) {
+        print_command_counters();
+    }
+
     return EXIT_SUCCESS;
 }
 
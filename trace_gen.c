@@ -0,0 +1,622 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+// Constantes del generador de trazas
+#define DEFAULT_OPS 1000000              // Operaciones generadas por defecto
+#define DEFAULT_LIVE 64                  // Variables vivas a la vez por defecto
+#define DEFAULT_SEED 1                   // Semilla por defecto
+#define DEFAULT_MAX_SIZE (1u << 20)      // Tamaño máximo de una solicitud en bytes
+#define OUTPUT_BUFFER_SIZE (1 << 20)     // Búfer de escritura de la traza
+#define TWO_PI 6.283185307179586         // M_PI no está definido con -std=c11
+
+// Distribuciones de tamaño
+#define SIZE_UNIFORM 0                   // Uniforme entre MIN y MAX
+#define SIZE_LOGNORMAL 1                 // exp(N(MU, SIGMA))
+#define SIZE_BIMODAL 2                   // S1 con probabilidad P, si no S2
+
+// Distribuciones de tiempo de vida (en operaciones)
+#define LIFETIME_EXP 0                   // Exponencial de media MEAN
+#define LIFETIME_PHASED 1                // Todas mueren al final de su fase, salvo una fracción
+
+/**
+ * Parámetros de generación, tomados de la línea de comandos.
+ */
+typedef struct {
+    uint64_t ops;                       // Operaciones a generar (sin contar los FREE finales)
+    uint64_t seed;                      // Semilla del generador pseudoaleatorio
+    uint32_t max_live;                  // Máximo de variables vivas a la vez
+    size_t max_size;                    // Tamaño máximo de una solicitud
+    int size_dist;                      // SIZE_UNIFORM, SIZE_LOGNORMAL o SIZE_BIMODAL
+    double size_a, size_b, size_c;      // Parámetros de la distribución de tamaño
+    int lifetime_dist;                  // LIFETIME_EXP o LIFETIME_PHASED
+    double lifetime_a, lifetime_b;      // Parámetros de la distribución de vida
+    double realloc_prob;                // Probabilidad de REALLOC en cada paso
+    double realloc_growth;              // Factor aplicado al tamaño en cada REALLOC
+    uint64_t align;                     // Alineación de ALLOC/REALLOC (0 = sin alineación)
+    double align_prob;                  // Fracción de ALLOC/REALLOC alineados
+    uint64_t stats_every;               // Insertar STATS cada N operaciones (0 = nunca)
+    bool leak;                          // No liberar las variables vivas al terminar
+    const char *output_path;            // Archivo de salida (NULL = stdout)
+} GenOptions;
+
+/**
+ * Muerte pendiente de una variable viva.
+ */
+typedef struct {
+    uint64_t death;                     // Operación en la que se libera
+    uint32_t slot;                      // Ranura de la variable (su nombre es v<slot>)
+} Death;
+
+/**
+ * Estado de la generación.
+ *
+ * Las ranuras se reutilizan, así que los nombres de variable están acotados
+ * por max_live. Las muertes pendientes forman un montículo de mínimos y las
+ * ranuras vivas un arreglo denso para poder elegir una al azar en O(1).
+ */
+typedef struct {
+    uint64_t rng;                       // Estado de splitmix64
+    Death *heap;                        // Montículo de mínimos por momento de muerte
+    uint32_t heap_count;
+    uint32_t *live;                     // Ranuras vivas (arreglo denso)
+    uint32_t *live_pos;                 // Posición de cada ranura en live
+    uint32_t live_count;
+    uint32_t *free_slots;               // Pila de ranuras libres
+    uint32_t free_count;
+    size_t *sizes;                      // Tamaño actual de cada ranura
+} GenState;
+
+/**
+ * Siguiente número de 64 bits de splitmix64. Es determinista para una semilla
+ * dada, así que la misma línea de comandos genera siempre la misma traza.
+ *
+ * @param state Estado del generador
+ * @return Número pseudoaleatorio
+ */
+static uint64_t rng_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Número uniforme en (0, 1), nunca 0 para poder tomar su logaritmo.
+ *
+ * @param state Estado del generador
+ * @return Número en (0, 1)
+ */
+static double rng_uniform(uint64_t *state) {
+    return ((double)(rng_next(state) >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/**
+ * Número con distribución normal estándar (Box-Muller).
+ *
+ * @param state Estado del generador
+ * @return Muestra de N(0, 1)
+ */
+static double rng_normal(uint64_t *state) {
+    double u1 = rng_uniform(state);
+    double u2 = rng_uniform(state);
+    return sqrt(-2.0 * log(u1)) * cos(TWO_PI * u2);
+}
+
+/**
+ * Ajusta un tamaño al rango [1, max_size].
+ *
+ * @param opts Parámetros de generación
+ * @param size Tamaño propuesto
+ * @return Tamaño válido
+ */
+static size_t clamp_size(const GenOptions *opts, double size) {
+    if (!(size >= 1.0)) {
+        return 1;
+    }
+    if (size >= (double)opts->max_size) {
+        return opts->max_size;
+    }
+    return (size_t)size;
+}
+
+/**
+ * Toma el tamaño de una nueva asignación de la distribución elegida.
+ *
+ * @param opts Parámetros de generación
+ * @param state Estado de la generación
+ * @return Tamaño en bytes
+ */
+static size_t sample_size(const GenOptions *opts, GenState *state) {
+    switch (opts->size_dist) {
+        case SIZE_UNIFORM: {
+            uint64_t span = (uint64_t)(opts->size_b - opts->size_a) + 1;
+            return clamp_size(opts, opts->size_a + (double)(rng_next(&state->rng) % span));
+        }
+        case SIZE_LOGNORMAL:
+            return clamp_size(opts, exp(opts->size_a + opts->size_b * rng_normal(&state->rng)));
+        default:
+            return clamp_size(opts, rng_uniform(&state->rng) < opts->size_c ? opts->size_a : opts->size_b);
+    }
+}
+
+/**
+ * Calcula en qué operación se liberará una variable creada en la operación now.
+ *
+ * Con LIFETIME_PHASED la traza se divide en fases de LEN operaciones: cada
+ * variable muere al final de la fase en que nació, salvo una fracción KEEP
+ * que sobrevive un número geométrico de fases más. Es el patrón de las
+ * cargas por peticiones o por cuadros, con un resto de objetos de larga
+ * vida que fragmenta el espacio liberado en bloque.
+ *
+ * @param opts Parámetros de generación
+ * @param state Estado de la generación
+ * @param now Operación actual
+ * @return Operación de muerte (siempre posterior a now)
+ */
+static uint64_t sample_death(const GenOptions *opts, GenState *state, uint64_t now) {
+    if (opts->lifetime_dist == LIFETIME_EXP) {
+        return now + 1 + (uint64_t)(-opts->lifetime_a * log(rng_uniform(&state->rng)));
+    }
+
+    uint64_t phase = (uint64_t)opts->lifetime_a;
+    uint64_t end = (now / phase + 1) * phase;
+    while (rng_uniform(&state->rng) < opts->lifetime_b) {
+        end += phase;
+    }
+    return end;
+}
+
+/**
+ * Inserta una muerte pendiente en el montículo.
+ *
+ * @param state Estado de la generación
+ * @param death Muerte a insertar
+ */
+static void heap_push(GenState *state, Death death) {
+    uint32_t i = state->heap_count++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (state->heap[parent].death <= death.death) {
+            break;
+        }
+        state->heap[i] = state->heap[parent];
+        i = parent;
+    }
+    state->heap[i] = death;
+}
+
+/**
+ * Extrae la muerte más próxima del montículo.
+ *
+ * @param state Estado de la generación (el montículo no debe estar vacío)
+ * @return Muerte extraída
+ */
+static Death heap_pop(GenState *state) {
+    Death top = state->heap[0];
+    Death last = state->heap[--state->heap_count];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= state->heap_count) {
+            break;
+        }
+        if (child + 1 < state->heap_count && state->heap[child + 1].death < state->heap[child].death) {
+            child++;
+        }
+        if (last.death <= state->heap[child].death) {
+            break;
+        }
+        state->heap[i] = state->heap[child];
+        i = child;
+    }
+    state->heap[i] = last;
+    return top;
+}
+
+/**
+ * Emite el fin de línea de un ALLOC/REALLOC, con su alineación si corresponde.
+ *
+ * Solo consume números aleatorios si la fracción alineada es menor que 1,
+ * así que sin --align las trazas no cambian.
+ *
+ * @param opts Parámetros de generación
+ * @param state Estado de la generación
+ * @param out Archivo de salida
+ */
+static void emit_alignment(const GenOptions *opts, GenState *state, FILE *out) {
+    if (opts->align > 1 && (opts->align_prob >= 1.0 || rng_uniform(&state->rng) < opts->align_prob)) {
+        fprintf(out, " %llu\n", (unsigned long long)opts->align);
+    } else {
+        fputc('\n', out);
+    }
+}
+
+/**
+ * Emite un ALLOC en una ranura libre y agenda su muerte.
+ *
+ * @param opts Parámetros de generación
+ * @param state Estado de la generación
+ * @param out Archivo de salida
+ * @param now Operación actual
+ */
+static void emit_alloc(const GenOptions *opts, GenState *state, FILE *out, uint64_t now) {
+    uint32_t slot = state->free_slots[--state->free_count];
+    size_t size = sample_size(opts, state);
+    state->sizes[slot] = size;
+    state->live_pos[slot] = state->live_count;
+    state->live[state->live_count++] = slot;
+    heap_push(state, (Death){sample_death(opts, state, now), slot});
+    fprintf(out, "ALLOC v%u %zu", slot, size);
+    emit_alignment(opts, state, out);
+}
+
+/**
+ * Emite el FREE de la variable con la muerte más próxima.
+ *
+ * @param state Estado de la generación (con al menos una variable viva)
+ * @param out Archivo de salida
+ */
+static void emit_free(GenState *state, FILE *out) {
+    uint32_t slot = heap_pop(state).slot;
+    uint32_t pos = state->live_pos[slot];
+    uint32_t moved = state->live[--state->live_count];
+    state->live[pos] = moved;
+    state->live_pos[moved] = pos;
+    state->free_slots[state->free_count++] = slot;
+    fprintf(out, "FREE v%u\n", slot);
+}
+
+/**
+ * Emite un REALLOC de una variable viva elegida al azar, multiplicando su
+ * tamaño por el factor de crecimiento. La variable conserva su muerte.
+ *
+ * @param opts Parámetros de generación
+ * @param state Estado de la generación (con al menos una variable viva)
+ * @param out Archivo de salida
+ */
+static void emit_realloc(const GenOptions *opts, GenState *state, FILE *out) {
+    uint32_t slot = state->live[rng_next(&state->rng) % state->live_count];
+    size_t size = clamp_size(opts, ceil((double)state->sizes[slot] * opts->realloc_growth));
+    state->sizes[slot] = size;
+    fprintf(out, "REALLOC v%u %zu", slot, size);
+    emit_alignment(opts, state, out);
+}
+
+/**
+ * Genera la traza completa.
+ *
+ * En cada paso se libera la variable cuya muerte ya llegó; si no hay
+ * ninguna, se hace un REALLOC con probabilidad realloc_prob o un ALLOC. Si
+ * ya hay max_live variables vivas, se adelanta la muerte más próxima. Así
+ * cada paso emite exactamente una operación.
+ *
+ * @param opts Parámetros de generación
+ * @param out Archivo de salida
+ * @return true si se generó la traza, false si faltó memoria
+ */
+static bool generate(const GenOptions *opts, FILE *out) {
+    GenState state;
+    memset(&state, 0, sizeof(state));
+    state.rng = opts->seed;
+    state.heap = malloc(opts->max_live * sizeof(Death));
+    state.live = malloc(opts->max_live * sizeof(uint32_t));
+    state.live_pos = malloc(opts->max_live * sizeof(uint32_t));
+    state.free_slots = malloc(opts->max_live * sizeof(uint32_t));
+    state.sizes = malloc(opts->max_live * sizeof(size_t));
+    bool ok = state.heap && state.live && state.live_pos && state.free_slots && state.sizes;
+
+    if (ok) {
+        // Las ranuras se entregan en orden creciente: v0, v1, ...
+        for (uint32_t i = 0; i < opts->max_live; ++i) {
+            state.free_slots[i] = opts->max_live - 1 - i;
+        }
+        state.free_count = opts->max_live;
+
+        for (uint64_t now = 0; now < opts->ops; ++now) {
+            if (opts->stats_every > 0 && now > 0 && now % opts->stats_every == 0) {
+                fputs("STATS\n", out);
+            }
+            if (state.heap_count > 0 && state.heap[0].death <= now) {
+                emit_free(&state, out);
+            } else if (state.live_count > 0 && rng_uniform(&state.rng) < opts->realloc_prob) {
+                emit_realloc(opts, &state, out);
+            } else if (state.live_count < opts->max_live) {
+                emit_alloc(opts, &state, out, now);
+            } else {
+                emit_free(&state, out);
+            }
+        }
+
+        if (!opts->leak) {
+            while (state.live_count > 0) {
+                emit_free(&state, out);
+            }
+        }
+    } else {
+        fprintf(stderr, "Error: no se pudo reservar memoria para %u variables\n", opts->max_live);
+    }
+
+    free(state.heap);
+    free(state.live);
+    free(state.live_pos);
+    free(state.free_slots);
+    free(state.sizes);
+    return ok;
+}
+
+/**
+ * Lee una lista de números separados por ':' (por ejemplo "16:256").
+ *
+ * @param text Texto a interpretar
+ * @param values Arreglo donde se guardan los números
+ * @param count Cantidad exacta de números esperada
+ * @return true si el texto tiene exactamente count números válidos
+ */
+static bool parse_numbers(const char *text, double *values, int count) {
+    for (int i = 0; i < count; ++i) {
+        char *end;
+        values[i] = strtod(text, &end);
+        if (end == text) {
+            return false;
+        }
+        if (i + 1 < count) {
+            if (*end != ':') {
+                return false;
+            }
+            text = end + 1;
+        } else if (*end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Interpreta --size=uniform:MIN:MAX|lognormal:MU:SIGMA|bimodal:S1:S2:P.
+ *
+ * @param text Valor de la opción
+ * @param opts Parámetros donde se guarda la distribución
+ * @return true si la distribución es válida
+ */
+static bool parse_size_dist(const char *text, GenOptions *opts) {
+    double v[3];
+    if (strncmp(text, "uniform:", 8) == 0 && parse_numbers(text + 8, v, 2)) {
+        opts->size_dist = SIZE_UNIFORM;
+        if (v[0] < 1 || v[1] < v[0]) {
+            return false;
+        }
+    } else if (strncmp(text, "lognormal:", 10) == 0 && parse_numbers(text + 10, v, 2)) {
+        opts->size_dist = SIZE_LOGNORMAL;
+        if (v[1] < 0) {
+            return false;
+        }
+    } else if (strncmp(text, "bimodal:", 8) == 0 && parse_numbers(text + 8, v, 3)) {
+        opts->size_dist = SIZE_BIMODAL;
+        if (v[0] < 1 || v[1] < 1 || v[2] < 0 || v[2] > 1) {
+            return false;
+        }
+        opts->size_c = v[2];
+    } else {
+        return false;
+    }
+    opts->size_a = v[0];
+    opts->size_b = v[1];
+    return true;
+}
+
+/**
+ * Interpreta --lifetime=exp:MEAN|phased:LEN[:KEEP].
+ *
+ * @param text Valor de la opción
+ * @param opts Parámetros donde se guarda la distribución
+ * @return true si la distribución es válida
+ */
+static bool parse_lifetime_dist(const char *text, GenOptions *opts) {
+    double v[2] = {0, 0};
+    if (strncmp(text, "exp:", 4) == 0 && parse_numbers(text + 4, v, 1)) {
+        opts->lifetime_dist = LIFETIME_EXP;
+        if (v[0] <= 0) {
+            return false;
+        }
+    } else if (strncmp(text, "phased:", 7) == 0 &&
+               (parse_numbers(text + 7, v, 1) || parse_numbers(text + 7, v, 2))) {
+        opts->lifetime_dist = LIFETIME_PHASED;
+        if (v[0] < 1 || v[1] < 0 || v[1] >= 1) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    opts->lifetime_a = v[0];
+    opts->lifetime_b = v[1];
+    return true;
+}
+
+/**
+ * Lee un entero sin signo positivo de una opción.
+ *
+ * @param text Texto a interpretar
+ * @param out Donde se guarda el valor
+ * @return true si el texto es un entero mayor que 0
+ */
+static bool parse_count(const char *text, uint64_t *out) {
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || value == 0 || text[0] == '-') {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+/**
+ * Muestra la ayuda del generador.
+ *
+ * @param program Nombre del ejecutable
+ */
+static void print_usage(const char *program) {
+    fprintf(stderr, "Uso: %s [opciones] [archivo_salida]\n", program);
+    fprintf(stderr, "Genera una traza de ALLOC/REALLOC/FREE para memory_manager (stdout por defecto).\n");
+    fprintf(stderr, "Opciones:\n");
+    fprintf(stderr, "  --ops=N                      Operaciones a generar (por defecto %d)\n", DEFAULT_OPS);
+    fprintf(stderr, "  --seed=S                     Semilla; la misma semilla da la misma traza (por defecto %d)\n",
+            DEFAULT_SEED);
+    fprintf(stderr, "  --live=N                     Máximo de variables vivas a la vez (por defecto %d)\n", DEFAULT_LIVE);
+    fprintf(stderr, "  --max-size=N                 Tamaño máximo de una solicitud (por defecto %u)\n",
+            DEFAULT_MAX_SIZE);
+    fprintf(stderr, "  --size=uniform:MIN:MAX       Tamaños uniformes (por defecto uniform:16:256)\n");
+    fprintf(stderr, "  --size=lognormal:MU:SIGMA    Tamaños exp(N(MU, SIGMA))\n");
+    fprintf(stderr, "  --size=bimodal:S1:S2:P       S1 con probabilidad P, si no S2\n");
+    fprintf(stderr, "  --lifetime=exp:MEAN          Vida exponencial de media MEAN operaciones (por defecto exp:100)\n");
+    fprintf(stderr, "  --lifetime=phased:LEN[:KEEP] Mueren al final de su fase de LEN operaciones; una\n");
+    fprintf(stderr, "                               fracción KEEP sobrevive a cada fase siguiente\n");
+    fprintf(stderr, "  --realloc=P:FACTOR           REALLOC con probabilidad P multiplicando el tamaño por FACTOR\n");
+    fprintf(stderr, "  --align=A[:P]                Alinear a A bytes (potencia de 2) una fracción P de los\n");
+    fprintf(stderr, "                               ALLOC/REALLOC (por defecto todos)\n");
+    fprintf(stderr, "  --stats-every=N              Insertar STATS cada N operaciones\n");
+    fprintf(stderr, "  --leak                       No liberar las variables vivas al terminar\n");
+}
+
+/**
+ * Interpreta la línea de comandos.
+ *
+ * @param argc Número de argumentos
+ * @param argv Argumentos
+ * @param opts Parámetros de generación a completar
+ * @return true si todas las opciones son válidas
+ */
+static bool parse_options(int argc, char *argv[], GenOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->ops = DEFAULT_OPS;
+    opts->seed = DEFAULT_SEED;
+    opts->max_live = DEFAULT_LIVE;
+    opts->max_size = DEFAULT_MAX_SIZE;
+    opts->size_dist = SIZE_UNIFORM;
+    opts->size_a = 16;
+    opts->size_b = 256;
+    opts->lifetime_dist = LIFETIME_EXP;
+    opts->lifetime_a = 100;
+    opts->realloc_growth = 1.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        uint64_t value;
+        if (strncmp(arg, "--ops=", 6) == 0) {
+            if (!parse_count(arg + 6, &opts->ops)) {
+                fprintf(stderr, "Error: número de operaciones inválido '%s'\n", arg + 6);
+                return false;
+            }
+        } else if (strncmp(arg, "--seed=", 7) == 0) {
+            char *end;
+            opts->seed = strtoull(arg + 7, &end, 10);
+            if (end == arg + 7 || *end != '\0') {
+                fprintf(stderr, "Error: semilla inválida '%s'\n", arg + 7);
+                return false;
+            }
+        } else if (strncmp(arg, "--live=", 7) == 0) {
+            if (!parse_count(arg + 7, &value) || value > UINT32_MAX / 2) {
+                fprintf(stderr, "Error: número de variables vivas inválido '%s'\n", arg + 7);
+                return false;
+            }
+            opts->max_live = (uint32_t)value;
+        } else if (strncmp(arg, "--max-size=", 11) == 0) {
+            if (!parse_count(arg + 11, &value)) {
+                fprintf(stderr, "Error: tamaño máximo inválido '%s'\n", arg + 11);
+                return false;
+            }
+            opts->max_size = (size_t)value;
+        } else if (strncmp(arg, "--size=", 7) == 0) {
+            if (!parse_size_dist(arg + 7, opts)) {
+                fprintf(stderr, "Error: distribución de tamaño inválida '%s'\n", arg + 7);
+                return false;
+            }
+        } else if (strncmp(arg, "--lifetime=", 11) == 0) {
+            if (!parse_lifetime_dist(arg + 11, opts)) {
+                fprintf(stderr, "Error: distribución de vida inválida '%s'\n", arg + 11);
+                return false;
+            }
+        } else if (strncmp(arg, "--realloc=", 10) == 0) {
+            double v[2];
+            if (!parse_numbers(arg + 10, v, 2) || v[0] < 0 || v[0] > 1 || v[1] <= 0) {
+                fprintf(stderr, "Error: parámetros de REALLOC inválidos '%s'\n", arg + 10);
+                return false;
+            }
+            opts->realloc_prob = v[0];
+            opts->realloc_growth = v[1];
+        } else if (strncmp(arg, "--align=", 8) == 0) {
+            double v[2] = {0, 1};
+            if ((!parse_numbers(arg + 8, v, 2) && !parse_numbers(arg + 8, v, 1)) || v[0] < 1 || v[0] > 1073741824.0 ||
+                ((uint64_t)v[0] & ((uint64_t)v[0] - 1)) != 0 || (double)(uint64_t)v[0] != v[0] || v[1] < 0 || v[1] > 1) {
+                fprintf(stderr, "Error: alineación inválida '%s'\n", arg + 8);
+                return false;
+            }
+            opts->align = (uint64_t)v[0];
+            opts->align_prob = v[1];
+        } else if (strncmp(arg, "--stats-every=", 14) == 0) {
+            if (!parse_count(arg + 14, &opts->stats_every)) {
+                fprintf(stderr, "Error: intervalo de STATS inválido '%s'\n", arg + 14);
+                return false;
+            }
+        } else if (strcmp(arg, "--leak") == 0) {
+            opts->leak = true;
+        } else if (arg[0] != '-' && !opts->output_path) {
+            opts->output_path = arg;
+        } else {
+            fprintf(stderr, "Error: opción desconocida '%s'\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Función principal del generador.
+ *
+ * Escribe en la cabecera de la traza, como comentario, la línea de comandos
+ * que la generó, de modo que cualquier traza se puede reproducir.
+ *
+ * Uso: trace_gen [opciones] [archivo_salida]
+ *
+ * @param argc Número de argumentos de la línea de comandos
+ * @param argv Arreglo de argumentos (argv[0] es el nombre del programa)
+ * @return EXIT_SUCCESS si se generó la traza, EXIT_FAILURE en caso de error
+ */
+int main(int argc, char *argv[]) {
+    GenOptions opts;
+    if (!parse_options(argc, argv, &opts)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *out = stdout;
+    if (opts.output_path) {
+        out = fopen(opts.output_path, "w");
+        if (!out) {
+            fprintf(stderr, "Error: no se pudo crear el archivo '%s'\n", opts.output_path);
+            return EXIT_FAILURE;
+        }
+    }
+    setvbuf(out, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    fputs("# Generado por trace_gen", out);
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] != opts.output_path && strncmp(argv[i], "--seed=", 7) != 0) {
+            fprintf(out, " %s", argv[i]);
+        }
+    }
+    fprintf(out, " --seed=%llu\n", (unsigned long long)opts.seed);
+
+    bool ok = generate(&opts, out);
+    if (fflush(out) != 0 || ferror(out)) {
+        fprintf(stderr, "Error: no se pudo escribir la traza\n");
+        ok = false;
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}